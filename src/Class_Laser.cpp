@@ -66,6 +66,7 @@ void Laser::setSwitch(bool _state)
 	if (enabled) {
 	if (myState.stateCarrier) analogWrite(pinSwitch, 0.58 * 2048*_state);
 	else digitalWrite(pinSwitch, _state);
+	switchOutput = _state;
 	// ATTN: do not forgot to set the pin to OUTPUT mode when swithing the carrier OFF, or the switching
 	// won't work anymore.
 	}
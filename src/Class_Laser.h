@@ -40,6 +40,8 @@ public:
 	// ATTN overloaded from Module base class for sequencer user: =================================
 	String getParamString();
 	String getName();
+	uint8_t getClassIndex() { return (myClassIndex); }
+	uint8_t getID() { return (myID); }
 
 	bool getState() { return (output); }
 	// NOTE: may NOT the same than getStateSwitch() if action() was not performed:
@@ -49,6 +51,7 @@ public:
 	void setActive(bool _active) override
 	{ // overriden method (ATTN: technically there is no need to declar "virtual" in base class,// nor "overrided" )
 		active = _active;
+		dirty = true;
 		setStateSwitch(false);
 	}
 	void computeNextState(bool _inputFrom) { nextOutput = _inputFrom; }
@@ -60,6 +63,14 @@ public:
 	void disableLaserLock();
 
 	void setSwitch(bool _state);
+	// Per-point switching from the display engine: the laser shines only if both its switch state
+	// and the point mask bit are on. The pin is written only when the output actually changes.
+	inline void setSwitchMasked(bool _maskBit)
+	{
+		bool target = myState.stateSwitch && _maskBit;
+		if (target != switchOutput)
+			setSwitch(target);
+	}
 	void toggleStateSwitch(); // will be useful for the sequencer.
 	void setPower(uint16_t _power);
 	void setToCurrentState(); // in case we changed the state by directly accessing the myState variable
@@ -95,6 +106,7 @@ private:
 	LaserState myState{defaultState}; // C++11 class member initialization (I define defaultState in case we want to revert to default):
 
 	uint8_t pinPower, pinSwitch;
+	bool switchOutput = false; // last value written on the switch pin (not the state!)
 
 	// Default laser state:
 	// NOTE: for the time being, inter-point blanking is a variable of DisplayScan, so it concern
@@ -4,6 +4,7 @@
 #include "Arduino.h"
 #include "Definitions.h"
 #include "Utils.h"
+#include "fastMath.h"
 
 // Very simple 2D vector class:
 class P2 {
@@ -43,9 +44,16 @@ class P2 {
     }
 
     inline void rotate(float _angle) {
+      float sinA, cosA;
+      FastMath::sinCos(FastMath::DEG_TO_RAD_F * _angle, sinA, cosA);
+      rotate(sinA, cosA);
+    }
+
+    // Rotation with precomputed sine and cosine (when rotating many points by the same angle):
+    inline void rotate(float _sinA, float _cosA) {
       float auxX = x;
-      x = 1.0*x * cos(DEG_TO_RAD * _angle) - 1.0*y * sin(DEG_TO_RAD * _angle);
-      y = 1.0*auxX * sin(DEG_TO_RAD * _angle) + 1.0*y * cos(DEG_TO_RAD * _angle);
+      x = x * _cosA - y * _sinA;
+      y = auxX * _sinA + y * _cosA;
     }
 
     inline void scale(float _factor) {
@@ -71,23 +79,32 @@ class P2 {
 //typedef P2 PointBuffer[MAX_NUM_POINTS];
 
 
+// Laser "color" of a point: bit k set means laser k shines on this point (if its switch state is on).
+// NOTE: the renderer and display buffers store the masks in arrays parallel to the P2 arrays rather
+// than in LP arrays: with the padding, an LP is 12 bytes instead of 9, and the four buffers of
+// MAX_NUM_POINTS would not fit in the Teensy RAM.
+#define LASER_MASK_ALL 0xFF
+
 struct LP { // a laser point (for now, using a float P2, but in the future let's use uint16_t)
   P2 point;
-  bool redColor; // for test now (in the future we need to store 5 values from 0 to 4095)
+  uint8_t laserMask = LASER_MASK_ALL;
+
+  LP() {}
+  LP(const P2& _point, uint8_t _laserMask): point(_point), laserMask(_laserMask) {}
 
   inline void operator=( const LP& _laserPoint ) {
     point = _laserPoint.point;
-    redColor = _laserPoint.redColor;
+    laserMask = _laserPoint.laserMask;
   }
 
-  void setColorOn() {
-    redColor = true;
+  void setLaserOn(uint8_t _laserIndex) {
+    laserMask |= (1 << _laserIndex);
   }
-  void setColorOff() {
-    redColor = false;
+  void setLaserOff(uint8_t _laserIndex) {
+    laserMask &= ~(1 << _laserIndex);
   }
-  void setColor(bool _val) {
-    redColor = _val;
+  void setLaserMask(uint8_t _mask) {
+    laserMask = _mask;
   }
 };
 
@@ -0,0 +1,54 @@
+#ifndef _RING_BUFFER_H
+#define _RING_BUFFER_H
+
+#include "Arduino.h"
+
+// Fixed size FIFO (no dynamic allocation). It is lock-free for ONE producer and ONE consumer:
+// push() and pop() can be called from different contexts (ex: an ISR and loop()) without
+// disabling interrupts, since the producer only writes the head and the consumer the tail.
+// * NOTE : SIZE must be a power of 2; the capacity is SIZE - 1 items.
+template <class T, uint16_t SIZE>
+class RingBuffer
+{
+    static_assert((SIZE & (SIZE - 1)) == 0, "RingBuffer SIZE must be a power of 2");
+
+public:
+    RingBuffer() : head(0), tail(0) {}
+
+    // Producer side:
+    inline bool push(const T &_item)
+    {
+        uint16_t next = (head + 1) & MASK;
+        if (next == tail)
+            return (false); // full
+        data[head] = _item;
+        __asm__ __volatile__("" ::: "memory"); // the item must be written before publishing it
+        head = next;
+        return (true);
+    }
+
+    // Consumer side:
+    inline bool pop(T &_item)
+    {
+        if (tail == head)
+            return (false); // empty
+        _item = data[tail];
+        __asm__ __volatile__("" ::: "memory");
+        tail = (tail + 1) & MASK;
+        return (true);
+    }
+    inline const T &peek() const { return (data[tail]); } // check isEmpty() first!
+    inline void clear() { tail = head; }
+
+    inline uint16_t available() const { return ((head - tail) & MASK); }
+    inline bool isEmpty() const { return (head == tail); }
+    inline bool isFull() const { return (((head + 1) & MASK) == tail); }
+    inline uint16_t capacity() const { return (SIZE - 1); }
+
+private:
+    static const uint16_t MASK = SIZE - 1;
+    T data[SIZE];
+    volatile uint16_t head, tail;
+};
+
+#endif
@@ -6,4 +6,7 @@ uint8_t InputTrigger::id_counter = 0;
 uint8_t OutputTrigger::id_counter = 0;
 uint8_t TriggerProcessor::id_counter = 0;
 uint8_t Pulsar::id_counter = 0;
+uint8_t LogicGate::id_counter = 0;
+uint8_t Waveform::id_counter = 0;
+uint8_t DelayLine::id_counter = 0;
 // ATTN do not forget to do the definition and incrementt in the laser module.
@@ -3,8 +3,11 @@
 #define _Class_Sequencer_H_
 
 #include "Arduino.h"
+#include "Class_RingBuffer.h"
 #include "Definitions.h"
 #include "Utils.h"
+#include "fastMath.h"
+#include "packedLogic.h"
 
 /* BASE CLASS InOutModule is used to be able to collect - as base class pointers - all the objects that
  have callable "setIn" or "getOut" methods (ex: for a laser object, we call setInput using the "bang"
@@ -45,7 +48,14 @@ or even cascades:
                                                   |
                                                    --> [ Clock 1 ] --> [ Trigger Processor ] --> [ Laser 2 ]
 
-    TODO: - Add blinking led nodes (for debug and message), logical modules (and, or, xor), and most interestingly,
+    Logic gates (class LogicGate) have several inputs: each link to a gate adds an input, so interlocks are
+    resolved on the board (ex: the laser fires only when the camera is exposing AND the clock is high):
+
+        [ "Trigger" Input ] --> [ Logic gate (and) ] --> [ Laser 2 ]
+                                        |
+        [ Clock 1 ] ---------------------
+
+    TODO: - Add blinking led nodes (for debug and message), and most interestingly,
           make inter-module messages that are "analog" (ramps, etc) that could be useful to control the microscope state.
           - Cyclic graphs would be possible (the information wil advance by clocked or triggered time steps, as we update
            all the nodes *simultaneously* using their previous values in the main loop). This presents a slight problem
@@ -57,6 +67,19 @@ or even cascades:
                                                      <-------------------- < ------------------------
 */
 
+// Time of an event: micros() time base, and the count of the one shot timer (ONE_SHOT_TICKS_PER_US) when the
+// event was timestamped by the hardware (input trigger edges):
+struct EventTime
+{
+    uint32_t us;
+    uint32_t ticks; // valid if hasTicks
+    bool hasTicks;
+};
+
+// Hardware edges (check Hardware::OneShots): the pin of the channel changes to _level at _offsetTicks after
+// the event, with the resolution of the timer rather than the sequencer tick. Returns false if the edge is lost:
+typedef bool (*EdgeScheduler)(uint8_t _channel, const EventTime &_time, uint32_t _offsetTicks, bool _level);
+
 class Module
 {
     /*
@@ -90,11 +113,23 @@ class Module
         reset();
     }
 
-    void start() { active = true; }
+    void start()
+    {
+        active = true;
+        dirty = true;
+    }
     void stop() { active = false; }
-    virtual void setActive(bool _active) { active = _active; } // note: this can be overloaded, so as to be able to
+    virtual void setActive(bool _active)
+    {
+        active = _active;
+        dirty = true;
+    } // note: this can be overloaded, so as to be able to
     // set the parameters when not active depending on the module (for instance, for the laser this is OFF)
-    void toggleActive() { active = !active; }
+    void toggleActive()
+    {
+        active = !active;
+        dirty = true;
+    }
     bool isActive() { return (active); }
 
     // Base class reset (the children can use it as default, or override it to complement it,
@@ -110,21 +145,51 @@ class Module
         output = nextOutput = false;
         state = nextState = false;
         firstTime = true; // this is used if something special has to happen the first time.
+        dirty = true;     // evaluate the module at the next tick
+        eventTime = nextEventTime = micros();
+        ticksValid = nextTicksValid = false;
     }
 
     virtual String getName() = 0;
+    virtual uint8_t getClassIndex() = 0; // class index and myID identify the module (same as the parser commands)
+    virtual uint8_t getID() = 0;
     virtual String getParamString() = 0;
 
     // Module equality (will be done through the name, but simple string comparison)
     bool isEqual(Module *_toPtr) { return (_toPtr->getName() == getName()); }
 
-    void setInputLink(Module *_ptr_fromModule) { ptr_fromModule = _ptr_fromModule; }
-    void clearInputLink() { ptr_fromModule = NULL; }
-    Module *getPtrModuleFrom() { return (ptr_fromModule); }
+    // NOTE: virtual because some modules have more than one input (the links add inputs to logic gates).
+    // Returns false if the input could not be linked:
+    virtual bool setInputLink(Module *_ptr_fromModule)
+    {
+        ptr_fromModule = _ptr_fromModule;
+        dirty = true;
+        return (true);
+    }
+    virtual void clearInputLink()
+    {
+        ptr_fromModule = NULL;
+        dirty = true;
+    }
+    Module *getPtrModuleFrom() { return (ptr_fromModule); } // the first input
+
+    // All the inputs (for the sequencer: evaluation order, propagation of the changes...):
+    virtual uint8_t getNumInputLinks() { return (ptr_fromModule != NULL ? 1 : 0); }
+    virtual Module *getInputLink(uint8_t _index) { return (ptr_fromModule); }
+    bool hasInputLink(Module *_ptrModule)
+    {
+        for (uint8_t k = 0; k < getNumInputLinks(); k++)
+            if (getInputLink(k) == _ptrModule)
+                return (true);
+        return (false);
+    }
 
     // Get the output of the module (for the time being, a boolean) for using it
     // in the next module in the chain.
     bool getOutputState() { return (output); }
+    uint32_t getEventTime() { return (eventTime); }
+    uint32_t getEventTicks() { return (eventTicks); } // only if hasEventTicks()
+    bool hasEventTicks() { return (ticksValid); }
 
     // NOTE 1: we need to first call update(), then refreshStates() for all modules in that order
     // (of course some modules do not need to implement some of those methods, since the (output)
@@ -141,8 +206,15 @@ class Module
         {
 
             bool inputFrom = false;
-            if (ptr_fromModule != NULL)                       // NOTE: if the module is not connected, inputFrom defaults to NULL.
+            nextEventTime = micros();
+            nextTicksValid = false;
+            if (ptr_fromModule != NULL) // NOTE: if the module is not connected, inputFrom defaults to NULL.
+            {
                 inputFrom = ptr_fromModule->getOutputState(); // get the output of the preceding module at time t-1
+                nextEventTime = ptr_fromModule->getEventTime();
+                nextEventTicks = ptr_fromModule->getEventTicks();
+                nextTicksValid = ptr_fromModule->hasEventTicks();
+            }
 
             computeNextState(inputFrom); // will compute nextOutput, nextInput and nextState
 
@@ -174,21 +246,75 @@ class Module
 
     // ***** REFRESH *****
     //This method is necessary so that the modules are updated in time steps, but "in parallel".
-    void refreshStates()
+    // It returns true if the output changed (then the modules connected to this one have to be evaluated).
+    bool refreshStates()
     {
+        bool changed = (output != nextOutput);
+        if (changed)
+        {
+            eventTime = nextEventTime;
+            eventTicks = nextEventTicks;
+            ticksValid = nextTicksValid;
+        }
         output = nextOutput;
         input = nextInput;
         state = nextState;
+        return (changed);
     }
 
+    // ***** EVENT DRIVEN EVALUATION *****
+    // The sequencer does not update all the modules at each tick, but only those that may change:
+    //  - "dirty" modules: their input changed, or their own output changed at the previous tick (so
+    //    transient outputs such as the "bangs" of the trigger processor go back to rest), or they were
+    //    reset or reconfigured.
+    //  - time driven modules (clocks, pulsars) whose deadline has passed (next time their output may
+    //    change by itself)
+    //  - polled modules (ex: reading a pin), evaluated at every tick.
+    void setDirty() { dirty = true; }
+    bool isDirty() { return (dirty); }
+    void clearDirty() { dirty = false; }
+    virtual bool isPolled() { return (false); }
+    virtual bool hasDeadline() { return (false); }
+    virtual uint32_t getDeadline() { return (0); } // in us (micros() time base), only if hasDeadline()
+
+    // Modules that can output their edges on a hardware channel (NULL scheduler to unbind). Returns false if
+    // the module has no edges to schedule:
+    virtual bool setEdgeOutput(EdgeScheduler _scheduler, uint8_t _channel) { return (false); }
+
+    bool isDue(uint32_t _now)
+    {
+        return (dirty || isPolled() || (hasDeadline() && ((int32_t)(_now - getDeadline()) >= 0)));
+    }
+
+    // Output computed by the packed evaluation of the compiled pipeline (check packedLogic.h), instead of
+    // update() and refreshStates():
+    void setPackedOutput(bool _output, uint32_t _eventTime, uint32_t _eventTicks, bool _ticksValid)
+    {
+        output = nextOutput = _output;
+        eventTime = nextEventTime = _eventTime;
+        eventTicks = nextEventTicks = _eventTicks;
+        ticksValid = nextTicksValid = _ticksValid;
+        firstTime = false;
+    }
+
+    bool pendingRefresh = false; // evaluated during the current tick (used by the sequencer)
+
   protected:
     bool firstTime;
     bool active;
+    bool dirty;
 
     bool output, nextOutput;
     bool state, nextState;
     bool input, nextInput;
 
+    // Time of the event that caused the last change of output (in us, micros() time base). By default it is
+    // the event time of the input module, but the modules that generate events set the true time:
+    uint32_t eventTime, nextEventTime;
+    // Same time in ticks of the one shot timer, when the event was timestamped by the hardware:
+    uint32_t eventTicks, nextEventTicks;
+    bool ticksValid, nextTicksValid;
+
     Module *ptr_fromModule;
 };
 
@@ -219,6 +345,10 @@ class Clock : public Module
     NOTE: the clock is an example of a module that *could* not use an internal state. However, I will use it in case
         we want to do some action only when there is a change of state.
 
+    NOTE: the software clock accumulates its phase (clockTimer += periodUs), so the late ticks do not add up.
+          For jitter-free edges, a clock can also be bound to a PIT channel (Hardware::Clocks::bindTimer): the
+          timer ISR toggles the pin, and the pipeline just follows the state set by the ISR.
+
     */
 
   public:
@@ -252,23 +382,84 @@ class Clock : public Module
     {
         Module::reset();       // call the base reset()
         clockTimer = micros(); // reset of things proper to this child class.
+        if (ptr_hardwareTimer)
+        { // restart the phase of the hardware edges:
+            hardwareState = false;
+            digitalWriteFast(hardwarePin, LOW);
+            // NOTE: the timer does not accept every period; the clock is then timed by software again (the
+            // timer is freed by Hardware::Clocks::checkTimers):
+            if (!ptr_hardwareTimer->begin(hardwareISR, periodUs))
+            {
+                ptr_hardwareTimer->end();
+                ptr_hardwareTimer = NULL;
+            }
+        }
     }
 
     String getName() { return (myName + "[" + String(myID) + "]"); }
+    uint8_t getClassIndex() { return (myClassIndex); }
+    uint8_t getID() { return (myID); }
     String getParamString()
     {
-        return ("{state=" + Definitions::binaryNames[active] + ", period=" + String(periodUs) + "us}");
+        return ("{state=" + Definitions::binaryNames[active] + ", period=" + String(periodUs) + "us" +
+                (ptr_hardwareTimer ? ", pin=" + String(hardwarePin) + "}" : "}"));
     }
 
+    // Hardware timed clock (check Hardware::Clocks::bindTimer). The ISR is a function that calls hardwareEdge().
+    // Returns false if the timer could not be started with the period of the clock:
+    bool setHardwareTimer(IntervalTimer *_ptrTimer, void (*_isr)(), uint8_t _pin)
+    {
+        hardwarePin = _pin;
+        pinMode(hardwarePin, OUTPUT);
+        hardwareISR = _isr;
+        ptr_hardwareTimer = _ptrTimer;
+        reset();
+        return (ptr_hardwareTimer != NULL);
+    }
+    void clearHardwareTimer()
+    {
+        if (ptr_hardwareTimer)
+            ptr_hardwareTimer->end();
+        ptr_hardwareTimer = NULL;
+        reset();
+    }
+    bool isHardwareTimed() { return (ptr_hardwareTimer != NULL); }
+
+    // Called from the timer ISR. The timer keeps running when the clock is not active, so the edges stay
+    // locked to the same phase:
+    inline void hardwareEdge()
+    {
+        if (active)
+        {
+            hardwareState = !hardwareState;
+            digitalWriteFast(hardwarePin, hardwareState);
+            dirty = true;
+        }
+    }
+
+    // The output toggles when micros() - clockTimer >= periodUs (if not timed by hardware):
+    bool hasDeadline() override { return (active && !ptr_hardwareTimer); }
+    uint32_t getDeadline() override { return (clockTimer + periodUs); }
+
     // **** EVOLUTION ****
     void computeNextState(bool _inputFrom) override
     {
-        if (micros() - clockTimer > periodUs)
+        if (ptr_hardwareTimer)
+        { // NOTE: if the period is shorter than the tick, some edges are not seen by the pipeline
+            nextState = hardwareState;
+            nextOutput = nextState;
+        }
+        else if (micros() - clockTimer >= periodUs)
         {
             // we could do nextOutput =!output, but this is for clarity (other logical function could be performed):
             nextState = !state;
+            nextEventTime = clockTimer + periodUs;
 
-            clockTimer = micros();
+            // Phase accumulation: the next edge does not depend on how late this one was seen...
+            clockTimer += periodUs;
+            // ...unless the clock missed a whole period (ex: the sequencer was stopped), then it starts again:
+            if (micros() - clockTimer >= periodUs)
+                clockTimer = micros();
 
             // And the nextOutput is:
             nextOutput = nextState;
@@ -276,8 +467,8 @@ class Clock : public Module
     }
 
     void action() override
-    {
-        digitalWrite(PIN_LED_DEBUG, output); // -test-
+    { // NOTE: no led write here: the action runs in the sequencer ISR, and the leds play their blink patterns
+        // digitalWrite(PIN_LED_DEBUG, output); // -test-
     }
 
     // ==================================================================================================
@@ -290,6 +481,21 @@ class Clock : public Module
 
     uint32_t periodUs = 100000; // in us
     uint32_t clockTimer;      // in us
+
+    IntervalTimer *ptr_hardwareTimer = NULL;
+    void (*hardwareISR)();
+    uint8_t hardwarePin;
+    volatile bool hardwareState = false;
+};
+
+#define SIZE_EDGE_QUEUE 16 // edges captured by the interrupt and not yet seen by the sequencer (power of 2)
+
+struct TriggerEdge
+{
+    uint32_t time;  // micros() at the interrupt
+    uint32_t ticks; // count of the one shot timer at the interrupt (if hasTicks)
+    bool hasTicks;
+    bool level; // level of the pin after the edge
 };
 
 // NOTE: this is a stateless module, and it does not even depends on the previous module (btw, there
@@ -324,6 +530,7 @@ class InputTrigger : public Module
     void setInputPin(uint8_t _inputPin)
     {
         inputTriggerPin = _inputPin;
+        pinConfig = portConfigRegister(_inputPin);
         pinMode(_inputPin, INPUT_PULLUP); // or pulldown? or floating? (make a parameter?)
 
         reset(); // in this case this is equal to Module::reset() since the reset method is not oveloading here.
@@ -340,7 +547,50 @@ class InputTrigger : public Module
     // ******************** OVERRIDDEN METHODS OF THE BASE CLASS **************************************
     String getName() { return (myName + "[" + String(myID) + "]"); } // by overriding this method,
                                                                      //we ensure that we are using the myID of the derived class!
-    String getParamString() { return ("{ pin=" + String(inputTriggerPin) + "}"); }
+    uint8_t getClassIndex() { return (myClassIndex); }
+    uint8_t getID() { return (myID); }
+    String getParamString()
+    {
+        return ("{ pin=" + String(inputTriggerPin) + (interruptDriven ? ", lost edges=" + String(lostEdges) + "}" : "}"));
+    }
+
+    void reset() override
+    {
+        Module::reset();
+        edgeQueue.clear();
+    }
+
+    // Edge capture: the pin change interrupt (check Hardware::ExtTriggers::init) timestamps the edges and
+    // queues them; the sequencer then consumes one edge per tick, so even a pulse shorter than a tick is seen,
+    // and the modules downstream get the true time of the edge (getEventTime).
+    void setInterruptDriven(bool _interruptDriven)
+    {
+        lastEdgeLevel = readInput();
+        interruptDriven = _interruptDriven;
+        reset();
+    }
+
+    inline void captureEdge(uint32_t _time, uint32_t _ticks) // called from the ISR
+    {
+        bool level = digitalReadFast(inputTriggerPin);
+        if (level == lastEdgeLevel)
+        {
+            // The pin changed back before being read. If the second edge came after the interrupt flag was
+            // cleared, it has its own interrupt (pending): only the first edge is queued now.
+            queueEdge(_time, _ticks, !level);
+            if (*pinConfig & PORT_PCR_ISF)
+                level = !level;
+            else // the two edges of a very short pulse produced only one interrupt:
+                queueEdge(_time, _ticks, level);
+        }
+        else
+            queueEdge(_time, _ticks, level);
+        lastEdgeLevel = level;
+        dirty = true;
+    }
+    uint32_t getLostEdges() { return (lostEdges); }
+
+    bool isPolled() override { return (!interruptDriven); } // otherwise, the pin is read at every tick
 
     // **** EVOLUTION ****
     void computeNextState(bool _inputFrom) override // actually the input from won't be set from the input module,
@@ -348,7 +598,21 @@ class InputTrigger : public Module
     // ignored.
     {
         // everything stays the same, but nextOutput is updated (statelessly):
-        nextOutput = readInput();
+        if (interruptDriven)
+        {
+            TriggerEdge edge;
+            if (edgeQueue.pop(edge))
+            {
+                nextOutput = edge.level;
+                nextEventTime = edge.time;
+                nextEventTicks = edge.ticks;
+                nextTicksValid = edge.hasTicks;
+                if (!edgeQueue.isEmpty())
+                    dirty = true; // next edge at the next tick
+            }
+        }
+        else
+            nextOutput = readInput();
     }
 
     void action() override
@@ -364,6 +628,18 @@ class InputTrigger : public Module
     uint8_t myID;
     static uint8_t id_counter;
     uint8_t inputTriggerPin;
+    volatile uint32_t *pinConfig; // the interrupt flag of the pin (PORT_PCR_ISF)
+
+    inline void queueEdge(uint32_t _time, uint32_t _ticks, bool _level)
+    {
+        if (!edgeQueue.push({_time, _ticks, true, _level}))
+            lostEdges++;
+    }
+
+    bool interruptDriven = false;
+    volatile bool lastEdgeLevel;
+    volatile uint32_t lostEdges = 0;
+    RingBuffer<TriggerEdge, SIZE_EDGE_QUEUE> edgeQueue;
 };
 
 class OutputTrigger : public Module
@@ -405,6 +681,8 @@ class OutputTrigger : public Module
 
     // ******************** OVERRIDDEN METHODS OF THE BASE CLASS **************************************
     String getName() { return (myName + "[" + String(myID) + "]"); }
+    uint8_t getClassIndex() { return (myClassIndex); }
+    uint8_t getID() { return (myID); }
     String getParamString() { return ("{ pin=" + String(outputTriggerPin) + "}"); }
 
     // **** EVOLUTION ****
@@ -530,6 +808,8 @@ class TriggerProcessor : public Module
     // ******************** OVERRIDDEN METHODS OF THE BASE CLASS **************************************
 
     String getName() { return (myName + "[" + String(myID) + "]"); }
+    uint8_t getClassIndex() { return (myClassIndex); }
+    uint8_t getID() { return (myID); }
     String getParamString()
     {
         return ("{mode=" + Definitions::trgModeNames[mode] + ", burst=" + String(burstLength) + ", skip=" + String(skipLength) + ", offset=" + String(offsetEvents) + "}");
@@ -540,6 +820,19 @@ class TriggerProcessor : public Module
         // digitalWrite(PIN_LED_MESSAGE, output); // -test-
     }
 
+    // State for the packed evaluation of the compiled pipeline (check packedLogic.h):
+    PackedLogic::TrgState getPackedState()
+    {
+        PackedLogic::TrgState trg = {mode, input, stateMachine == SKIP_STATE, burstLength, skipLength, counterEvents};
+        return (trg);
+    }
+    void setPackedState(const PackedLogic::TrgState &_trg)
+    {
+        input = nextInput = _trg.input;
+        stateMachine = (_trg.skipping ? SKIP_STATE : BURST_STATE);
+        counterEvents = _trg.counterEvents;
+    }
+
     void computeNextState(bool _inputFrom) override
     {
         nextInput = _inputFrom;
@@ -633,9 +926,8 @@ class TriggerProcessor : public Module
 
 class Pulsar : public Module
 {
-    // TODO: the "pulse shaper" (or "pulsar") has a simple binary output;
-    // however, it would not be too difficult to have an analog output (ramps, triangle
-    // signal, even sinusoid. This may be very useful for steering the microscope stage!)
+    // NOTE: the "pulse shaper" (or "pulsar") has a simple binary output; the analog outputs (ramps, triangle
+    // signal, sinusoid...) are generated by the Waveform modules.
 
   public:
     Pulsar()
@@ -661,6 +953,8 @@ class Pulsar : public Module
     {
         Module::reset();
         timerPulsar = micros(); // +t_off_us + t_on_us; // this is to avoid
+        startPulsar = {timerPulsar, 0, false};
+        pendingDeadline = false; // computed at the next evaluation (the module is dirty)
     }
 
     void setParam(uint32_t _t_off_us, uint32_t _t_on_us)
@@ -671,35 +965,82 @@ class Pulsar : public Module
     }
 
     String getName() { return (myName + "[" + String(myID) + "]"); }
+    uint8_t getClassIndex() { return (myClassIndex); }
+    uint8_t getID() { return (myID); }
     String getParamString()
     {
-        return ("{" + String(t_off_us) + "ms, " + String(t_on_us) + "us}");
+        return ("{" + String(t_off_us) + "ms, " + String(t_on_us) + "us" +
+                (ptr_edgeScheduler ? ", lost edges=" + String(lostEdges) + "}" : "}"));
     }
 
     // ******************** OVERRIDEN METHODS OF THE BASE CLASS ***********************
+    // Deadlines: the end of the off time (output on), then the end of the on time (output off). They are
+    // computed with the output, so the off edge is always evaluated:
+    bool hasDeadline() override { return (pendingDeadline); }
+    uint32_t getDeadline() override { return (deadline); }
+
     void computeNextState(bool _inputFrom) override
     {
-        if (_inputFrom) // reset timer (only!)
-            timerPulsar = micros();
+        if (_inputFrom) // reset timer (only!). On the rising edge, from the true time of the edge:
+        {
+            if (!input)
+                startPulsar = {nextEventTime, nextEventTicks, nextTicksValid};
+            else
+                startPulsar = {micros(), 0, false};
+            timerPulsar = startPulsar.us;
+            // NOTE: the hardware pulse starts from the rising edge only (the software one is retriggered while
+            // the input stays high). A pulse ending beyond the range of the one shot timer has no hardware edges:
+            if (!input && ptr_edgeScheduler && ((uint64_t)t_off_us + t_on_us > MAX_ONE_SHOT_US))
+                lostEdges += 2;
+            else if (!input && ptr_edgeScheduler)
+            {
+                if (!ptr_edgeScheduler(edgeChannel, startPulsar, t_off_us * ONE_SHOT_TICKS_PER_US, HIGH))
+                    lostEdges++;
+                if (!ptr_edgeScheduler(edgeChannel, startPulsar, (t_off_us + t_on_us) * ONE_SHOT_TICKS_PER_US, LOW))
+                    lostEdges++;
+            }
+        }
+        nextInput = _inputFrom;
 
         // Output of the Pulsar: ON or OFF (in the future, it can be a struct also
         // containing an analog value - e.g. power ramps)
         uint32_t timePassed = micros() - timerPulsar;
         nextOutput = (timePassed > t_off_us) && (timePassed <= (t_off_us + t_on_us));
+        uint32_t edgeUs = (nextOutput ? t_off_us : t_off_us + t_on_us);
+        nextEventTime = timerPulsar + edgeUs;
+        nextEventTicks = startPulsar.ticks + edgeUs * ONE_SHOT_TICKS_PER_US;
+        nextTicksValid = startPulsar.hasTicks && (edgeUs <= MAX_ONE_SHOT_US); // (otherwise the product wraps)
+
+        pendingDeadline = (timePassed <= t_off_us + t_on_us);
+        deadline = timerPulsar + (timePassed <= t_off_us ? t_off_us : t_off_us + t_on_us) + 1;
     }
 
     void action() override
+    { // NOTE: no led write here: the action runs in the sequencer ISR, and the leds play their blink patterns
+        // digitalWrite(PIN_LED_MESSAGE, output); // -test-
+    }
+
+    bool setEdgeOutput(EdgeScheduler _scheduler, uint8_t _channel) override
     {
-        digitalWrite(PIN_LED_MESSAGE, output); // -test-
+        ptr_edgeScheduler = _scheduler;
+        edgeChannel = _channel;
+        return (true);
     }
 
     // ********************************************************************************
 
   private:
+    EdgeScheduler ptr_edgeScheduler = NULL;
+    uint8_t edgeChannel;
+
     // Pulse parameters (eventually t_off_us too, or a more complicated shape using an array)
     uint32_t t_off_us = 0;
     uint32_t t_on_us = 50000;
     uint32_t timerPulsar; // reset to micros() each time we receive a trigger signal
+    EventTime startPulsar; // the same, with the timer ticks of the trigger edge (for the hardware edges)
+    uint32_t lostEdges = 0; // hardware edges that did not fit in the queue of the channel
+    uint32_t deadline;    // next evaluation (valid if pendingDeadline)
+    bool pendingDeadline = false;
 
     String myName; // TODO: make these variables STATIC!
     uint8_t myClassIndex;
@@ -708,4 +1049,369 @@ class Pulsar : public Module
     static uint8_t id_counter;
 };
 
+// Logic function of several inputs. For a single input, AND/OR/XOR just pass it, and NOT inverts it (with more
+// inputs, NOT is a NOR).
+class LogicGate : public Module
+{
+  public:
+    LogicGate()
+    {
+        init();
+    }
+
+    void init() override
+    {
+        myID = id_counter;
+        id_counter++;
+        myClassIndex = Definitions::ClassIndexes::CLASSID_GATE;
+        myName = Definitions::classNames[myClassIndex];
+        reset();
+    }
+
+    void setFunction(uint8_t _function)
+    {
+        function = _function % NUM_GATE_FUNCTIONS;
+        reset();
+    }
+    uint8_t getFunction() { return (function); }
+
+    String getName() { return (myName + "[" + String(myID) + "]"); }
+    uint8_t getClassIndex() { return (myClassIndex); }
+    uint8_t getID() { return (myID); }
+    String getParamString()
+    {
+        return ("{" + Definitions::gateFunctionNames[function] + ", inputs=" + String(getNumInputLinks()) + "}");
+    }
+
+    // ******************** OVERRIDEN METHODS OF THE BASE CLASS ***********************
+    // Each link adds an input (the first one is the input of the base class), up to MAX_GATE_INPUTS:
+    bool setInputLink(Module *_ptr_fromModule) override
+    {
+        if ((_ptr_fromModule == NULL) || hasInputLink(_ptr_fromModule))
+            return (true);
+        if (ptr_fromModule == NULL)
+            ptr_fromModule = _ptr_fromModule;
+        else if (numExtraInputs < MAX_GATE_INPUTS - 1)
+            ptr_extraInputs[numExtraInputs++] = _ptr_fromModule;
+        else
+            return (false);
+        dirty = true;
+        return (true);
+    }
+    void clearInputLink() override
+    {
+        Module::clearInputLink();
+        numExtraInputs = 0;
+    }
+    uint8_t getNumInputLinks() override { return (ptr_fromModule != NULL ? 1 + numExtraInputs : 0); }
+    Module *getInputLink(uint8_t _index) override { return (_index ? ptr_extraInputs[_index - 1] : ptr_fromModule); }
+
+    void computeNextState(bool _inputFrom) override
+    {
+        bool val = (function == Definitions::GATE_AND) && (ptr_fromModule != NULL);
+        for (uint8_t k = 0; k < getNumInputLinks(); k++)
+        {
+            Module *ptr_input = getInputLink(k);
+            bool in = ptr_input->getOutputState();
+            if (function == Definitions::GATE_AND)
+                val &= in;
+            else if (function == Definitions::GATE_XOR)
+                val ^= in;
+            else
+                val |= in;
+            // the output changes because of the latest event:
+            if ((int32_t)(ptr_input->getEventTime() - nextEventTime) > 0)
+            {
+                nextEventTime = ptr_input->getEventTime();
+                nextEventTicks = ptr_input->getEventTicks();
+                nextTicksValid = ptr_input->hasEventTicks();
+            }
+        }
+        nextOutput = (function == Definitions::GATE_NOT ? !val : val);
+    }
+
+    // ********************************************************************************
+
+  private:
+    uint8_t function = Definitions::GATE_AND;
+    Module *ptr_extraInputs[MAX_GATE_INPUTS - 1];
+    uint8_t numExtraInputs = 0;
+
+    String myName;
+    uint8_t myClassIndex;
+    uint8_t myID;
+    static uint8_t id_counter;
+};
+
+// Analog waveform (ramp, triangle, sine or arbitrary table) written as a PWM duty on a pin (PIN_ANALOG_A/B, the
+// optotuners or the laser power pins). The binary output is true while the waveform runs, so it can be chained.
+// It starts on the rising edge of its input (from the time of the edge), or right away if it has no input, and
+// runs a number of cycles (0 = until it is reset).
+// NOTE: the phase is accumulated in 32.32 fixed point, so the samples are taken at the exact time of the tick
+// and there is no drift, whatever the tick.
+class Waveform : public Module
+{
+  public:
+    Waveform()
+    {
+        setParam(Definitions::WAVE_SINE, 1000000, 0, MAX_WAVE_LEVEL, 0);
+        init();
+    }
+
+    void init() override
+    {
+        myID = id_counter;
+        id_counter++;
+        myClassIndex = Definitions::ClassIndexes::CLASSID_WAVE;
+        myName = Definitions::classNames[myClassIndex];
+        reset();
+    }
+
+    void reset() override
+    {
+        Module::reset();
+        running = finished = false;
+        phase = 0;
+        cycles = 0;
+        value = sample(0);
+    }
+
+    void setParam(uint8_t _shape, uint32_t _periodUs, uint16_t _minValue, uint16_t _maxValue, uint32_t _numCycles)
+    {
+        shape = _shape % NUM_WAVE_SHAPES;
+        periodUs = (_periodUs ? _periodUs : 1);
+        phaseIncrement = 0xFFFFFFFFFFFFFFFFULL / periodUs; // one turn (2^64) per period
+        minValue = min(_minValue, MAX_WAVE_LEVEL);
+        maxValue = min(_maxValue, MAX_WAVE_LEVEL);
+        numCycles = _numCycles;
+        reset();
+    }
+
+    // Arbitrary shape: one period, values in [0, MAX_WAVE_LEVEL] (scaled between the min and max values):
+    void setTable(const uint16_t *_table, uint8_t _size)
+    {
+        tableSize = min(_size, (uint8_t)SIZE_WAVE_TABLE);
+        for (uint8_t k = 0; k < tableSize; k++)
+            table[k] = min(_table[k], MAX_WAVE_LEVEL);
+        reset();
+    }
+
+    void setOutputPin(int16_t _pin) { outputPin = _pin; } // -1: no pin (the value can still be read)
+    uint16_t getValue() { return (value); }
+
+    String getName() { return (myName + "[" + String(myID) + "]"); }
+    uint8_t getClassIndex() { return (myClassIndex); }
+    uint8_t getID() { return (myID); }
+    String getParamString()
+    {
+        return ("{" + Definitions::waveShapeNames[shape] + ", " + String(periodUs) + "us, " + String(minValue) + "-" +
+                String(maxValue) + ", cycles=" + String(numCycles) + ", pin=" + (outputPin < 0 ? String("none") : String(outputPin)) + "}");
+    }
+
+    // ******************** OVERRIDEN METHODS OF THE BASE CLASS ***********************
+    bool isPolled() override { return (running); } // a new sample at every tick
+
+    void computeNextState(bool _inputFrom) override
+    {
+        uint32_t now = micros();
+        if ((_inputFrom && !input) || ((ptr_fromModule == NULL) && !running && !finished))
+        {
+            running = true;
+            finished = false;
+            phase = 0;
+            cycles = 0;
+            lastTime = (ptr_fromModule != NULL ? nextEventTime : now);
+        }
+        nextInput = _inputFrom;
+
+        if (running)
+        {
+            advancePhase(now);
+            if (numCycles && (cycles >= numCycles))
+            {
+                running = false;
+                finished = true;
+                phase = 0;
+            }
+            value = sample(phase >> 32);
+        }
+        nextOutput = running;
+    }
+
+    void action() override
+    {
+        if ((outputPin >= 0) && (value != writtenValue))
+        {
+            analogWrite(outputPin, value);
+            writtenValue = value;
+        }
+    }
+    void firstTimeAction() override
+    {
+        writtenValue = value + 1; // force the first write
+        action();
+    }
+
+    // ********************************************************************************
+
+  private:
+    inline void advancePhase(uint32_t _now)
+    {
+        uint32_t dt = _now - lastTime;
+        lastTime = _now;
+        cycles += dt / periodUs; // whole periods
+        dt %= periodUs;
+        uint64_t nextPhase = phase + (uint64_t)dt * phaseIncrement;
+        if (nextPhase < phase)
+            cycles++;
+        phase = nextPhase;
+    }
+
+    // Value of the waveform for a phase in [0, 2^32[ (one period):
+    uint16_t sample(uint32_t _phase)
+    {
+        int32_t level; // in [0, 65535]
+        switch (shape)
+        {
+        case Definitions::WAVE_RAMP:
+            level = _phase >> 16;
+            break;
+        case Definitions::WAVE_TRIANGLE:
+            level = ((_phase & 0x80000000) ? ~_phase : _phase) >> 15;
+            break;
+        case Definitions::WAVE_SINE:
+            level = 32767.0f + 32767.0f * FastMath::sinIndex((_phase >> 16) * (SIN_TABLE_SIZE / 65536.0f));
+            break;
+        default: // table, with linear interpolation (it is periodic: the last value goes to the first one)
+        {
+            if (!tableSize)
+            {
+                level = 0;
+                break;
+            }
+            uint32_t position = ((uint64_t)_phase * tableSize) >> 16; // in table units (16.16)
+            uint8_t i = position >> 16;
+            int32_t a = table[i] << 4, b = table[(i + 1) % tableSize] << 4;
+            level = a + (((b - a) * (int32_t)((position & 0xFFFF) >> 1)) >> 15); // (no overflow)
+        }
+        break;
+        }
+        return (minValue + ((((int32_t)maxValue - minValue) * level) >> 16));
+    }
+
+    uint8_t shape;
+    uint32_t periodUs;
+    uint64_t phaseIncrement; // per us
+    uint16_t minValue, maxValue;
+    uint32_t numCycles;
+    uint16_t table[SIZE_WAVE_TABLE];
+    uint8_t tableSize = 0;
+    int16_t outputPin = -1;
+
+    bool running, finished;
+    uint64_t phase; // 32.32 fixed point, one turn per period
+    uint32_t cycles;
+    uint32_t lastTime;
+    uint16_t value, writtenValue;
+
+    String myName;
+    uint8_t myClassIndex;
+    uint8_t myID;
+    static uint8_t id_counter;
+};
+
+// Pure delay: the output follows the input, delayed. The software output changes at the first tick after the
+// delay, but bound to a hardware channel (Hardware::OneShots), the pin changes exactly (delay in ns).
+class DelayLine : public Module
+{
+  public:
+    DelayLine()
+    {
+        init();
+    }
+
+    void init() override
+    {
+        myID = id_counter;
+        id_counter++;
+        myClassIndex = Definitions::ClassIndexes::CLASSID_DLY;
+        myName = Definitions::classNames[myClassIndex];
+        reset();
+    }
+
+    void reset() override
+    {
+        Module::reset();
+        edgeQueue.clear();
+    }
+
+    void setDelayNs(uint32_t _delayNs)
+    {
+        delayNs = _delayNs;
+        reset();
+    }
+    uint32_t getDelayNs() { return (delayNs); }
+
+    String getName() { return (myName + "[" + String(myID) + "]"); }
+    uint8_t getClassIndex() { return (myClassIndex); }
+    uint8_t getID() { return (myID); }
+    String getParamString() { return ("{" + String(delayNs) + "ns, lost edges=" + String(lostEdges) + "}"); }
+
+    // ******************** OVERRIDEN METHODS OF THE BASE CLASS ***********************
+    bool hasDeadline() override { return (!edgeQueue.isEmpty()); }
+    uint32_t getDeadline() override { return (edgeQueue.peek().time); }
+
+    void computeNextState(bool _inputFrom) override
+    {
+        if (_inputFrom != input)
+        { // the edge goes in the line (from the true time of the input edge):
+            uint32_t delayTicks = ((uint64_t)delayNs * ONE_SHOT_TICKS_PER_US + 500) / 1000;
+            TriggerEdge edge = {nextEventTime + (delayNs + 999) / 1000, nextEventTicks + delayTicks, nextTicksValid,
+                                _inputFrom};
+            if (!edgeQueue.push(edge))
+                lostEdges++;
+            else if (ptr_edgeScheduler)
+            {
+                EventTime inputEdge = {nextEventTime, nextEventTicks, nextTicksValid};
+                if (!ptr_edgeScheduler(edgeChannel, inputEdge, delayTicks, _inputFrom))
+                    lostEdges++;
+            }
+        }
+        nextInput = _inputFrom;
+
+        // Output: one edge per tick (as the input trigger, so short pulses are not lost):
+        if (!edgeQueue.isEmpty() && ((int32_t)(micros() - edgeQueue.peek().time) >= 0))
+        {
+            TriggerEdge edge;
+            edgeQueue.pop(edge);
+            nextOutput = edge.level;
+            nextEventTime = edge.time;
+            nextEventTicks = edge.ticks;
+            nextTicksValid = edge.hasTicks;
+        }
+    }
+
+    bool setEdgeOutput(EdgeScheduler _scheduler, uint8_t _channel) override
+    {
+        ptr_edgeScheduler = _scheduler;
+        edgeChannel = _channel;
+        return (true);
+    }
+
+    // ********************************************************************************
+
+  private:
+    uint32_t delayNs = 1000;
+    RingBuffer<TriggerEdge, SIZE_DELAY_QUEUE> edgeQueue; // pending edges, in time order
+    uint32_t lostEdges = 0;
+
+    EdgeScheduler ptr_edgeScheduler = NULL;
+    uint8_t edgeChannel;
+
+    String myName;
+    uint8_t myClassIndex;
+    uint8_t myID;
+    static uint8_t id_counter;
+};
+
 #endif
@@ -0,0 +1,137 @@
+#ifndef _TOKEN_H
+#define _TOKEN_H
+
+#include "Arduino.h"
+
+// Argument or command name of a parsed message. A Token does not own its characters: it
+// points to a null terminated string in the (fixed) buffer of the parser, so parsing a command
+// does not need any heap allocation. It mimics the methods of the Arduino String that were used
+// by the command handlers (toInt, toFloat, ==, []...).
+class Token
+{
+public:
+    Token() : ptr(""), len(0) {}
+    Token(const char *_ptr, uint16_t _len) : ptr(_ptr), len(_len) {}
+
+    inline void set(const char *_ptr, uint16_t _len)
+    {
+        ptr = _ptr;
+        len = _len;
+    }
+    inline void grow() { len++; } // one more character was written after the token
+
+    inline uint16_t length() const { return (len); }
+    inline const char *c_str() const { return (ptr); }
+    inline char operator[](uint16_t _index) const { return (_index < len ? ptr[_index] : '\0'); }
+
+    inline bool operator==(const char *_str) const { return ((strncmp(ptr, _str, len) == 0) && (_str[len] == '\0')); }
+    inline bool operator!=(const char *_str) const { return (!(*this == _str)); }
+    inline bool operator==(const String &_str) const { return (*this == _str.c_str()); }
+    inline bool operator!=(const String &_str) const { return (!(*this == _str.c_str())); }
+
+    // Decimal conversions (no locale, no errno... just what the protocol needs). As with String,
+    // the conversion stops at the first character that is not part of a number:
+    inline int32_t toInt() const
+    {
+        const char *p = ptr;
+        bool negative = (*p == '-');
+        if (negative)
+            p++;
+        int32_t val = 0;
+        while ((*p >= '0') && (*p <= '9'))
+            val = 10 * val + (*p++ - '0');
+        return (negative ? -val : val);
+    }
+
+    inline float toFloat() const
+    {
+        float val = 0;
+        parseFloat(val);
+        return (val);
+    }
+
+    // The same, but false if the value is out of the range of a float (ex: "1e200"); _val is then 0:
+    inline bool parseFloat(float &_val) const
+    {
+        static const float pow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+        const char *p = ptr;
+        bool negative = (*p == '-');
+        if (negative)
+            p++;
+
+        // Mantissa as an integer (9 significant digits fit in 32 bits), and the position of the point:
+        // NOTE: 16 bits for the exponent, since a token can have hundreds of digits
+        uint32_t mantissa = 0;
+        int16_t exponent = 0, digits = 0;
+        bool point = false;
+        for (;; p++)
+        {
+            if ((*p >= '0') && (*p <= '9'))
+            {
+                if (digits < 9)
+                {
+                    mantissa = 10 * mantissa + (*p - '0');
+                    if (mantissa)
+                        digits++;
+                    if (point)
+                        exponent--;
+                }
+                else if (!point)
+                    exponent++; // digit that does not fit, but still counts
+            }
+            else if ((*p == '.') && !point)
+                point = true;
+            else
+                break;
+        }
+
+        // Optional exponent (ex: 1.5e-3), saturated (it is out of range anyway):
+        if ((*p == 'e') && (p[1] != '\0'))
+        {
+            p++;
+            bool negativeExp = (*p == '-');
+            if (negativeExp || (*p == '+'))
+                p++;
+            int16_t exp = 0;
+            while ((*p >= '0') && (*p <= '9'))
+            {
+                if (exp < 1000)
+                    exp = 10 * exp + (*p - '0');
+                p++;
+            }
+            exponent += (negativeExp ? -exp : exp);
+        }
+
+        // The value is in [10^(magnitude - 1), 10^magnitude), it must be between the smallest (denormal) float and
+        // the largest one:
+        _val = 0;
+        if (mantissa == 0)
+            return (true);
+        int16_t magnitude = digits + exponent;
+        if ((magnitude > 39) || (magnitude < -44))
+            return (false);
+
+        float val = mantissa;
+        while (exponent > 10)
+        {
+            val *= pow10[10];
+            exponent -= 10;
+        }
+        while (exponent < -10)
+        {
+            val /= pow10[10];
+            exponent += 10;
+        }
+        val = (exponent >= 0 ? val * pow10[exponent] : val / pow10[-exponent]);
+        if (isinf(val))
+            return (false);
+        _val = (negative ? -val : val);
+        return (true);
+    }
+
+private:
+    const char *ptr;
+    uint16_t len;
+};
+
+#endif
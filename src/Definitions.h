@@ -110,6 +110,19 @@ const uint8_t pinPowerOptoTuner[NUM_OPTOTUNERS]{29, 30}; // these are PWM pins c
 // Arbitrary number...
 #define NUM_PULSARS 4
 
+// ======================== LOGIC GATES (and, or, xor, not) ======================
+#define NUM_LOGIC_GATES 4
+#define MAX_GATE_INPUTS 4
+
+// ======================== WAVEFORMS (analog outputs) ===========================
+#define NUM_WAVEFORMS 2
+#define SIZE_WAVE_TABLE 32         // points of an arbitrary waveform
+#define MAX_WAVE_LEVEL (uint16_t)4095 // same resolution as the PWM (RES_PWM)
+
+// ======================== DELAY LINES ==========================================
+#define NUM_DELAY_LINES 4
+#define SIZE_DELAY_QUEUE 16 // edges in the line (power of 2)
+
 // =========== OTHER PWM pins exposed in the D25 connector  ====================
 // NOTE : there is yet no wrapper associated to these pins: they are
 // just exposed in the connector. In the case of digital pins, they can be switched on/off
@@ -124,6 +137,20 @@ const uint8_t pinPowerOptoTuner[NUM_OPTOTUNERS]{29, 30}; // these are PWM pins c
 #define PIN_DIGITAL_A 31
 #define PIN_DIGITAL_B 32
 
+// * ONE SHOT OUTPUTS (compare channels 0 and 1 of the FTM1 timer, check Hardware::OneShots):
+// NOTE: these are fixed by the hardware (Teensy 3.5/3.6); on the Teensy 3.1/3.2 and LC, the pin 3 is PIN_ADCY,
+// so there are no one shot outputs.
+#if defined TEENSY_35_36
+#define USING_ONE_SHOTS
+#define PIN_ONE_SHOT_A 3
+#define PIN_ONE_SHOT_B 4
+#endif
+// The timer also timestamps the input trigger edges (the hardware edges derived from them have no jitter):
+#define ONE_SHOT_PRESCALER 2 // F_BUS / 4 (15MHz, 67ns with F_BUS = 60MHz)
+#define ONE_SHOT_TICKS_PER_US ((F_BUS / 1000000) >> ONE_SHOT_PRESCALER)
+// Longest offset of an edge from its event (the ticks are compared as signed 32 bits, ~143s at 15MHz):
+#define MAX_ONE_SHOT_US (0x7FFFFFFFUL / ONE_SHOT_TICKS_PER_US)
+
 // * TRIGGER PIN (bidirectional?)
 #define PIN_TRIGGER_OUTPUT 22  // pin 12 in D25 ILDA connector
 #define PIN_TRIGGER_INPUT 23 // pi 21 in D25 ILDA connector (this is DB-, but it should then not be connected to GND)
@@ -173,7 +200,7 @@ const String laserNames[NUM_LASERS]{"red", "green", "blue", "deep_blue"};
 // NOTE: unfortunately there is no implementation of stl::map in Arduino ("dictionnaries" in Python)
 //const std::map<String, int> classMap = { {"*", 0}, {"clk", 0}, {"in", 1}, {"out", 2}, {"las", 3}, {"trg", 4}, {"pul", 2} };
 // ... so I will need to traverse the array to find the index when searching from the name (during parsing)
-#define NUM_MODULE_CLASSES 7
+#define NUM_MODULE_CLASSES 10
 enum ClassIndexes
 {
     CLASSID_BASE = 0,
@@ -182,14 +209,39 @@ enum ClassIndexes
     CLASSID_OUT,
     CLASSID_LAS,
     CLASSID_TRG,
-    CLASSID_PUL
+    CLASSID_PUL,
+    CLASSID_GATE,
+    CLASSID_WAVE,
+    CLASSID_DLY
 };
-const String classNames[NUM_MODULE_CLASSES]{"*", "clk", "in", "out", "las", "trg", "pul"}; // "*" is for the base class...
+const String classNames[NUM_MODULE_CLASSES]{"*", "clk", "in", "out", "las", "trg", "pul", "gate", "wave", "dly"}; // "*" is for the base class...
 
 // * TRIGGER MODES:
 #define NUM_TRIG_MODES 3
 const String trgModeNames[NUM_TRIG_MODES]{"rise", "fall", "change"};
 
+// * LOGIC GATE FUNCTIONS:
+#define NUM_GATE_FUNCTIONS 4
+enum GateFunctions
+{
+    GATE_AND = 0,
+    GATE_OR,
+    GATE_XOR,
+    GATE_NOT
+};
+const String gateFunctionNames[NUM_GATE_FUNCTIONS]{"and", "or", "xor", "not"};
+
+// * WAVEFORM SHAPES:
+#define NUM_WAVE_SHAPES 4
+enum WaveShapes
+{
+    WAVE_RAMP = 0,
+    WAVE_TRIANGLE,
+    WAVE_SINE,
+    WAVE_TABLE
+};
+const String waveShapeNames[NUM_WAVE_SHAPES]{"ramp", "tri", "sin", "table"};
+
 // * binary values ON/OFF:
 const String binaryNames[2]{"off", "on"};
 
@@ -19,10 +19,10 @@ bool isDigit(const char _val)
 }
 
 // check if ALL the characters are small cap (then an acceptable command argument)
-bool isSmallCaps(const String _arg)
+bool isSmallCaps(const Token &_arg)
 {
 	bool ismall = true;
-	for (uint8_t k = 0; k < _arg.length(); k++)
+	for (uint16_t k = 0; k < _arg.length(); k++)
 	{
 		char val = _arg[k];
 		if ((val < 'a') || (val > 'z'))
@@ -32,13 +32,14 @@ bool isSmallCaps(const String _arg)
 	return (ismall);
 }
 
-bool isNumber(const String _str)
+bool isNumber(const Token &_str)
 {
-	// the check is very simple here: it will just verify on the first character!
-	return (isDigit(_str[0]));
+	// the check is very simple here: it will just verify on the first character (and that the value fits in a float)!
+	float val;
+	return (isDigit(_str[0]) && _str.parseFloat(val));
 }
 
-bool areNumbers(uint8_t _numArgs, const String _argStack[])
+bool areNumbers(uint8_t _numArgs, const Token _argStack[])
 {
 	bool isOk = true;
 	for (uint8_t k = 0; k < _numArgs; k++)
@@ -5,16 +5,27 @@
 
 #include "Arduino.h"
 #include "Definitions.h" // Program constants and MACROS (including hardware stuff)
+#include "Class_Token.h"
+#include "logger.h"
 
 // Use digitalWriteFast instead of digitalWrite? (uncomment to use default one in Arduino.h)
 #define digitalWrite(PIN, VAL) ( __builtin_constant_p(PIN) ? digitalWriteFast(PIN, (VAL)) : (digitalWrite)(PIN, (VAL)) )
 
 #define DEFAULT_VERBOSE_MODE true // can be changed by sofware (using Utils:setVerboseMode(...))
 
-// Useful serial print methods:
+// Useful serial print methods (asynchronous, check logger.h):
 #define PRINT(STRING) (Hardware::print(STRING))
 #define PRINTLN(STRING) (Hardware::println(STRING))
 
+// Debug level messages, removed at compile time when LOG_MIN_LEVEL is above LOG_LEVEL_DEBUG:
+#if LOG_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define PRINT_DEBUG(STRING) (Hardware::print(STRING, LOG_LEVEL_DEBUG))
+#define PRINTLN_DEBUG(STRING) (Hardware::println(STRING, LOG_LEVEL_DEBUG))
+#else
+#define PRINT_DEBUG(STRING) ((void)0)
+#define PRINTLN_DEBUG(STRING) ((void)0)
+#endif
+
 #define DEBUG_MODE_SERIAL // by defining this, we can debug on the serial port
 //#define DEBUG_MODE_LCD  // for using the LCD panel
 #define DEBUG_MODE_TFT // for using the TFT panel
@@ -36,10 +47,10 @@ extern bool recordingScript;
 
 extern void setVerboseMode(bool _active);
 
-extern bool isNumber(String _str);
-extern bool areNumbers(uint8_t _numArgs, const String _argStack[]);
+extern bool isNumber(const Token &_str);
+extern bool areNumbers(uint8_t _numArgs, const Token _argStack[]);
 extern bool isDigit(char _val);
-extern bool isSmallCaps(String _arg);
+extern bool isSmallCaps(const Token &_arg);
 
 } // namespace Utils
 #endif
@@ -0,0 +1,41 @@
+#include "commandLookup.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace CommandLookup
+{
+
+// The entries start with their name:
+static inline const char *nameOf(const void *_entry) { return (*(const char *const *)_entry); }
+
+static int compareEntries(const void *_a, const void *_b)
+{
+  return (strcmp(nameOf(_a), nameOf(_b)));
+}
+
+static int compareName(const void *_key, const void *_entry)
+{
+  return (strcmp((const char *)_key, nameOf(_entry)));
+}
+
+void sortByName(void *_table, uint16_t _numEntries, size_t _sizeEntry)
+{
+  qsort(_table, _numEntries, _sizeEntry, compareEntries);
+}
+
+int16_t findByName(const char *_name, const void *_table, uint16_t _numEntries, size_t _sizeEntry)
+{
+  const void *ptrEntry = bsearch(_name, _table, _numEntries, _sizeEntry, compareName);
+  return (ptrEntry ? int16_t(((const char *)ptrEntry - (const char *)_table) / _sizeEntry) : -1);
+}
+
+int16_t findDuplicate(const void *_table, uint16_t _numEntries, size_t _sizeEntry)
+{
+  const char *ptrEntry = (const char *)_table;
+  for (uint16_t k = 1; k < _numEntries; k++)
+    if (!strcmp(nameOf(ptrEntry + (k - 1) * _sizeEntry), nameOf(ptrEntry + k * _sizeEntry)))
+      return (k);
+  return (-1);
+}
+
+} // namespace CommandLookup
@@ -0,0 +1,24 @@
+#ifndef _COMMAND_LOOKUP_H_
+#define _COMMAND_LOOKUP_H_
+
+// Lookup of a command by its name in a table sorted once (qsort), with a binary search (bsearch): about
+// log2(number of commands) string comparisons, instead of going through the whole list.
+// NOTE: it does not depend on the Arduino core (the command table of the parser has handlers taking Tokens),
+// so the entries are only required to start with their name (const char *), and the table is passed with
+// the size of its entries. This way it can be checked and timed on the host (check test/test_dispatch).
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace CommandLookup
+{
+
+extern void sortByName(void *_table, uint16_t _numEntries, size_t _sizeEntry);
+// Index of the entry, or -1 if not found (the table must be sorted):
+extern int16_t findByName(const char *_name, const void *_table, uint16_t _numEntries, size_t _sizeEntry);
+// Index of the first entry with the same name as the previous one (unreachable entry), or -1 if none:
+extern int16_t findDuplicate(const void *_table, uint16_t _numEntries, size_t _sizeEntry);
+
+} // namespace CommandLookup
+
+#endif
@@ -1,6 +1,7 @@
 
 #include "messageParser.h" // TODO rename as "parser.h"
 #include "dataCom.h"
+#include "logger.h"
 #include "Definitions.h"
 
 namespace Com
@@ -10,13 +11,200 @@ namespace Com
 // OSC, ETHERNET....)
 // ...
 
-String receivedMessage;
+char receivedMessage[MAX_LENGTH_MESSAGE + 1];
 bool requestACK = false;
 
+// Send the compact reply of the pipelined protocol.
+// NOTE: the reply goes through the logger (always enabled level, so it does not depend on the verbose
+// mode), so it is never sent before the messages printed while executing the command:
+static void sendReply(bool _hasSeq, uint32_t _seq, bool _executed, uint8_t _error)
+{
+  char reply[24];
+  uint8_t length = 0;
+  reply[length++] = REPLY_PREFIX;
+  reply[length++] = (_executed ? 'A' : 'N');
+  if (_hasSeq)
+    length += snprintf(reply + length, sizeof(reply) - length, "%lu", (unsigned long)_seq);
+  if (!_executed)
+    length += snprintf(reply + length, sizeof(reply) - length, ",%u", _error);
+  reply[length++] = '\n';
+  reply[length] = '\0';
+  Logger::write(LOG_LEVEL_ALWAYS, reply);
+}
+
+// ======== TIMESTAMPED MESSAGES =============================================
+// Binary min-heap on the execution time; the messages themselves stay in fixed slots (only
+// small entries are moved in the heap):
+struct ScheduledEntry
+{
+  uint32_t time;
+  uint32_t order; // reception order, for messages with the same time
+  uint8_t slot;
+};
+ScheduledEntry scheduleHeap[SIZE_SCHEDULE];
+uint8_t numScheduled = 0;
+char scheduledText[SIZE_SCHEDULE][MAX_LENGTH_SCHEDULED + 1];
+uint8_t freeSlots[SIZE_SCHEDULE];
+uint32_t scheduleOrder = 0;
+uint32_t maxLateness = 0; // worst delay between the time of a message and its execution
+
+// NOTE: wrap-around safe comparisons of the times:
+static inline bool isBefore(const ScheduledEntry &_a, const ScheduledEntry &_b)
+{
+  int32_t dt = (int32_t)(_a.time - _b.time);
+  return ((dt < 0) || ((dt == 0) && ((int32_t)(_a.order - _b.order) < 0)));
+}
+
+bool scheduleMessage(uint32_t _time, const char *_message)
+{
+  if (numScheduled == SIZE_SCHEDULE)
+    return (false);
+
+  // The free slots are the ones after numScheduled in the freeSlots array:
+  uint8_t slot = freeSlots[numScheduled];
+  strncpy(scheduledText[slot], _message, MAX_LENGTH_SCHEDULED);
+  scheduledText[slot][MAX_LENGTH_SCHEDULED] = '\0';
+
+  ScheduledEntry entry = {_time, scheduleOrder++, slot};
+  uint8_t k = numScheduled++;
+  while (k > 0)
+  { // sift up
+    uint8_t parent = (k - 1) / 2;
+    if (!isBefore(entry, scheduleHeap[parent]))
+      break;
+    scheduleHeap[k] = scheduleHeap[parent];
+    k = parent;
+  }
+  scheduleHeap[k] = entry;
+  return (true);
+}
+
+static void popScheduled()
+{
+  freeSlots[--numScheduled] = scheduleHeap[0].slot;
+  ScheduledEntry last = scheduleHeap[numScheduled];
+  uint8_t k = 0;
+  while (true)
+  { // sift down
+    uint8_t child = 2 * k + 1;
+    if (child >= numScheduled)
+      break;
+    if ((child + 1 < numScheduled) && isBefore(scheduleHeap[child + 1], scheduleHeap[child]))
+      child++;
+    if (!isBefore(scheduleHeap[child], last))
+      break;
+    scheduleHeap[k] = scheduleHeap[child];
+    k = child;
+  }
+  scheduleHeap[k] = last;
+}
+
+void clearSchedule()
+{
+  numScheduled = 0;
+  maxLateness = 0;
+  for (uint8_t k = 0; k < SIZE_SCHEDULE; k++)
+    freeSlots[k] = k;
+}
+
+uint8_t getNumScheduled() { return (numScheduled); }
+uint32_t getMaxLateness() { return (maxLateness); }
+
+// Executes the next message if its time has come (false otherwise):
+static bool runScheduled()
+{
+  int32_t lateness;
+  if (!numScheduled || ((lateness = (int32_t)(micros() - scheduleHeap[0].time)) < 0))
+    return (false);
+  if ((uint32_t)lateness > maxLateness)
+    maxLateness = lateness;
+
+  // Copy the message, since executing it may schedule others (or clear the queue):
+  char message[MAX_LENGTH_SCHEDULED + 1];
+  strcpy(message, scheduledText[scheduleHeap[0].slot]);
+  popScheduled();
+  Parser::parseStringMessage(message);
+  return (true);
+}
+
+// Optional sequence number, _message is moved after it (false if the prefix is not followed by the separator):
+static bool readSeq(const char *&_message, bool &_hasSeq, uint32_t &_seq)
+{
+  _hasSeq = (*_message == SEQ_PREFIX);
+  _seq = 0;
+  if (_hasSeq)
+  {
+    _message++;
+    while ((*_message >= '0') && (*_message <= '9'))
+      _seq = 10 * _seq + (*_message++ - '0');
+    if (*_message != SEQ_SEPARATOR)
+      return (false);
+    _message++;
+  }
+  return (true);
+}
+
+static void executeMessage(const char *_message)
+{
+  bool hasSeq;
+  uint32_t seq;
+  if (!readSeq(_message, hasSeq, seq))
+  {
+    sendReply(true, seq, false, Parser::ERR_BAD_PACKET);
+    return;
+  }
+
+  // Optional execution time:
+  if (*_message == TIME_PREFIX)
+  {
+    uint32_t time = micros();
+    bool relative = (*(++_message) == TIME_RELATIVE);
+    if (relative)
+      _message++;
+    uint32_t value = 0;
+    while ((*_message >= '0') && (*_message <= '9'))
+      value = 10 * value + (*_message++ - '0');
+    time = (relative ? time + value : value);
+
+    Parser::ParserError error = Parser::ERR_NONE;
+    if (*_message++ != SEQ_SEPARATOR)
+      error = Parser::ERR_BAD_PACKET;
+    else if (strlen(_message) > MAX_LENGTH_SCHEDULED)
+      error = Parser::ERR_TOO_LONG;
+    else if (!scheduleMessage(time, _message))
+      error = Parser::ERR_QUEUE_FULL;
+
+    if (error != Parser::ERR_NONE)
+      PRINTLN("> NOT SCHEDULED");
+    if (hasSeq || requestACK)
+      sendReply(hasSeq, seq, (error == Parser::ERR_NONE), error);
+    return;
+  }
+
+  bool executed = Parser::parseStringMessage(_message); //parse AND calls the appropiate functions
+
+  if (hasSeq || requestACK)
+    sendReply(hasSeq, seq, executed, Parser::lastError);
+}
+
 // Common methods:
 void update() {
-  ReceiverSerial::receive();
-  // TODO: other com methods (use an "#if def...)
+  elapsedMicros timeSlice = 0;
+
+  // Timestamped messages that are due first, then the received commands, then the running script (if any),
+  // until the time budget is exhausted:
+  do
+  {
+    ReceiverSerial::receive();
+    // TODO: other com methods (use an "#if def...)
+
+    if (runScheduled())
+      continue;
+    else if (ReceiverSerial::nextMessage())
+      executeMessage(receivedMessage);
+    else if (!Parser::stepScript())
+      break; // nothing to do (no script running, or waiting)
+  } while (timeSlice < COM_UPDATE_TIME_BUDGET);
 }
 
 void setAckMode(bool _mode) {requestACK = _mode; }
@@ -25,15 +213,20 @@ bool getAckMode() { return (requestACK); }
 namespace ReceiverSerial
 {
 
+RingBuffer<char, SIZE_RX_BUFFER> rxBuffer;
+uint16_t lengthMessage = 0;
+
 void init()
 {
   Serial.begin(SERIAL_BAUDRATE);
-  receivedMessage.reserve(MAX_LENGTH_MESSAGE);
-  receivedMessage = "";
+  receivedMessage[0] = '\0';
+  lengthMessage = 0;
 
   // Default acknowledge mode:
   setAckMode(false);
 
+  clearSchedule();
+
  // NOTE: either wait for serial port before starting everything, or don't, but in this case the
  // first report (ready) may not be seen... If there is ALWAYS a port that will be connected, then leaving
  // this is good.
@@ -44,26 +237,41 @@ void init()
 
 void receive() // NOTE: no need to declare it before the setup, it is declared in Arduino.h
 {
-  // VERY TECHNICAL NOTE: the following will try to read everything in the buffer here as
-  // multiple bytes may be available? If we do so, and since during parsing MORE bytes from
-  // a new packet may be arriving we will not get outside the While loop if we send packets
-  // continuously! This is ok since this means we are executing many commands.
-  // Since there is nothing in the loop (ISR), everything is ok. However, in the future
-  // it may be better to have a separate THREAD for this using an RTOS [something the
-  // Arduino basic framework cannot do, but MBED and probably Teensy-Arduino can]
-  while (Serial.available())
+  // NOTE: the bytes are only moved to the reception buffer here; the parsing and execution is done
+  // message by message in Com::update(), within its time budget. If the buffer is full, the remaining
+  // bytes stay in the serial port buffer (no data is lost, the USB flow control will slow down the sender).
+  while (Serial.available() && !rxBuffer.isFull())
+    rxBuffer.push((char)Serial.read());
+}
+
+bool nextMessage()
+{
+  char inChar;
+  while (rxBuffer.pop(inChar))
   {
-    char inChar = (char)Serial.read();
-    receivedMessage += inChar;
+    if (lengthMessage < MAX_LENGTH_MESSAGE)
+      receivedMessage[lengthMessage++] = inChar;
 
     if (inChar == END_MESSAGE_SERIAL) // NOTE: using the serial port, the only way to send many commands at once
     // is using a special character between the commands different from end of line, since the end of line will
     // send the data though the serial port (END_MESSAGE_SERIAL is enf of line!)
     {
-      Parser::parseStringMessage(receivedMessage); //parse AND calls the appropiate functions
-      receivedMessage = "";
+      bool tooLong = (receivedMessage[lengthMessage - 1] != END_MESSAGE_SERIAL);
+      receivedMessage[lengthMessage] = '\0';
+      lengthMessage = 0;
+      if (!tooLong)
+        return (true);
+
+      // NOTE: the beginning of the message is kept, so the host waiting for its sequence number gets a reply:
+      PRINTLN("> MESSAGE TOO LONG");
+      const char *ptrMessage = receivedMessage;
+      bool hasSeq;
+      uint32_t seq;
+      if (readSeq(ptrMessage, hasSeq, seq) && (hasSeq || requestACK))
+        sendReply(hasSeq, seq, false, Parser::ERR_TOO_LONG);
     }
   }
+  return (false);
 }
 
 } // namespace ReceiverSerial
@@ -4,8 +4,43 @@
 
 #include "Arduino.h"
 #include "Definitions.h"
+#include "Class_RingBuffer.h"
 
-#define MAX_LENGTH_MESSAGE 200
+#define MAX_LENGTH_MESSAGE 512 // one command per message (END_MESSAGE_SERIAL is also the END_CMD)
+#define SIZE_RX_BUFFER 1024    // reception ring buffer (power of 2)
+
+// Maximum time spent executing commands (received or from a running script) in each call to update(),
+// so that loop() reaches the sequencer at a bounded interval whatever the command load. At least one
+// command is executed per call, so a command longer than this budget only delays the next ones.
+#define COM_UPDATE_TIME_BUDGET 500 // in us
+
+// Pipelined protocol: a message can start with an optional sequence number, ex: "#12:0,1000,SET_PERIOD_CLK".
+// The message is then acknowledged with a compact reply that carries the same number:
+//      "!A12"      -> executed
+//      "!N12,3"    -> not executed, with the error code (Parser::ParserError)
+// so the host can keep a window of commands in flight instead of waiting for each "> OK". In ACK mode,
+// messages without sequence number are acknowledged too ("!A" / "!N,<error code>").
+#define SEQ_PREFIX '#'
+#define SEQ_SEPARATOR ':'
+#define REPLY_PREFIX '!'
+
+// Timestamped messages: after the optional sequence number, a message can be tagged with its execution
+// time in us, absolute (device time, as given by the TIME command) or relative to its reception:
+//      "@81250000:1,SWLASERALL"     -> executed when micros() reaches 81250000
+//      "#13:@+500000:0,SWLASERALL"  -> executed 500ms after its reception
+// The messages wait in a time ordered queue (messages with the same time keep their order), and the
+// acknowledgement is sent when the message is queued (execution errors are only printed).
+// NOTE: the queue is polled by update() in loop(), not by a timer interrupt (the commands are not interrupt
+// safe): a message is executed at the first pass of update() after its time, before the received messages and
+// the running script. It is late by at most the command being executed at that time (update() checks the queue
+// after each command) plus one pass of the rest of loop() (Hardware::update(), Logger::update()), typically
+// tens of us, but a slow command (SD card, long display buffer) delays it by its whole duration. For exact
+// timing, use the sequencer (triggers, clocks, one shots). The TIME command reports the worst lateness seen.
+// NOTE: the device time wraps around every ~71 minutes, so the times must be less than ~35 minutes ahead.
+#define TIME_PREFIX '@'
+#define TIME_RELATIVE '+'
+#define SIZE_SCHEDULE 32        // messages waiting for their execution time
+#define MAX_LENGTH_SCHEDULED 64 // characters of a timestamped message (without the prefixes)
 
 // Better use const in each namespace? (but puting it in the start of the file is better for easy changes)
 #define END_MESSAGE_SERIAL '\n'
@@ -16,17 +51,25 @@
 namespace Com
 {
 
-extern String receivedMessage; // holds the received message (one or more commands)
+extern char receivedMessage[MAX_LENGTH_MESSAGE + 1]; // holds the received message (one command)
 extern bool requestACK;
 extern void update();
 extern void setAckMode(bool _mode);
 extern bool getAckMode();
 
+extern bool scheduleMessage(uint32_t _time, const char *_message); // false if the queue is full
+extern void clearSchedule();
+extern uint8_t getNumScheduled();
+extern uint32_t getMaxLateness(); // in us, since the last clearSchedule()
+
 namespace ReceiverSerial
 {
 
+extern RingBuffer<char, SIZE_RX_BUFFER> rxBuffer;
+
 extern void init();
-extern void receive();
+extern void receive();     // moves the available bytes to the reception buffer (does not parse)
+extern bool nextMessage(); // true when a complete message was extracted into receivedMessage
 
 } // namespace ReceiverSerial
 
@@ -0,0 +1,16 @@
+#include "fastMath.h"
+
+namespace FastMath
+{
+
+float sinTable[SIN_TABLE_SIZE + 1];
+
+void init()
+{
+    // Done once at boot with libm (about 1ms), so there is no need to store the table in flash:
+    for (uint16_t i = 0; i <= SIN_TABLE_SIZE; i++)
+        sinTable[i] = sinf(TWO_PI_F * i / SIN_TABLE_SIZE);
+    sinTable[SIN_TABLE_SIZE] = sinTable[0]; // exact wrap
+}
+
+} // namespace FastMath
@@ -0,0 +1,63 @@
+#ifndef _FAST_MATH_H_
+#define _FAST_MATH_H_
+
+// Fast trigonometry for figure generation and test patterns.
+// NOTE 1: the Cortex-M4F FPU only works in single precision: anything written with double
+// literals (2.0 * PI) or calling the double versions of cos/sin/sqrt/log falls back to software
+// emulation, which is slow. Use the float constants below and the "f" versions of libm.
+// NOTE 2: sin/cos are computed from a table of one full turn, with linear interpolation between
+// entries. With SIN_TABLE_BITS = 10 (1024 intervals) the maximum absolute error is
+// (2*PI/1024)^2/8 ~ 4.7e-6, that is, about 0.02 ADC units on a full range (4095) galvo swing.
+
+#ifdef ARDUINO
+#include "Arduino.h"
+#include "Definitions.h"
+#else // host build of the tests (check test/test_fastmath)
+#include <stdint.h>
+#include <math.h>
+#endif
+
+#define SIN_TABLE_BITS 10
+#define SIN_TABLE_SIZE (1 << SIN_TABLE_BITS) // number of intervals in one turn
+#define SIN_TABLE_MASK (SIN_TABLE_SIZE - 1)
+
+namespace FastMath
+{
+
+const float PI_F = 3.14159265f;
+const float TWO_PI_F = 6.28318531f;
+const float DEG_TO_RAD_F = 0.01745329f;
+
+// Table index per radian:
+const float RAD_TO_INDEX = SIN_TABLE_SIZE / TWO_PI_F;
+
+// One extra entry (equal to the first) so interpolation never needs to wrap:
+extern float sinTable[SIN_TABLE_SIZE + 1];
+
+// Fill the table (call once in setup(), before drawing anything):
+extern void init();
+
+// Interpolated lookup from a position expressed in table units (SIN_TABLE_SIZE units per turn):
+inline float sinIndex(float _index)
+{
+    int32_t i = (int32_t)_index;
+    if (_index < i) // truncation goes towards zero, we need floor for negative angles
+        i--;
+    float frac = _index - i;
+    i &= SIN_TABLE_MASK;
+    return (sinTable[i] + frac * (sinTable[i + 1] - sinTable[i]));
+}
+
+inline float sin(float _phi) { return (sinIndex(_phi * RAD_TO_INDEX)); }
+inline float cos(float _phi) { return (sinIndex(_phi * RAD_TO_INDEX + (SIN_TABLE_SIZE >> 2))); }
+
+inline void sinCos(float _phi, float &_sin, float &_cos)
+{
+    float index = _phi * RAD_TO_INDEX;
+    _sin = sinIndex(index);
+    _cos = sinIndex(index + (SIN_TABLE_SIZE >> 2));
+}
+
+} // namespace FastMath
+
+#endif
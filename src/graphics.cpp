@@ -34,9 +34,14 @@ void resetGlobalPose()
 	setScaleFactor(1.0);
 }
 
-void setColorRed(bool _state)
+void setLaserMask(uint8_t _laserMask)
 {
-	Renderer2D::colorRed = _state;
+	Renderer2D::laserMask = _laserMask;
+}
+
+uint8_t getLaserMask()
+{
+	return (Renderer2D::laserMask);
 }
 
 // ======================== SCENE SETTING METHODS =====================
@@ -85,6 +90,11 @@ void addVertex(const P2 &_newPoint)
 	Renderer2D::addToBlueprint(_newPoint);
 }
 
+void addVertex(const LP &_newLaserPoint)
+{
+	Renderer2D::addToBlueprint(_newLaserPoint);
+}
+
 void addVertex(const P2 &_newPoint, uint16_t _manyTimes)
 {
 	for (uint8_t k = 0; k < _manyTimes; k++) // repeated left start-line point to avoid deformation
@@ -132,10 +142,12 @@ void drawCircle(
 	const float _radius,
 	const uint16_t _numPoints)
 {
+	const float stepPhi = FastMath::TWO_PI_F / (_numPoints - 1);
 	for (uint16_t i = 0; i <= _numPoints; i++)
 	{
-		float phi = 2.0 * PI / (_numPoints - 1) * i;
-		P2 auxPoint(_radius * cos(phi), _radius * sin(phi));
+		float sinPhi, cosPhi;
+		FastMath::sinCos(stepPhi * i, sinPhi, cosPhi);
+		P2 auxPoint(_radius * cosPhi, _radius * sinPhi);
 		auxPoint.x += _center.x;
 		auxPoint.y += _center.y;
 		addVertex(auxPoint);
@@ -266,6 +278,115 @@ void drawZigZag(
 		_mode);
 }
 
+// Intermediate points (endpoints excluded) going from _from to _to, either straight or along a
+// half circle bulging towards the side given by _side (+1: right of the chord, -1: left)
+static void addTurn(const P2 &_from, const P2 &_to, const uint8_t _shape, const uint16_t _numPoints, const float _side)
+{
+	P2 middle((_from.x + _to.x) / 2, (_from.y + _to.y) / 2);
+	// half chord, and its normal:
+	float hx = (_from.x - _to.x) / 2, hy = (_from.y - _to.y) / 2;
+	float nx = hy * _side, ny = -hx * _side;
+
+	for (uint16_t i = 1; i <= _numPoints; i++)
+	{
+		float t = 1.0f * i / (_numPoints + 1);
+		if (_shape == TURN_ARC)
+		{
+			float sinT, cosT;
+			FastMath::sinCos(FastMath::PI_F * t, sinT, cosT);
+			addVertex(P2(middle.x + hx * cosT + nx * sinT, middle.y + hy * cosT + ny * sinT));
+		}
+		else
+		{
+			addVertex(P2(_from.x + (_to.x - _from.x) * t, _from.y + (_to.y - _from.y) * t));
+		}
+	}
+}
+
+// Cosine-eased return (starts and ends with zero speed):
+static void addEasedReturn(const P2 &_from, const P2 &_to, const uint16_t _numPoints)
+{
+	for (uint16_t i = 1; i <= _numPoints; i++)
+	{
+		float t = 0.5f * (1.0f - FastMath::cos(FastMath::PI_F * i / (_numPoints + 1)));
+		addVertex(P2(_from.x + (_to.x - _from.x) * t, _from.y + (_to.y - _from.y) * t));
+	}
+}
+
+void drawRaster(
+	const P2 &_fromPoint,
+	const float _lenX, const float _lenY,
+	const uint16_t _numPointsLine, const uint16_t _numLines,
+	const bool _bidirectional,
+	const uint8_t _turnShape, const uint16_t _numPointsTurn,
+	const float _phaseForward, const float _phaseBackward)
+{
+	if ((_numPointsLine < 2) || (_numLines < 1))
+		return;
+
+	const float dx = _lenX / (_numPointsLine - 1);
+	const float stepY = (_numLines > 1 ? _lenY / (_numLines - 1) : 0);
+
+	for (uint16_t line = 0; line < _numLines; line++)
+	{
+		const bool backward = _bidirectional && (line % 2);
+		const float y = _fromPoint.y + stepY * line;
+
+		// Phase offsets advance the samples along the direction of travel:
+		P2 start;
+		if (backward)
+			start.set(_fromPoint.x + _lenX - _phaseBackward * dx, y);
+		else
+			start.set(_fromPoint.x + _phaseForward * dx, y);
+
+		drawLine(start, (backward ? -_lenX : _lenX), 0, _numPointsLine);
+
+		// Turnaround (bidirectional) or flyback (unidirectional) towards the start of the next line,
+		// or back to the start of the raster after the last line (the figure is displayed in a loop):
+		const P2 end(Renderer2D::getLastPoint());
+		const bool last = (line == _numLines - 1);
+		const float nextY = (last ? _fromPoint.y : y + stepY);
+		P2 next;
+		if (_bidirectional && !backward && !last)
+			next.set(_fromPoint.x + _lenX - _phaseBackward * dx, nextY);
+		else
+			next.set(_fromPoint.x + _phaseForward * dx, nextY);
+
+		if (_bidirectional && !last)
+			addTurn(end, next, _turnShape, _numPointsTurn, (backward ? 1.0f : -1.0f)); // bulge outside the raster
+		else if (_turnShape == TURN_ARC)
+			addEasedReturn(end, next, _numPointsTurn);
+		else
+			addTurn(end, next, TURN_STEP, _numPointsTurn, 0);
+	}
+}
+// Centered:
+void drawRaster(
+	const float _lenX, const float _lenY,
+	const uint16_t _numPointsLine, const uint16_t _numLines,
+	const bool _bidirectional,
+	const uint8_t _turnShape, const uint16_t _numPointsTurn,
+	const float _phaseForward, const float _phaseBackward)
+{
+	drawRaster(
+		P2(-_lenX / 2, -_lenY / 2),
+		_lenX, _lenY,
+		_numPointsLine, _numLines,
+		_bidirectional,
+		_turnShape, _numPointsTurn,
+		_phaseForward, _phaseBackward);
+}
+
+uint16_t pointsPerLine(const float _lineRateHz, const uint16_t _numPointsTurn)
+{
+	float pointsLine = 1000000.0f / (_lineRateHz * DisplayScan::getInterPointTime());
+	if (pointsLine < _numPointsTurn + 2)
+		return (2); // line rate too high for the current inter-point time
+	if (pointsLine - _numPointsTurn > MAX_NUM_POINTS)
+		return (MAX_NUM_POINTS); // line rate too low (the figure is cut anyway)
+	return ((uint16_t)(pointsLine - _numPointsTurn));
+}
+
 // Draw a spiral (equal steph length, not constant angle step!)
 void drawSpiral(const P2 &_center,
 				const float _radiusArm, // r = _radiusArm * theta
@@ -276,23 +397,28 @@ void drawSpiral(const P2 &_center,
 	float radiusArm = _radiusArm * (1 + _mode);
 	float numTours = _numTours / (1 + _mode);
 	uint16_t numPoints = _numPoints / (1 + _mode);
-	float phi = 2.0 * PI * numTours;
-	float length = radiusArm / (4.0 * PI) * (phi * sqrt(1 + phi * phi) + log(phi + sqrt(1 + phi * phi)));
+	// NOTE: everything in single precision (sqrtf is a single FPU instruction, and the
+	// logarithm is computed only once per figure):
+	float phi = FastMath::TWO_PI_F * numTours;
+	float length = radiusArm / (2.0f * FastMath::TWO_PI_F) * (phi * sqrtf(1 + phi * phi) + logf(phi + sqrtf(1 + phi * phi)));
 
-	float stepLength = 1.0 * length / (numPoints - 1);
+	float stepLength = length / (numPoints - 1);
+	float radiusPerRad = radiusArm / FastMath::TWO_PI_F;
 	float theta = 0, stepTheta = 0;
+	float sinTheta, cosTheta;
 
 	// 1) Go outwards:
 	while (theta <= phi)
 	{
-		float r = radiusArm * theta / 2 / PI;
-		P2 point(_center.x + r * cos(theta), _center.y + r * sin(theta));
+		float r = radiusPerRad * theta;
+		FastMath::sinCos(theta, sinTheta, cosTheta);
+		P2 point(_center.x + r * cosTheta, _center.y + r * sinTheta);
 		addVertex(point);
 
 		// Use dicotomy to find the stephTheta such that the length increase is equal to stepLength:
 		// float stepTheta = 1.0*phi/_numPoints; // the step should be smaller than that
 		// ... OR, for large number of points, we have the approximation:
-		stepTheta = stepLength / (radiusArm * sqrt(1 + theta * theta));
+		stepTheta = stepLength / (radiusArm * sqrtf(1 + theta * theta));
 
 		theta += stepTheta;
 	}
@@ -301,18 +427,19 @@ void drawSpiral(const P2 &_center,
 	{
 		// 2) Go inwards:
 		// a) do a phase offset:
-		theta = theta - PI - stepTheta;
-		while (theta > PI)
+		theta = theta - FastMath::PI_F - stepTheta;
+		while (theta > FastMath::PI_F)
 		{
-			float r = radiusArm * theta / 2 / PI;
-			// b) ... and rotate by PI:
-			P2 point(_center.x + r * cos(theta + PI), _center.y + r * sin(theta + PI));
+			float r = radiusPerRad * theta;
+			// b) ... and rotate by PI (same as negating sine and cosine):
+			FastMath::sinCos(theta, sinTheta, cosTheta);
+			P2 point(_center.x - r * cosTheta, _center.y - r * sinTheta);
 			addVertex(point);
 
 			// Use dicotomy to find the stephTheta such that the length increase is equal to stepLength:
 			// float stepTheta = 1.0*phi/_numPoints; // the step should be smaller than that
 			// ... OR, for large number of points, we have the approximation:
-			stepTheta = stepLength / (radiusArm * sqrt(1 + theta * theta));
+			stepTheta = stepLength / (radiusArm * sqrtf(1 + theta * theta));
 
 			theta -= stepTheta;
 		}
@@ -69,7 +69,9 @@ extern void setAngle(const float _angle);
 extern void setScaleFactor(const float _scaleFactor);
 extern void resetGlobalPose(); // this can be done without rendering [~openGL set identity modelview]
 
-extern void setColorRed(bool _state);
+// Lasers used by the next vertices (bit k = laser k; a laser shines only if its switch state is also on):
+extern void setLaserMask(uint8_t _laserMask);
+extern uint8_t getLaserMask();
 
 // (2) "Scene" setting methods and rendering wrappers:
 extern void clearScene(); // force clear scene
@@ -81,6 +83,7 @@ extern bool getClearMode();
 
 extern void addVertex(const P2 &_newPoint);
 extern void addVertex(const P2 &_newPoint, uint16_t _manyTimes);
+extern void addVertex(const LP &_newLaserPoint); // with its own laser mask
 
 //(3) Basic shapes. We need to pass at least the number of points - we
 // * NOTE1: could have a default "opengl-like" state variable, but it's
@@ -136,6 +139,39 @@ extern void drawZigZag(
     bool _mode = false); // mode 0: without return / mode 1: interlaced (with return)
 
 
+// Raster scan: _numLines lines of _numPointsLine points each, scanned in one direction
+// (with a flyback between lines) or in both directions (with a turnaround between lines).
+// * NOTE 1 : the galvos lag behind the commanded position, so in bidirectional mode even and
+// odd lines appear shifted with respect to each other. The phase offsets (in points, can be
+// fractional) advance the commanded samples along the scan direction of each line to compensate.
+// * NOTE 2 : the turnaround/flyback points are outside the useful raster lines; using the
+// "arc" shape the mirrors decelerate smoothly instead of stopping dead at the corners.
+enum RasterTurnShape
+{
+    TURN_STEP = 0, // straight segment
+    TURN_ARC       // half circle (bidirectional) or cosine-eased return (unidirectional)
+};
+
+extern void drawRaster(
+    const P2 &_fromPoint,
+    const float _lenX, const float _lenY,
+    const uint16_t _numPointsLine, const uint16_t _numLines,
+    const bool _bidirectional,
+    const uint8_t _turnShape, const uint16_t _numPointsTurn,
+    const float _phaseForward, const float _phaseBackward);
+// Centered:
+extern void drawRaster(
+    const float _lenX, const float _lenY,
+    const uint16_t _numPointsLine, const uint16_t _numLines,
+    const bool _bidirectional,
+    const uint8_t _turnShape, const uint16_t _numPointsTurn,
+    const float _phaseForward, const float _phaseBackward);
+
+// Number of points per raster line needed to scan at _lineRateHz with the current
+// inter-point time of the display engine (a line includes its turnaround/flyback), at most MAX_NUM_POINTS.
+// NOTE: the line rate must be positive.
+extern uint16_t pointsPerLine(const float _lineRateHz, const uint16_t _numPointsTurn);
+
 // r = _radiusArm * theta
 extern void drawSpiral(
     const P2 &_center,
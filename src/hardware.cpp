@@ -1,4 +1,5 @@
 #include "hardware.h"
+#include "renderer2D.h"
 
 namespace Hardware
 {
@@ -21,6 +22,8 @@ OptoTuners::init();
 InputShutter::init();
 Lasers::init();							 // NOTE: initialize the shutters BEFORE initializing the lasers
 InputShutter::startExtInterrupt(CHANGE); // activate shutters interrupts AFTER lasers (because it will call lasers)
+OneShots::init();						 // (before the edge capture, that reads the timer)
+ExtTriggers::init();					 // edge capture of the input triggers
 Scanner::init();
 
 #ifdef USING_SD_CARD
@@ -32,27 +35,98 @@ Scanner::init();
 //Software reset: better than using the RST pin (noisy?)
 void resetBoard()
 {
+	Logger::flush();
 	SCB_AIRCR = 0x05FA0004; // software reset on Teensy 3.X
 }
 
+// ============================ LED blink patterns ================================
+// Each led in use has a queue of patterns; the current pattern advances in updateLeds()
+// (called from Hardware::update), so blinkLed() never waits.
+// NOTE: polled from loop() on purpose, not from a timer: the leds only signal messages and errors, so a pattern
+// stretched by a blocking command (SD card access...) does not matter, and the timers are kept for the display,
+// the sequencer and the clocks. The sequencer modules must not write the leds (their ISR would fight the patterns).
+
+struct BlinkPattern
+{
+	uint8_t times;
+	uint32_t halfPeriodMicros;
+};
+
+struct LedChannel
+{
+	bool inUse;
+	uint8_t pin;
+	RingBuffer<BlinkPattern, SIZE_LED_QUEUE> queue;
+	bool running;		 // a pattern is being played
+	uint16_t halfPeriods; // remaining half periods of the current pattern
+	uint32_t halfPeriodMicros;
+	elapsedMicros timer;
+};
+
+LedChannel ledChannel[MAX_LED_CHANNELS];
+
+static LedChannel *getLedChannel(uint8_t _pinLed)
+{
+	for (uint8_t k = 0; k < MAX_LED_CHANNELS; k++)
+		if (ledChannel[k].inUse && (ledChannel[k].pin == _pinLed))
+			return (&ledChannel[k]);
+
+	// First time this led blinks:
+	for (uint8_t k = 0; k < MAX_LED_CHANNELS; k++)
+		if (!ledChannel[k].inUse)
+		{
+			pinMode(_pinLed, OUTPUT); // method can be called for a pin different from debug or message
+			ledChannel[k].inUse = true;
+			ledChannel[k].pin = _pinLed;
+			ledChannel[k].running = false;
+			ledChannel[k].queue.clear();
+			return (&ledChannel[k]);
+		}
+	return (NULL);
+}
+
 void blinkLed(uint8_t _pinLed, uint8_t _times, uint32_t _periodMicros)
 {
-	// Non blocking blink! Avoid to use delay() too
+	// Non blocking blink: the pattern is queued and played in the background.
+	// NOTE: if the queue of the led is full (ex: many commands in a row blinking the message led),
+	// the pattern is just ignored - the led is blinking anyway.
+	if (!_times)
+		return;
+	LedChannel *channel = getLedChannel(_pinLed);
+	if (channel == NULL)
+		return;
+	BlinkPattern pattern = {_times, _periodMicros / 2};
+	channel->queue.push(pattern);
+}
 
-	pinMode(_pinLed, OUTPUT); // method can be called for a pin different from debug or message
-	elapsedMicros usec = 0;
-	for (uint8_t i = 0; i < _times; i++)
+static void updateLeds()
+{
+	for (uint8_t k = 0; k < MAX_LED_CHANNELS; k++)
 	{
-		digitalWrite(_pinLed, HIGH);
-		while (usec < _periodMicros / 2)
+		LedChannel &channel = ledChannel[k];
+		if (!channel.inUse)
+			continue;
+
+		if (!channel.running)
 		{
+			BlinkPattern pattern;
+			if (!channel.queue.pop(pattern))
+				continue;
+			channel.running = true;
+			channel.halfPeriods = 2 * pattern.times;
+			channel.halfPeriodMicros = pattern.halfPeriodMicros;
+			channel.timer = 0;
+			digitalWrite(channel.pin, HIGH);
 		}
-		usec = 0;
-		digitalWrite(_pinLed, LOW);
-		while (usec < _periodMicros / 2)
+		else if (channel.timer >= channel.halfPeriodMicros)
 		{
+			channel.timer = 0;
+			channel.halfPeriods--;
+			if (channel.halfPeriods)
+				digitalWrite(channel.pin, channel.halfPeriods & 1 ? LOW : HIGH);
+			else
+				channel.running = false; // the led is LOW since the last half period
 		}
-		usec = 0;
 	}
 }
 
@@ -65,42 +139,40 @@ void blinkLedMessage(uint8_t _times, uint32_t _periodMicros)
 	blinkLed(PIN_LED_MESSAGE, _times, _periodMicros);
 }
 
-void print(String _string)
+void update()
 {
-	if (Utils::verboseMode)
-	{
-#if defined DEBUG_MODE_SERIAL
-		Serial.print(_string);
-#endif
+	updateLeds();
+	Scanner::update();
+	Lasers::update();
+	Sequencer::checkOverruns();
+}
 
-#if defined DEBUG_MODE_LCD
-		Lcd::print(_string);
-#endif
+void stopTests()
+{
+	Scanner::stopTest();
+	Lasers::stopTest();
+}
 
-#if defined DEBUG_MODE_TFT
-		Tft::print(_string);
-#endif
-	}
+// NOTE: the messages are only queued here; they are sent to the serial port and the displays
+// in the background by Logger::update() (check logger.h)
+void print(const char *_string, uint8_t _level)
+{
+	if (Utils::verboseMode || (_level == LOG_LEVEL_ALWAYS))
+		Logger::write(_level, _string);
 }
 
-void println(String _string)
+void println(const char *_string, uint8_t _level)
 {
-	if (Utils::verboseMode)
+	if (Utils::verboseMode || (_level == LOG_LEVEL_ALWAYS))
 	{
-#if defined DEBUG_MODE_SERIAL
-		Serial.println(_string);
-#endif
-
-#if defined DEBUG_MODE_LCD
-		Lcd::println(_string);
-#endif
-
-#if defined DEBUG_MODE_TFT
-		Tft::println(_string);
-#endif
+		Logger::write(_level, _string);
+		Logger::write(_level, "\n");
 	}
 }
 
+void print(const String &_string, uint8_t _level) { print(_string.c_str(), _level); }
+void println(const String &_string, uint8_t _level) { println(_string.c_str(), _level); }
+
 // ********************************************************************************************************
 // **********************************************************************************************************
 
@@ -236,6 +308,64 @@ void resetAllClocks()
 	{
 		arrayClock[k].reset();
 	}
+	checkTimers();
+}
+
+IntervalTimer clockTimers[NUM_CLOCK_TIMERS];
+int8_t boundClock[NUM_CLOCK_TIMERS] = {-1, -1}; // clock using each timer (-1 if free)
+
+// NOTE: an IntervalTimer callback has no argument, so there is one function per timer:
+static void clockTimerISR0() { arrayClock[boundClock[0]].hardwareEdge(); }
+static void clockTimerISR1() { arrayClock[boundClock[1]].hardwareEdge(); }
+static void (*const clockTimerISR[NUM_CLOCK_TIMERS])() = {clockTimerISR0, clockTimerISR1};
+
+bool bindTimer(uint8_t _clockID, uint8_t _pin)
+{
+	if (_clockID >= NUM_CLOCKS)
+		return (false);
+	unbindTimer(_clockID); // (ex: to change the pin)
+
+	for (uint8_t k = 0; k < NUM_CLOCK_TIMERS; k++)
+	{
+		if (boundClock[k] < 0)
+		{
+			boundClock[k] = _clockID;
+			clockTimers[k].priority(CLOCK_ISR_PRIORITY);
+			arrayClock[_clockID].setHardwareTimer(&clockTimers[k], clockTimerISR[k], _pin);
+			return (checkTimers());
+		}
+	}
+	PRINTLN("> NO FREE TIMER");
+	return (false);
+}
+
+// A clock whose timer could not be started (period out of the range of the timer) is back to the software
+// clock: its timer is freed here.
+bool checkTimers()
+{
+	bool allStarted = true;
+	for (uint8_t k = 0; k < NUM_CLOCK_TIMERS; k++)
+	{
+		if ((boundClock[k] >= 0) && !arrayClock[boundClock[k]].isHardwareTimed())
+		{
+			PRINTLN("> TIMER NOT STARTED: CLK " + String(boundClock[k]));
+			boundClock[k] = -1;
+			allStarted = false;
+		}
+	}
+	return (allStarted);
+}
+
+void unbindTimer(uint8_t _clockID)
+{
+	for (uint8_t k = 0; k < NUM_CLOCK_TIMERS; k++)
+	{
+		if (boundClock[k] == _clockID)
+		{
+			arrayClock[_clockID].clearHardwareTimer(); // stops the timer before freeing it
+			boundClock[k] = -1;
+		}
+	}
 }
 
 } // namespace Clocks
@@ -247,6 +377,37 @@ namespace ExtTriggers
 OutputTrigger arrayTriggerOut[NUM_EXT_TRIGGERS_OUT];
 InputTrigger arrayTriggerIn[NUM_EXT_TRIGGERS_IN];
 
+// All the triggers reading the pin see the edge (by default, they all use PIN_TRIGGER_INPUT, and a pin has
+// only one interrupt):
+static void captureEdges(uint8_t _pin)
+{
+	uint32_t now, nowTicks;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) // (the overflow interrupt of the timer has a higher priority)
+	{
+		now = micros();
+		nowTicks = OneShots::nowTicks();
+	}
+	for (uint8_t k = 0; k < NUM_EXT_TRIGGERS_IN; k++)
+		if (arrayTriggerIn[k].getInputPin() == _pin)
+			arrayTriggerIn[k].captureEdge(now, nowTicks);
+}
+
+// NOTE: the ISR has no argument, so there is one function per trigger:
+static void edgeISR0() { captureEdges(arrayTriggerIn[0].getInputPin()); }
+static void edgeISR1() { captureEdges(arrayTriggerIn[1].getInputPin()); }
+static void edgeISR2() { captureEdges(arrayTriggerIn[2].getInputPin()); }
+static void edgeISR3() { captureEdges(arrayTriggerIn[3].getInputPin()); }
+static void (*const edgeISR[NUM_EXT_TRIGGERS_IN])() = {edgeISR0, edgeISR1, edgeISR2, edgeISR3};
+
+void init()
+{
+	for (uint8_t k = 0; k < NUM_EXT_TRIGGERS_IN; k++)
+	{
+		arrayTriggerIn[k].setInterruptDriven(true);
+		attachInterrupt(arrayTriggerIn[k].getInputPin(), edgeISR[k], CHANGE);
+	}
+}
+
 } // namespace ExtTriggers
 
 // ====================================================================================
@@ -263,6 +424,215 @@ namespace Pulsars
 Pulsar arrayPulsar[NUM_PULSARS];
 }
 
+// ====================================================================================
+// ============================ NAMESPACE LOGIC GATES =================================
+namespace LogicGates
+{
+LogicGate arrayLogicGate[NUM_LOGIC_GATES];
+}
+
+// ====================================================================================
+// ============================ NAMESPACE WAVEFORMS ===================================
+namespace Waveforms
+{
+Waveform arrayWaveform[NUM_WAVEFORMS];
+}
+
+// ====================================================================================
+// ============================ NAMESPACE DELAY LINES =================================
+namespace DelayLines
+{
+DelayLine arrayDelayLine[NUM_DELAY_LINES];
+}
+
+// ====================================================================================
+// ============================ NAMESPACE ONE SHOTS ===================================
+namespace OneShots
+{
+
+struct Edge
+{
+	uint32_t ticks; // timer count, extended to 32 bits
+	bool level;
+};
+
+// The edges are queued by the sequencer, and the compare channels are armed by the timer ISR:
+RingBuffer<Edge, SIZE_ONE_SHOT_QUEUE> edgeQueue[NUM_ONE_SHOTS];
+volatile bool armed[NUM_ONE_SHOTS] = {false, false};
+volatile bool cancelRequest[NUM_ONE_SHOTS] = {false, false};
+volatile uint32_t overflows = 0; // upper bits of the timer count
+Module *boundModule[NUM_ONE_SHOTS] = {NULL, NULL};
+
+volatile uint32_t *const channelSC[NUM_ONE_SHOTS] = {&FTM1_C0SC, &FTM1_C1SC};
+volatile uint32_t *const channelV[NUM_ONE_SHOTS] = {&FTM1_C0V, &FTM1_C1V};
+
+// Output compare mode, the pin is set or cleared on match:
+#define ONE_SHOT_COMPARE(level) (FTM_CSC_MSA | FTM_CSC_ELSB | ((level) ? FTM_CSC_ELSA : 0))
+
+void init()
+{
+	FTM1_SC = 0;
+	FTM1_MODE = FTM_MODE_WPDIS;
+	FTM1_CNTIN = 0;
+	FTM1_MOD = 0xFFFF;
+	FTM1_CNT = 0;
+#ifdef USING_ONE_SHOTS
+	for (uint8_t k = 0; k < NUM_ONE_SHOTS; k++)
+	{
+		*channelV[k] = ONE_SHOT_MIN_LEAD;
+		*channelSC[k] = ONE_SHOT_COMPARE(LOW); // the pins start low
+	}
+	// NOTE: the pins are PIN_ONE_SHOT_A/B (alternative function 3 is the FTM1 channel):
+	CORE_PIN3_CONFIG = PORT_PCR_MUX(3) | PORT_PCR_DSE | PORT_PCR_SRE;
+	CORE_PIN4_CONFIG = PORT_PCR_MUX(3) | PORT_PCR_DSE | PORT_PCR_SRE;
+#endif
+	// NOTE: the timer runs anyway, it timestamps the input trigger edges:
+
+	FTM1_SC = FTM_SC_CLKS(1) | FTM_SC_PS(ONE_SHOT_PRESCALER) | FTM_SC_TOIE;
+	NVIC_SET_PRIORITY(IRQ_FTM1, ONE_SHOT_ISR_PRIORITY);
+	NVIC_ENABLE_IRQ(IRQ_FTM1);
+}
+
+// Timer count extended to 32 bits (with the interrupts disabled, or from the ISR):
+uint32_t nowTicks()
+{
+	uint32_t count = FTM1_CNT;
+	uint32_t upper = overflows;
+	if ((FTM1_SC & FTM_SC_TOF) && (count < 0x8000))
+		upper++; // the overflow did not go through the ISR yet
+	return ((upper << 16) | count);
+}
+
+// The compare register has 16 bits: the edge is armed when it is less than one timer period ahead (otherwise
+// it will be checked again at the next overflow):
+static void armChannel(uint8_t _channel)
+{
+	if (armed[_channel] || edgeQueue[_channel].isEmpty())
+		return;
+	const Edge &edge = edgeQueue[_channel].peek();
+	uint32_t now = nowTicks();
+	int32_t remaining = edge.ticks - now;
+	if (remaining >= 0x10000 - ONE_SHOT_MIN_LEAD)
+		return;
+	*channelV[_channel] = (remaining < ONE_SHOT_MIN_LEAD ? now + ONE_SHOT_MIN_LEAD : edge.ticks) & 0xFFFF;
+	// NOTE: the flag is also set by the matches of the idle channel; it is cleared by reading it, then writing 0:
+	(void)*channelSC[_channel];
+	*channelSC[_channel] = ONE_SHOT_COMPARE(edge.level) | FTM_CSC_CHIE;
+	armed[_channel] = true;
+}
+
+bool scheduleEdge(uint8_t _channel, const EventTime &_time, uint32_t _offsetTicks, bool _level)
+{
+	if (_channel >= NUM_ONE_SHOTS)
+		return (false);
+	Edge edge;
+	edge.level = _level;
+	if (_time.hasTicks)
+		edge.ticks = _time.ticks + _offsetTicks;
+	else
+	{ // (the micros() time of the event has 1us resolution)
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+		{
+			int32_t fromNowUs = _time.us - micros();
+			edge.ticks = nowTicks() + fromNowUs * ONE_SHOT_TICKS_PER_US + _offsetTicks;
+		}
+	}
+	bool queued = edgeQueue[_channel].push(edge);
+	NVIC_SET_PENDING(IRQ_FTM1); // the ISR arms the channel
+	return (queued);
+}
+
+void cancelEdges(uint8_t _channel)
+{
+	if (_channel >= NUM_ONE_SHOTS)
+		return;
+	cancelRequest[_channel] = true;
+	NVIC_SET_PENDING(IRQ_FTM1);
+}
+
+void cancelAllEdges()
+{
+	for (uint8_t k = 0; k < NUM_ONE_SHOTS; k++)
+		cancelEdges(k);
+}
+
+bool bindModule(Module *_ptrModule, uint8_t _channel)
+{
+#ifdef USING_ONE_SHOTS
+	if ((_ptrModule == NULL) || (_channel >= NUM_ONE_SHOTS))
+		return (false);
+	if (!_ptrModule->setEdgeOutput(scheduleEdge, _channel))
+		return (false);
+	// One channel per module, and one module per channel:
+	for (uint8_t k = 0; k < NUM_ONE_SHOTS; k++)
+		if ((k != _channel) && (boundModule[k] == _ptrModule))
+		{
+			boundModule[k] = NULL;
+			cancelEdges(k);
+		}
+	if ((boundModule[_channel] != NULL) && (boundModule[_channel] != _ptrModule))
+	{
+		boundModule[_channel]->setEdgeOutput(NULL, 0);
+		cancelEdges(_channel);
+	}
+	boundModule[_channel] = _ptrModule;
+	return (true);
+#else
+	return (false);
+#endif
+}
+
+void unbindModule(Module *_ptrModule)
+{
+	if (_ptrModule == NULL)
+		return;
+	_ptrModule->setEdgeOutput(NULL, 0);
+	for (uint8_t k = 0; k < NUM_ONE_SHOTS; k++)
+		if (boundModule[k] == _ptrModule)
+		{
+			boundModule[k] = NULL;
+			cancelEdges(k);
+		}
+}
+
+} // namespace OneShots
+
+// Timer ISR (overflows and matches of FTM1). NOTE: the name (and C linkage, even declared in this namespace) is
+// the one of the interrupt vector in the core.
+extern "C" void ftm1_isr(void)
+{
+	using namespace OneShots;
+	if (FTM1_SC & FTM_SC_TOF)
+	{
+		FTM1_SC &= ~FTM_SC_TOF; // (reading the flag, then writing 0 clears it)
+		overflows++;
+	}
+
+	for (uint8_t k = 0; k < NUM_ONE_SHOTS; k++)
+	{
+		uint32_t sc = *channelSC[k];
+		if (cancelRequest[k])
+		{ // the pin goes low right away:
+			cancelRequest[k] = false;
+			edgeQueue[k].clear();
+			armed[k] = false;
+			*channelV[k] = (FTM1_CNT + ONE_SHOT_MIN_LEAD) & 0xFFFF;
+			*channelSC[k] = ONE_SHOT_COMPARE(LOW);
+		}
+		else if (sc & FTM_CSC_CHF)
+		{ // the edge is done (the pin keeps its level, and the channel does not interrupt until armed again):
+			*channelSC[k] = sc & ~(FTM_CSC_CHF | FTM_CSC_CHIE);
+			if (armed[k])
+			{
+				Edge edge;
+				edgeQueue[k].pop(edge);
+				armed[k] = false;
+			}
+		}
+		armChannel(k);
+	}
+}
+
 // ====================================================================================
 // ==== NAMESPACE SEQUENCER (only one but can encompass many independent pipelines ====
 namespace Sequencer
@@ -271,16 +641,131 @@ using namespace Hardware::Clocks;
 using namespace Hardware::ExtTriggers;
 using namespace Hardware::TriggerProcessors;
 using namespace Hardware::Pulsars;
+using namespace Hardware::LogicGates;
+using namespace Hardware::Waveforms;
+using namespace Hardware::DelayLines;
 using namespace Hardware::Lasers;
 
 std::vector<Module *> vectorPtrModules;
 bool activeSequencer = false;
 
+bool zeroDelay = false; // evaluation in topological order (check setZeroDelayMode)
+
+// Compiled pipeline (check compilePipeline): one node per module, in the evaluation order, with the links
+// as bit masks and the deadlines cached, so the tick only touches the modules that have to be evaluated.
+// The gates and trigger processors are packed (check packedLogic.h): they read their inputs in the word of
+// signals, and their module is only written when their output changes.
+struct CompiledNode
+{
+	Module *ptr_module;
+	uint32_t toMask;   // modules whose input is this module
+	uint32_t deadline; // valid if the bit is set in timedMask
+	PackedLogic::Node packed;
+	uint32_t nextEventTime, nextEventTicks; // packed nodes: time of the change of output
+	bool nextTicksValid;
+};
+
+CompiledNode compiledNodes[MAX_COMPILED_MODULES];
+uint8_t numCompiledNodes = 0;
+uint32_t polledMask = 0;  // modules evaluated at every tick
+uint32_t timedMask = 0;	  // modules with a pending deadline
+uint32_t dirtyMask = 0;	  // modules to evaluate at the next tick because an input or their output changed
+uint32_t signals = 0;	  // outputs of the modules
+uint32_t nextSignals = 0; // outputs computed by the packed nodes during the tick
+bool compiled = false;	  // otherwise the pipeline is too large, and the modules are scanned at each tick
+
+// Event recorder: each change of output of a module, written by the sequencer ISR and read from loop():
+RingBuffer<SequencerEvent, SIZE_EVENT_RECORD> eventRecord;
+bool recording = false;
+volatile uint32_t lostEvents = 0;
+
+static inline void recordEvent(Module *_ptrModule)
+{
+	if (recording)
+	{
+		SequencerEvent event = {_ptrModule->getEventTime(), _ptrModule->getClassIndex(), _ptrModule->getID(),
+								_ptrModule->getOutputState()};
+		if (!eventRecord.push(event))
+			lostEvents++;
+	}
+}
+
+IntervalTimer sequencerTimer;
+uint32_t tickUs = DEFAULT_SEQUENCER_TICK;
+volatile uint32_t overruns = 0;	   // ticks that lasted more than the tick period
+volatile uint32_t maxTickTime = 0; // in us
+uint8_t consecutiveOverruns = 0;
+volatile bool backedOff = false; // the ISR changed the tick (or stopped the sequencer): report from loop()
+
+// The sequencer tick (ISR):
+static void sequencerISR()
+{
+	uint32_t startTick = micros();
+	update();
+	uint32_t tickTime = micros() - startTick;
+	if (tickTime > maxTickTime)
+		maxTickTime = tickTime;
+	if (tickTime < tickUs)
+	{
+		consecutiveOverruns = 0;
+		return;
+	}
+
+	overruns++; // the next tick(s) will be late
+	if (++consecutiveOverruns < MAX_CONSECUTIVE_OVERRUNS)
+		return;
+	consecutiveOverruns = 0;
+	backedOff = true;
+	if (tickUs < MAX_SEQUENCER_TICK)
+	{
+		tickUs = min(2 * tickUs, (uint32_t)MAX_SEQUENCER_TICK);
+		sequencerTimer.update(tickUs);
+	}
+	else
+	{
+		sequencerTimer.end();
+		OneShots::cancelAllEdges();
+		activeSequencer = false;
+	}
+}
+
+void checkOverruns()
+{
+	if (!backedOff)
+		return;
+	backedOff = false;
+	if (activeSequencer)
+		println("> SEQUENCER OVERRUN: tick raised to " + String(tickUs) + "us", LOG_LEVEL_ALWAYS);
+	else
+		println("> SEQUENCER OVERRUN: stopped", LOG_LEVEL_ALWAYS);
+}
+
+static bool startTimer()
+{
+	if (!sequencerTimer.begin(sequencerISR, tickUs))
+	{
+		PRINTLN(">> ERROR: could not set the sequencer ISR.");
+		return (false);
+	}
+	// NOTE: priority higher than the display engine (112), but lower than millis/micros (32):
+	sequencerTimer.priority(SEQUENCER_ISR_PRIORITY);
+	return (true);
+}
+
 void setState(bool _active)
 {
 	if (_active)
 		reset(); // this is optional (we could stop the sequencer, call reset and then re-activate it, but
 				 // the cases where we may need NOT reseting are not very useful)
+
+	// The timer only runs when the sequencer is active:
+	if (_active && !activeSequencer)
+		_active = startTimer();
+	else if (!_active && activeSequencer)
+	{
+		sequencerTimer.end();
+		OneShots::cancelAllEdges(); // the pending hardware edges would still fire
+	}
 	activeSequencer = _active;
 }
 
@@ -289,11 +774,35 @@ bool getState() { return (activeSequencer); }
 void reset()
 {
 	// reset all the modules in the sequencer pipeline.
-	// NOTE: no need to stop the sequencer if it was active, the update is not done in an ISR.
-	for (auto ptr_module : vectorPtrModules)
-		ptr_module->reset();
+	// NOTE: the update is done in an ISR, so the modules are reset with the interrupts disabled.
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (auto ptr_module : vectorPtrModules)
+			ptr_module->reset();
+		OneShots::cancelAllEdges();
+		overruns = 0;
+		maxTickTime = 0;
+		consecutiveOverruns = 0;
+	}
 }
 
+bool setTick(uint32_t _tickUs)
+{
+	if (_tickUs < MIN_SEQUENCER_TICK)
+		return (false);
+	tickUs = _tickUs;
+	overruns = 0;
+	maxTickTime = 0;
+	consecutiveOverruns = 0;
+	if (activeSequencer)
+		sequencerTimer.update(tickUs); // takes effect at the next tick
+	return (true);
+}
+
+uint32_t getTick() { return (tickUs); }
+uint32_t getOverruns() { return (overruns); }
+uint32_t getMaxTickTime() { return (maxTickTime); }
+
 /*
   class codes : {
 	  			  0 = clocks (clk),
@@ -302,6 +811,9 @@ void reset()
 				  3 = laser (las),
 				  4 = trigger processor (trg),
 				  5 = pulse shaper (pul)
+				  7 = logic gate (gate)
+				  8 = analog waveform (wave)
+				  9 = delay line (dly)
 				 }
  */
 Module *getModulePtr(uint8_t _classID, uint8_t _index)
@@ -329,6 +841,15 @@ Module *getModulePtr(uint8_t _classID, uint8_t _index)
 	case 6: //pulsar shaper
 		return (&(arrayPulsar[_index % NUM_PULSARS]));
 		break;
+	case 7: // logic gate
+		return (&(arrayLogicGate[_index % NUM_LOGIC_GATES]));
+		break;
+	case 8: // waveform
+		return (&(arrayWaveform[_index % NUM_WAVEFORMS]));
+		break;
+	case 9: // delay line
+		return (&(arrayDelayLine[_index % NUM_DELAY_LINES]));
+		break;
 	default:
 		return (NULL);
 		break;
@@ -338,10 +859,170 @@ Module *getModulePtr(uint8_t _classID, uint8_t _index)
 void clearPipeline()
 {
 	// we need to clear the vector of modules, but also reset the connections:
-	disconnectModules();
-	vectorPtrModules.clear();
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		disconnectModules();
+		vectorPtrModules.clear();
+		OneShots::cancelAllEdges();
+		numCompiledNodes = 0;
+		polledMask = timedMask = dirtyMask = 0; // otherwise the stale nodes would still be evaluated
+		compiled = true;
+	}
 }
 
+static bool isInPipeline(Module *_ptrModule)
+{
+	for (auto ptr_module : vectorPtrModules)
+		if (ptr_module == _ptrModule)
+			return (true);
+	return (false);
+}
+
+// Topological order of the pipeline: each module after its input modules. When no module can be placed,
+// only cycles remain: one module of a cycle is placed anyway, and its inputs that are not placed yet are
+// then read from the previous tick (explicit one tick delay that breaks the cycle).
+void sortPipeline()
+{
+	std::vector<Module *> sortedModules;
+	sortedModules.reserve(vectorPtrModules.size());
+	std::vector<bool> placed(vectorPtrModules.size(), false);
+
+	while (sortedModules.size() < vectorPtrModules.size())
+	{
+		bool progress = false;
+		for (uint8_t k = 0; k < vectorPtrModules.size(); k++)
+		{
+			if (placed[k])
+				continue;
+			bool ready = true;
+			for (uint8_t i = 0; i < vectorPtrModules[k]->getNumInputLinks(); i++)
+			{
+				Module *ptr_fromModule = vectorPtrModules[k]->getInputLink(i);
+				bool placedInput = !isInPipeline(ptr_fromModule);
+				for (auto ptr_sorted : sortedModules)
+					placedInput |= (ptr_sorted == ptr_fromModule);
+				ready &= placedInput;
+			}
+			if (ready)
+			{
+				sortedModules.push_back(vectorPtrModules[k]);
+				placed[k] = true;
+				progress = true;
+			}
+		}
+
+		if (!progress)
+		{ // only cycles remain: break the first one
+			for (uint8_t k = 0; k < vectorPtrModules.size(); k++)
+			{
+				if (!placed[k])
+				{
+					PRINTLN("> CYCLE: one tick delay at the input of " + vectorPtrModules[k]->getName());
+					sortedModules.push_back(vectorPtrModules[k]);
+					placed[k] = true;
+					break;
+				}
+			}
+		}
+	}
+
+	// NOTE: swapping the vectors does not allocate memory, but the ISR should not see it half done:
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		vectorPtrModules.swap(sortedModules);
+	}
+}
+
+void setZeroDelayMode(bool _zeroDelay)
+{
+	zeroDelay = _zeroDelay;
+	compilePipeline();
+}
+
+// Polling and deadlines only change when the module is evaluated (or reset, which makes it dirty):
+static inline void scheduleNode(uint8_t _index)
+{
+	Module *ptr_module = compiledNodes[_index].ptr_module;
+	uint32_t bit = (1UL << _index);
+	if (ptr_module->isPolled())
+		polledMask |= bit;
+	else
+		polledMask &= ~bit;
+	if (ptr_module->hasDeadline())
+	{
+		compiledNodes[_index].deadline = ptr_module->getDeadline();
+		timedMask |= bit;
+	}
+	else
+		timedMask &= ~bit;
+}
+
+// The pure logic modules are packed, the others are evaluated through their virtual methods:
+static uint8_t getNodeType(Module *_ptrModule)
+{
+	switch (_ptrModule->getClassIndex())
+	{
+	case Definitions::ClassIndexes::CLASSID_GATE:
+		return (PackedLogic::NODE_AND + static_cast<LogicGate *>(_ptrModule)->getFunction());
+	case Definitions::ClassIndexes::CLASSID_TRG:
+		return (PackedLogic::NODE_TRG);
+	default:
+		return (PackedLogic::NODE_MODULE);
+	}
+}
+
+// Reads a packed node from its module, when the module is dirty (reset, reconfigured, started...):
+static void loadPackedNode(uint8_t _index)
+{
+	CompiledNode &node = compiledNodes[_index];
+	Module *ptr_module = node.ptr_module;
+	ptr_module->clearDirty();
+	node.packed.type = getNodeType(ptr_module);
+	if (node.packed.type == PackedLogic::NODE_TRG)
+		node.packed.trg = static_cast<TriggerProcessor *>(ptr_module)->getPackedState();
+	uint32_t bit = (1UL << _index);
+	if (ptr_module->getOutputState())
+		signals |= bit;
+	else
+		signals &= ~bit;
+	nextSignals = (nextSignals & ~bit) | (signals & bit);
+}
+
+void compilePipeline()
+{
+	if (zeroDelay)
+		sortPipeline();
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		compiled = (vectorPtrModules.size() <= MAX_COMPILED_MODULES);
+		if (compiled)
+		{
+			numCompiledNodes = vectorPtrModules.size();
+			polledMask = timedMask = dirtyMask = signals = 0;
+			for (uint8_t k = 0; k < numCompiledNodes; k++)
+			{
+				compiledNodes[k].ptr_module = vectorPtrModules[k];
+				compiledNodes[k].packed.type = getNodeType(vectorPtrModules[k]);
+				compiledNodes[k].toMask = compiledNodes[k].packed.inMask = 0;
+				for (uint8_t j = 0; j < numCompiledNodes; j++)
+				{
+					if (vectorPtrModules[j]->hasInputLink(vectorPtrModules[k]))
+						compiledNodes[k].toMask |= (1UL << j);
+					if (vectorPtrModules[k]->hasInputLink(vectorPtrModules[j]))
+						compiledNodes[k].packed.inMask |= (1UL << j);
+				}
+				if (vectorPtrModules[k]->getOutputState())
+					signals |= (1UL << k);
+				scheduleNode(k);
+				vectorPtrModules[k]->setDirty(); // the packed nodes are read from their module
+			}
+		}
+	}
+}
+
+bool getZeroDelayMode() { return (zeroDelay); }
+
 void addModulePipeline(Module *ptr_newModule)
 {
 	if (ptr_newModule != NULL)
@@ -359,7 +1040,14 @@ void addModulePipeline(Module *ptr_newModule)
 			}
 		}
 		if (!isThere)
-			vectorPtrModules.push_back(ptr_newModule);
+		{
+			// NOTE: the vector may be reallocated, it cannot be done while the ISR goes through it:
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+			{
+				vectorPtrModules.push_back(ptr_newModule);
+			}
+			compilePipeline();
+		}
 	}
 }
 
@@ -369,17 +1057,243 @@ void disconnectModules()
 		ptr_module->clearInputLink();
 }
 
+// A packed node changes because of the latest event of its inputs (as LogicGate::computeNextState):
+static void setPackedEventTime(CompiledNode &_node)
+{
+	_node.nextEventTime = micros();
+	_node.nextTicksValid = false;
+	bool first = true;
+	for (uint32_t mask = _node.packed.inMask; mask; mask &= mask - 1)
+	{
+		Module *ptr_input = compiledNodes[__builtin_ctz(mask)].ptr_module;
+		if (first || ((int32_t)(ptr_input->getEventTime() - _node.nextEventTime) > 0))
+		{
+			_node.nextEventTime = ptr_input->getEventTime();
+			_node.nextEventTicks = ptr_input->getEventTicks();
+			_node.nextTicksValid = ptr_input->hasEventTicks();
+			first = false;
+		}
+	}
+}
+
+// Evaluation of a node of the compiled pipeline (the packed nodes write their output in nextSignals):
+static inline void evaluateNode(uint8_t _index)
+{
+	CompiledNode &node = compiledNodes[_index];
+	Module *ptr_module = node.ptr_module;
+	if (node.packed.type == PackedLogic::NODE_MODULE)
+	{
+		ptr_module->clearDirty();
+		ptr_module->update();
+		return;
+	}
+	if (ptr_module->isDirty())
+		loadPackedNode(_index);
+	if (!ptr_module->isActive())
+		return; // the output does not change (as Module::update)
+
+	uint32_t bit = (1UL << _index);
+	bool output = PackedLogic::evaluate(node.packed, signals);
+	if (node.packed.type == PackedLogic::NODE_TRG)
+		static_cast<TriggerProcessor *>(ptr_module)->setPackedState(node.packed.trg);
+	if (output == ((signals & bit) != 0))
+		return;
+	setPackedEventTime(node);
+	nextSignals ^= bit;
+}
+
+// ...then the refresh returns the nodes to evaluate because its output changed:
+static inline uint32_t refreshNode(uint8_t _index)
+{
+	CompiledNode &node = compiledNodes[_index];
+	Module *ptr_module = node.ptr_module;
+	uint32_t bit = (1UL << _index);
+	if (node.packed.type == PackedLogic::NODE_MODULE)
+	{
+		bool changed = ptr_module->refreshStates();
+		scheduleNode(_index);
+		if (ptr_module->getOutputState())
+			signals |= bit;
+		else
+			signals &= ~bit;
+		if (!changed)
+			return (0);
+	}
+	else
+	{
+		if (!((nextSignals ^ signals) & bit))
+			return (0);
+		signals ^= bit;
+		ptr_module->setPackedOutput(signals & bit, node.nextEventTime, node.nextEventTicks, node.nextTicksValid);
+	}
+	recordEvent(ptr_module);
+	dirtyMask |= bit; // evaluate it again at the next tick (transient outputs)
+	return (node.toMask);
+}
+
+static void updateCompiled()
+{
+	// Nodes to evaluate: polled, dirty (changed input, reset, ISR...) and the passed deadlines:
+	uint32_t now = micros();
+	uint32_t dueMask = polledMask | dirtyMask;
+	dirtyMask = 0;
+	nextSignals = signals;
+	for (uint8_t k = 0; k < numCompiledNodes; k++)
+		if (compiledNodes[k].ptr_module->isDirty())
+			dueMask |= (1UL << k);
+	uint32_t timed = timedMask & ~dueMask;
+	while (timed)
+	{
+		uint8_t k = __builtin_ctz(timed);
+		timed &= timed - 1;
+		if ((int32_t)(now - compiledNodes[k].deadline) >= 0)
+			dueMask |= (1UL << k);
+	}
+
+	if (zeroDelay)
+	{ // the nodes are sorted, so the changes go to the next nodes in the same tick (and the links
+	  // backwards, that break the cycles, to the next tick):
+		while (dueMask)
+		{
+			uint8_t k = __builtin_ctz(dueMask);
+			dueMask &= dueMask - 1;
+			evaluateNode(k);
+			uint32_t toMask = refreshNode(k);
+			uint32_t aheadMask = ~((2UL << k) - 1); // nodes after k
+			dueMask |= (toMask & aheadMask);
+			dirtyMask |= (toMask & ~aheadMask);
+		}
+	}
+	else
+	{
+		for (uint32_t mask = dueMask; mask; mask &= mask - 1)
+			evaluateNode(__builtin_ctz(mask));
+		for (uint32_t mask = dueMask; mask; mask &= mask - 1)
+			dirtyMask |= refreshNode(__builtin_ctz(mask));
+	}
+}
+
+// Event driven update: only the modules that may change are evaluated (check Module::isDue), so
+// the time spent in the tick depends on the events rather than on the number of modules:
 void update()
 {
-	if (activeSequencer)
+	if (activeSequencer && compiled)
+		updateCompiled();
+	else if (activeSequencer && zeroDelay)
 	{
+		// The modules are sorted (sortPipeline), so each module is refreshed right after its evaluation
+		// and the next ones see its new output in the same tick:
+		uint32_t now = micros();
 		for (auto ptr_module : vectorPtrModules)
-			ptr_module->update();
+		{
+			if (ptr_module->isDue(now))
+			{
+				ptr_module->clearDirty();
+				ptr_module->update();
+				if (ptr_module->refreshStates())
+				{
+					recordEvent(ptr_module);
+					ptr_module->setDirty(); // evaluate it again at the next tick (transient outputs)
+					for (auto ptr_toModule : vectorPtrModules)
+						if (ptr_toModule->hasInputLink(ptr_module))
+							ptr_toModule->setDirty();
+				}
+			}
+		}
+	}
+	else if (activeSequencer)
+	{
+		uint32_t now = micros();
+		for (auto ptr_module : vectorPtrModules)
+		{
+			ptr_module->pendingRefresh = ptr_module->isDue(now);
+			if (ptr_module->pendingRefresh)
+			{
+				ptr_module->clearDirty();
+				ptr_module->update();
+			}
+		}
 
+		// Refresh the evaluated modules "in parallel", and propagate the changes along the links:
 		for (auto ptr_module : vectorPtrModules)
-			ptr_module->refreshStates();
+		{
+			if (ptr_module->pendingRefresh && ptr_module->refreshStates())
+			{
+				recordEvent(ptr_module);
+				ptr_module->setDirty(); // evaluate it again at the next tick (transient outputs)
+				for (auto ptr_toModule : vectorPtrModules)
+					if (ptr_toModule->hasInputLink(ptr_module))
+						ptr_toModule->setDirty();
+			}
+		}
+	}
+}
+
+void setRecording(bool _recording)
+{
+	if (_recording && !recording)
+	{ // a new record:
+		eventRecord.clear();
+		lostEvents = 0;
+	}
+	recording = _recording;
+}
+
+bool getRecording() { return (recording); }
+uint16_t getNumEvents() { return (eventRecord.available()); }
+uint32_t getLostEvents() { return (lostEvents); }
+
+static uint16_t popEvents(SequencerEvent *_events, uint16_t _maxEvents)
+{
+	uint16_t numEvents = 0;
+	while ((numEvents < _maxEvents) && eventRecord.pop(_events[numEvents]))
+		numEvents++;
+	return (numEvents);
+}
+
+void dumpEvents()
+{
+	// The events recorded while dumping stay for the next dump:
+	uint16_t numEvents = eventRecord.available();
+	println("> EVENTS " + String(numEvents) + "," + String(sizeof(SequencerEvent)) + "," + String(lostEvents),
+			LOG_LEVEL_ALWAYS);
+	Logger::flush(); // the binary data goes after the text already in the log
+
+	SequencerEvent block[SIZE_EVENT_BLOCK / sizeof(SequencerEvent)];
+	while (numEvents)
+	{
+		uint16_t numBlock = popEvents(block, min(numEvents, (uint16_t)(SIZE_EVENT_BLOCK / sizeof(SequencerEvent))));
+		Serial.write((const uint8_t *)block, numBlock * sizeof(SequencerEvent));
+		numEvents -= numBlock;
+	}
+}
+
+#ifdef USING_SD_CARD
+bool saveEvents(const char *_nameFile)
+{
+	String nameFile = String(_nameFile) + ".bin";
+	File myFile = SD.open(nameFile.c_str(), FILE_WRITE);
+	if (!myFile)
+	{
+		PRINTLN("> CANNOT OPEN " + nameFile);
+		return (false);
 	}
+
+	// Whole blocks of the card (the last one may be shorter):
+	uint8_t block[SIZE_EVENT_BLOCK];
+	uint16_t numEvents;
+	while ((numEvents = popEvents((SequencerEvent *)block, SIZE_EVENT_BLOCK / sizeof(SequencerEvent))) > 0)
+		myFile.write(block, numEvents * sizeof(SequencerEvent));
+	myFile.close();
+	return (true);
 }
+#else
+bool saveEvents(const char *_nameFile)
+{
+	PRINTLN("-- NO SD CARD INITIALIZED");
+	return (false);
+}
+#endif
 
 void displaySequencerStatus()
 {
@@ -393,6 +1307,11 @@ void displaySequencerStatus()
 
 	String msg = (getState() ? "ON" : "OFF");
 	PRINTLN("  1-Sequencer state : " + msg);
+	PRINTLN("    " + String(zeroDelay ? "zero delay (topological order)" : "one tick delay per link") +
+			String(compiled ? ", compiled" : ""));
+	PRINTLN("    recorder " + String(recording ? "ON" : "OFF") + ": " + String(eventRecord.available()) + " events, " +
+			String(lostEvents) + " lost");
+	PRINTLN("    tick=" + String(tickUs) + "us, longest tick=" + String(maxTickTime) + "us, overruns=" + String(overruns));
 
 	if (vectorPtrModules.empty())
 		PRINTLN("  2-Pipeline : EMPTY");
@@ -402,13 +1321,13 @@ void displaySequencerStatus()
 		PRINTLN("  2-Pipeline (" + String(vectorPtrModules.size()) + " modules) : ");
 		for (uint8_t k = 0; k < vectorPtrModules.size() - 1; k++)
 		{
-			if ((vectorPtrModules[k])->getPtrModuleFrom() != NULL)
-				numCon++;
+			numCon += (vectorPtrModules[k])->getNumInputLinks();
 			PRINT("     " + String(k) + " : ");
 			PRINTLN((vectorPtrModules[k])->getName() + (vectorPtrModules[k])->getParamString());
 			//PRINT(", ");
 		}
-		PRINT("     " + String(vectorPtrModules.size()) + " : ");
+		numCon += vectorPtrModules.back()->getNumInputLinks();
+		PRINT("     " + String(vectorPtrModules.size() - 1) + " : ");
 		PRINT(vectorPtrModules.back()->getName() + vectorPtrModules.back()->getParamString());
 		PRINTLN(" }");
 		PRINTLN("");
@@ -416,9 +1335,9 @@ void displaySequencerStatus()
 		numCon = 1;
 		for (auto ptr_module : vectorPtrModules)
 		{
-			Module *ptr_fromModule = ptr_module->getPtrModuleFrom(); // NULL if there is no input module
-			if (ptr_fromModule != NULL)
+			for (uint8_t i = 0; i < ptr_module->getNumInputLinks(); i++)
 			{
+				Module *ptr_fromModule = ptr_module->getInputLink(i);
 				PRINT("     " + String(numCon++) + " : ");
 				PRINT(ptr_fromModule->getName()); // + ptr_fromModule->getParamString());
 				PRINT(" >> ");
@@ -464,58 +1383,101 @@ void init()
 	PRINTLN("> LASERS READY");
 }
 
-void test()
-{ // Switch lasers one by one and try a power ramp on each of these:
-	// TODO: have a state variable for current color (in graphics.h), with a push/pop method
+// Switch lasers one by one and try a power ramp on each of these (state machine driven by update()):
+enum StateLaserTest
+{
+	LASER_TEST_RAMP_UP = 0,
+	LASER_TEST_RAMP_DOWN,
+	LASER_TEST_PAUSE
+};
+
+static bool testRunning = false;
+static StateLaserTest stateTest;
+static uint8_t testLaser;
+static int16_t testPower;
+static elapsedMillis testTimer;
+
+static void startTestLaser(uint8_t _laserIndex)
+{
+	PRINT("TEST LASER [" + String(_laserIndex) + "] (" + Definitions::laserNames[_laserIndex] + ")");
+	PRINTLN(_laserIndex);
+	testLaser = _laserIndex;
+	testPower = 0;
+	setStateSwitch(testLaser, true);
+	setStatePower(testLaser, testPower);
+	stateTest = LASER_TEST_RAMP_UP;
+	testTimer = 0;
+}
 
-	//Stop scan and recenter, to be able to measure the power of the beam?
-	// or continue scanning the current figure?
-	// bool previousState = DisplayScan::getRunningState();
-	// if (previousState) DisplayScan::stopDisplay();
-	// Scanner::recenterPosRaw();
+void test()
+{
+	stopTests();
 
 	pushState(); // save current laser state
 	setStateCarrierAll(false);
 
-	elapsedMillis msTime;
-
 	PRINTLN("TESTING LASERS: ");
+	testRunning = true;
+	startTestLaser(0);
+}
 
-	for (uint8_t i = 0; i < NUM_LASERS; i++)
-	{
-		PRINT("TEST LASER [" + String(i) + "] (" + Definitions::laserNames[i] + ")");
-		PRINTLN(i);
-		setStateSwitch(i, true);
+void stopTest()
+{
+	if (!testRunning)
+		return;
+	testRunning = false;
+	popState(); // back to current laser state.
+}
+
+bool isTestRunning() { return (testRunning); }
+
+void update()
+{
+	if (!testRunning)
+		return;
 
-		for (uint16_t p = 0; p < MAX_LASER_POWER; p += 100)
+	switch (stateTest)
+	{
+	case LASER_TEST_RAMP_UP:
+		if (testTimer >= LASER_TEST_STEP_TIME)
 		{
-			setStatePower(i, p);
-			//	PRINT("power: "); PRINTLN(p);
-			msTime = 0;
-			while (msTime < 50)
+			testTimer = 0;
+			testPower += LASER_TEST_POWER_STEP;
+			if (testPower >= MAX_LASER_POWER)
 			{
+				testPower = MAX_LASER_POWER;
+				stateTest = LASER_TEST_RAMP_DOWN;
 			}
+			setStatePower(testLaser, testPower);
 		}
-		for (int16_t p = MAX_LASER_POWER; p >= 0; p -= 100)
-		{ // attn with the >= on uint!!
-			setStatePower(i, p);
-			//	PRINT("power: "); PRINTLN(p);
-			msTime = 0;
-			while (msTime < 50)
-				;
-		}
+		break;
 
-		setStateSwitch(i, false);
+	case LASER_TEST_RAMP_DOWN:
+		if (testTimer >= LASER_TEST_STEP_TIME)
+		{
+			testTimer = 0;
+			testPower -= LASER_TEST_POWER_STEP; // attn: signed power
+			if (testPower <= 0)
+			{
+				setStatePower(testLaser, 0);
+				setStateSwitch(testLaser, false);
+				stateTest = LASER_TEST_PAUSE;
+			}
+			else
+				setStatePower(testLaser, testPower);
+		}
+		break;
 
-		msTime = 0;
-		while (msTime < 500)
-			;
+	case LASER_TEST_PAUSE:
+		if (testTimer >= LASER_TEST_PAUSE_TIME)
+		{
+			if (testLaser + 1 < NUM_LASERS)
+				startTestLaser(testLaser + 1);
+			else
+				stopTest();
+		}
+		break;
 	}
-
-	popState(); // back to current laser state.
-
-	// restart the ISR?
-	//	if (previousState) DisplayScan::startDisplay();
 }
 
 } // namespace Lasers
@@ -599,163 +1561,112 @@ void init()
 //inline void setMirrorsTo(uint16_t _posX, uint16_t _posY);
 //inline void recenterMirrors();
 
-// Repeatedly make a square 50x50 points by side;
-void testMirrorRange(uint16_t _durationSec)
+// Test figure (in ADC units) and the display engine state to restore when finished:
+static P2 testPatternBuffer[TEST_PATTERN_MAX_POINTS];
+static uint8_t testPatternMask[TEST_PATTERN_MAX_POINTS];
+static bool testRunning = false;
+static bool previousRunningState;
+static uint32_t previousInterPointTime;
+static uint32_t testDuration; // in ms
+static elapsedMillis testTimer;
+
+static void startTestPattern(uint16_t _numPoints, uint16_t _durationSec)
 {
-	elapsedMicros usec = 0; // better interface than using micros(),
-	// but using it internally. ISR priority: 32
-	elapsedMillis msec = 0;
+	stopTests();
+	Lasers::pushState(); // the tests may change the laser state
 
-	// First, stop the ISR whatever its state:
-	bool previousState = DisplayScan::getRunningState();
-	if (previousState)
-		DisplayScan::stopDisplay();
+	previousRunningState = DisplayScan::getRunningState();
+	previousInterPointTime = DisplayScan::getInterPointTime();
 
-	uint16_t stepX = (MAX_MIRRORS_ADX - MIN_MIRRORS_ADX) / 100;
-	uint16_t stepY = (MAX_MIRRORS_ADY - MIN_MIRRORS_ADY) / 100;
-	uint16_t x = MIN_MIRRORS_ADX, y = MIN_MIRRORS_ADY;
+	for (uint16_t k = 0; k < _numPoints; k++)
+		testPatternMask[k] = LASER_MASK_ALL;
 
-	// Prepare initial position (wait a little more)
-	analogWrite(PIN_ADCX, x);
-#ifdef TEENSY_35_36
-	analogWrite(PIN_ADCY, y);
-#endif
-	while (usec < 300)
-		;
-	usec = 0;
+	DisplayScan::setInterPointTime(TEST_PATTERN_DT);
+	DisplayScan::setDisplayBuffer(testPatternBuffer, testPatternMask, _numPoints);
+	DisplayScan::startDisplay();
 
-	while (msec < (_durationSec * 1000))
-	{
-		// Make a square 50x50 points side:
-		do
-		{
-#ifdef TEENSY_35_36
-			analogWrite(PIN_ADCY, y);
-#endif
-			y += stepY;
-			while (usec < 100)
-				;
-			usec = 0; // wait 100us
-		} while (y < MAX_MIRRORS_ADY);
-		y -= stepY;
-		do
-		{
-			analogWrite(PIN_ADCX, x);
-			x += stepX;
-			while (usec < 100)
-				;
-			usec = 0; // wait 100us
-		} while (x < MAX_MIRRORS_ADX);
-		x -= stepX;
-		do
-		{
-			y -= stepY;
-#ifdef TEENSY_35_36
-			analogWrite(PIN_ADCY, y);
-#endif
-			while (usec < 100)
-				;
-			usec = 0; // wait 100us
-		} while (y > MIN_MIRRORS_ADY);
-		//y=MIN_MIRRORS_ADY;
-		do
-		{
-			x -= stepX;
-			analogWrite(PIN_ADCX, x);
-			while (usec < 100)
-				;
-			usec = 0; // wait 100us
-		} while (x > MIN_MIRRORS_ADX);
-		//x=MIN_MIRRORS_ADX;
-	}
-	recenterPosRaw();
-	// restart the ISR?
-	if (previousState)
-		DisplayScan::startDisplay();
+	testDuration = 1000UL * _durationSec;
+	testTimer = 0;
+	testRunning = true;
+}
+
+// Repeatedly make a square showing the limits of the galvos (100 points by side):
+void testMirrorRange(uint16_t _durationSec)
+{
+	float stepX = 1.0f * (MAX_MIRRORS_ADX - MIN_MIRRORS_ADX) / TEST_PATTERN_SIDE_POINTS;
+	float stepY = 1.0f * (MAX_MIRRORS_ADY - MIN_MIRRORS_ADY) / TEST_PATTERN_SIDE_POINTS;
+	uint16_t n = 0;
+
+	for (uint16_t k = 0; k < TEST_PATTERN_SIDE_POINTS; k++)
+		testPatternBuffer[n++] = P2(MIN_MIRRORS_ADX, MIN_MIRRORS_ADY + stepY * k);
+	for (uint16_t k = 0; k < TEST_PATTERN_SIDE_POINTS; k++)
+		testPatternBuffer[n++] = P2(MIN_MIRRORS_ADX + stepX * k, MAX_MIRRORS_ADY);
+	for (uint16_t k = 0; k < TEST_PATTERN_SIDE_POINTS; k++)
+		testPatternBuffer[n++] = P2(MAX_MIRRORS_ADX, MAX_MIRRORS_ADY - stepY * k);
+	for (uint16_t k = 0; k < TEST_PATTERN_SIDE_POINTS; k++)
+		testPatternBuffer[n++] = P2(MAX_MIRRORS_ADX - stepX * k, MIN_MIRRORS_ADY);
+
+	startTestPattern(n, _durationSec);
 }
 
 void testCircleRange(uint16_t _durationSec)
 {
-	// first, stop the ISR whatever its state:
-	bool previousState = DisplayScan::getRunningState();
-	if (previousState)
-		DisplayScan::stopDisplay();
-	elapsedMicros usec = 0;
-	elapsedMillis msec = 0;
-	while (msec < _durationSec * 1000)
+	// 360 points (one per degree):
+	for (uint16_t k = 0; k < 360; k++)
 	{
-		//while (usec < 1000) ; // wait
-		//usec = 0;
-		for (uint16_t k = 0; k < 360; k++)
-		{
-			float phi = 1.0 * DEG_TO_RAD * k;
-			uint16_t x = (uint16_t)(1.0 * CENTER_MIRROR_ADX * (1.0 + cos(phi)));
-			uint16_t y = (uint16_t)(1.0 * CENTER_MIRROR_ADY * (1.0 + sin(phi)));
-			analogWrite(PIN_ADCX, x);
-#ifdef TEENSY_35_36
-			analogWrite(PIN_ADCY, y);
-#endif
-			while (usec < 100)
-				; // wait
-			usec = 0;
-		}
+		float sinPhi, cosPhi;
+		FastMath::sinCos(FastMath::DEG_TO_RAD_F * k, sinPhi, cosPhi);
+		testPatternBuffer[k] = P2(CENTER_MIRROR_ADX * (1.0f + cosPhi), CENTER_MIRROR_ADY * (1.0f + sinPhi));
 	}
-	recenterPosRaw();
-	// restart the ISR?
-	if (previousState)
-		DisplayScan::startDisplay();
+
+	startTestPattern(360, _durationSec);
+	Lasers::setStatePowerAll(1000);
+	Lasers::setStateSwitchAll(true);
 }
 
 void testCrossRange(uint16_t _durationSec)
 {
-	// first, stop the ISR whatever its state:
-	bool previousState = DisplayScan::getRunningState();
-	if (previousState)
-		DisplayScan::stopDisplay();
+	float stepX = 1.0f * (MAX_MIRRORS_ADX - MIN_MIRRORS_ADX) / TEST_PATTERN_SIDE_POINTS;
+	float stepY = 1.0f * (MAX_MIRRORS_ADY - MIN_MIRRORS_ADY) / TEST_PATTERN_SIDE_POINTS;
+	uint16_t n = 0;
+
+	// vertical line:
+	for (uint16_t k = 0; k < TEST_PATTERN_SIDE_POINTS; k++)
+		testPatternBuffer[n++] = P2(CENTER_MIRROR_ADX, MIN_MIRRORS_ADY + stepY * k);
+	// horizontal line:
+	for (uint16_t k = 0; k < TEST_PATTERN_SIDE_POINTS; k++)
+		testPatternBuffer[n++] = P2(MIN_MIRRORS_ADX + stepX * k, CENTER_MIRROR_ADY);
+
+	startTestPattern(n, _durationSec);
+	Lasers::setStatePowerAll(1000);
+	Lasers::setStateSwitchAll(true);
+}
 
-	uint16_t stepX = (MAX_MIRRORS_ADX - MIN_MIRRORS_ADX) / 100;
-	uint16_t stepY = (MAX_MIRRORS_ADY - MIN_MIRRORS_ADY) / 100;
+void stopTest()
+{
+	if (!testRunning)
+		return;
+	testRunning = false;
 
-	uint16_t x, y;
-	elapsedMicros usec = 0;
-	elapsedMillis msec = 0;
+	DisplayScan::setInterPointTime(previousInterPointTime);
+	Lasers::popState();
 
-	while (msec < (_durationSec * 1000))
+	// The blueprint was not modified by the test, so we only need to render it again
+	// (NOTE: this restarts the display engine):
+	Renderer2D::renderFigure();
+	if (!previousRunningState)
 	{
-
-		// vertical line:
-		y = MIN_MIRRORS_ADY;
-		analogWrite(PIN_ADCX, CENTER_MIRROR_ADX);
-		do
-		{
-#ifdef TEENSY_35_36
-			analogWrite(PIN_ADCY, y);
-#endif
-			y += stepY;
-			while (usec < 100)
-				;
-			usec = 0; // wait 100us
-		} while (y < MAX_MIRRORS_ADY);
-
-		// horizontal line:
-		x = MIN_MIRRORS_ADX;
-#ifdef TEENSY_35_36
-		analogWrite(PIN_ADCY, CENTER_MIRROR_ADY);
-#endif
-		do
-		{
-			analogWrite(PIN_ADCX, x);
-			x += stepX;
-			while (usec < 100)
-				;
-			usec = 0; // wait 100us
-		} while (x < MAX_MIRRORS_ADX);
+		DisplayScan::stopDisplay();
+		recenterPosRaw();
 	}
+}
 
-	recenterPosRaw();
+bool isTestRunning() { return (testRunning); }
 
-	if (previousState)
-		DisplayScan::startDisplay();
+void update()
+{
+	if (testRunning && (testTimer >= testDuration))
+		stopTest();
 }
 
 } // namespace Scanner
@@ -778,24 +1689,22 @@ void init()
 	// lcd.setPWM(REG_GREEN, i);
 }
 
-// wrappers for LCD display - could do more than just wrap the lcd methods, i.e, vertical scroll with interruption, etc.
-void print(String text)
-{
-	//lcd.clear();
-	lcd.print(text);
-}
-
-void println(String text)
+// Called by the logger, one character at a time:
+void putChar(char _val)
 {
 	static uint8_t row = 0;
-	lcd.print(text);
-	row++;
-	if (row == 2)
+	if (_val == '\n')
 	{
-		row = 0;
-		//lcd.clear();
+		row++;
+		if (row == 2)
+		{
+			row = 0;
+			//lcd.clear();
+		}
+		lcd.setCursor(0, row);
 	}
-	lcd.setCursor(0, row);
+	else
+		lcd.write(_val);
 }
 
 #endif
@@ -833,23 +1742,20 @@ void init()
 	tft.setTextSize(0.8);
 }
 
-// wrappers for LCD display - could do more than just wrap the lcd methods, i.e, vertical scroll with interruption, etc.
-void print(String text)
-{
-	//tft.setCursor(row, 0);// on the current row
-	tft.print(text);
-}
-
-void println(String text)
+// Called by the logger, one character at a time.
+// NOTE: instead of clearing the whole screen every TFT_TEXT_ROWS lines (very slow with software SPI),
+// only the next row is cleared when starting a line, so the text "rolls" over the screen:
+void putChar(char _val)
 {
-	row = (row + 1) % 16;
-	if (!row)
+	if (_val == '\n')
 	{
-		tft.fillScreen(ST7735_BLACK);
-		tft.setCursor(0, 5);
+		row = (row + 1) % TFT_TEXT_ROWS;
+		uint16_t y = 5 + row * TFT_TEXT_ROW_HEIGHT;
+		tft.fillRect(0, y, tft.width(), TFT_TEXT_ROW_HEIGHT, ST7735_BLACK);
+		tft.setCursor(0, y);
 	}
-	tft.print(text);
-	tft.print("\n");
+	else
+		tft.write(_val);
 }
 
 void setPixel(uint16_t x, uint16_t y)
@@ -8,6 +8,10 @@
 #include "Class_OptoTuner.h"
 #include "Class_Sequencer.h"
 #include "Utils.h"
+#include "fastMath.h"
+#include "logger.h"
+#include "Class_RingBuffer.h"
+#include <util/atomic.h> // the laser writes of the display ISR are atomic
 
 #ifdef USING_SD_CARD
 #include <SD.h>
@@ -36,12 +40,24 @@ void init();
 //Software reset: better than using the RST pin (noisy?)
 extern void resetBoard();
 
+// LED blinking does not block: the patterns are queued, and played by update()
+#define MAX_LED_CHANNELS 4 // different leds that can be blinking at the same time
+#define SIZE_LED_QUEUE 8   // pending patterns per led (power of 2)
+
 extern void blinkLed(uint8_t _pinLed, uint8_t _times, uint32_t _periodMicros);
 extern void blinkLedDebug(uint8_t _times, uint32_t _periodMicros = 1000000); // default period of 1s
 extern void blinkLedMessage(uint8_t _times, uint32_t _periodMicros = 1000000);
 
-extern void print(String _string);
-extern void println(String _string);
+// NOTE: the const char* versions avoid building a String (and a heap allocation) for fixed messages
+extern void print(const char *_string, uint8_t _level = LOG_LEVEL_INFO);
+extern void println(const char *_string, uint8_t _level = LOG_LEVEL_INFO);
+extern void print(const String &_string, uint8_t _level = LOG_LEVEL_INFO);
+extern void println(const String &_string, uint8_t _level = LOG_LEVEL_INFO);
+
+// Background tasks (led patterns, test patterns): must be called from loop(). The tests return immediately and
+// run while the rest of the program (serial commands, sequencer...) continues working:
+extern void update();
+extern void stopTests(); // cancel whatever test is running
 
 namespace Gpio
 {
@@ -151,6 +167,15 @@ extern Clock arrayClock[NUM_CLOCKS];
 extern void setStateAllClocks(bool _startStop);
 extern void resetAllClocks();
 
+// A clock can be bound to a PIT channel: the edges on the pin are then generated by the timer ISR (drift free
+// and without the jitter of the sequencer tick), and the sequencer pipeline follows them.
+// NOTE: the display and the sequencer use two of the four PIT channels.
+#define NUM_CLOCK_TIMERS 2
+#define CLOCK_ISR_PRIORITY 32 // higher than the sequencer (96) and the display (112) ISRs
+extern bool bindTimer(uint8_t _clockID, uint8_t _pin);
+extern void unbindTimer(uint8_t _clockID);
+extern bool checkTimers(); // false if a clock lost its timer (reset with a period the timer does not accept)
+
 } // namespace Clocks
 
 // ====================================================================================
@@ -159,6 +184,9 @@ extern void resetAllClocks();
 namespace ExtTriggers
 {
 extern InputTrigger arrayTriggerIn[NUM_EXT_TRIGGERS_IN];
+
+// Attach the pin change interrupts of the input triggers (edge capture instead of polling the pins):
+extern void init();
 extern OutputTrigger arrayTriggerOut[NUM_EXT_TRIGGERS_OUT];
 } // namespace ExtTriggers
 
@@ -177,6 +205,53 @@ namespace Pulsars
 extern Pulsar arrayPulsar[NUM_PULSARS];
 }
 
+// ====================================================================================
+// ============================ NAMESPACE LOGIC GATES =================================
+namespace LogicGates
+{
+extern LogicGate arrayLogicGate[NUM_LOGIC_GATES];
+}
+
+// ====================================================================================
+// ============================ NAMESPACE WAVEFORMS ===================================
+namespace Waveforms
+{
+extern Waveform arrayWaveform[NUM_WAVEFORMS];
+}
+
+// ====================================================================================
+// ============================ NAMESPACE DELAY LINES =================================
+namespace DelayLines
+{
+extern DelayLine arrayDelayLine[NUM_DELAY_LINES];
+}
+
+// ====================================================================================
+// ============================ NAMESPACE ONE SHOTS ===================================
+// Output edges scheduled on the compare channels of the FTM1 timer (PIN_ONE_SHOT_A/B): the pin changes exactly
+// at the scheduled time (with the resolution of the timer clock, F_BUS/4), whatever the sequencer tick. The
+// modules with edges to output (pulsars, delay lines) are bound to a channel with bindModule. The timer also
+// timestamps the input trigger edges, so the edges derived from them are exact relative to the input (other
+// events are converted from their micros() time, with 1us resolution).
+// NOTE: the counter is only 16 bits (4.4ms at 15MHz), the upper bits are counted by the overflow interrupt.
+namespace OneShots
+{
+#define NUM_ONE_SHOTS 2
+#define ONE_SHOT_ISR_PRIORITY 48 // higher than the sequencer (96), that schedules the edges
+#define SIZE_ONE_SHOT_QUEUE 8	 // pending edges per channel (power of 2)
+#define ONE_SHOT_MIN_LEAD 16	 // in timer ticks: the late edges are output right away
+
+extern void init();
+extern uint32_t nowTicks(); // timer count extended to 32 bits (ONE_SHOT_TICKS_PER_US)
+// The edge goes at _offsetTicks after the event; in ticks if the event was timestamped by the timer, otherwise
+// converted from its micros() time. Returns false if the queue of the channel is full (the edge is lost):
+extern bool scheduleEdge(uint8_t _channel, const EventTime &_time, uint32_t _offsetTicks, bool _level);
+extern void cancelEdges(uint8_t _channel); // and the pin goes low
+extern void cancelAllEdges();
+extern bool bindModule(Module *_ptrModule, uint8_t _channel); // false without one shot outputs (Teensy 3.1/3.2)
+extern void unbindModule(Module *_ptrModule);					// and its pending edges are cancelled
+} // namespace OneShots
+
 // ====================================================================================
 // ============================ NAMESPACE SEQUENCER ===================================
 /* This namespace contain methods to store and build the sequencer graph, as well as update and
@@ -195,9 +270,29 @@ extern bool activeSequencer; // this is useful to stop the whole sequencer inste
 
 extern Module *getModulePtr(uint8_t _classID, uint8_t _index);
 
+// The sequencer is updated in a timer interrupt at a fixed tick (and not from loop()), so the clock
+// periods and pulse times do not depend on the command traffic or the rendering.
+// NOTE: a tick longer than the tick period is counted as an overrun (the following ticks are then late).
+// After MAX_CONSECUTIVE_OVERRUNS overruns in a row the tick period is doubled, and the sequencer is stopped
+// if it still overruns at MAX_SEQUENCER_TICK: otherwise the timer would fire back to back and starve loop()
+// (no command could stop it). checkOverruns() reports these changes from loop().
+// The pipeline is only modified with the interrupts disabled; changing the parameters of a module while
+// the sequencer runs can at most affect one tick.
+#define DEFAULT_SEQUENCER_TICK 10 // in us
+#define MIN_SEQUENCER_TICK 5	  // in us
+#define MAX_SEQUENCER_TICK 1000	  // in us (only reached by the overrun back-off)
+#define MAX_CONSECUTIVE_OVERRUNS 16
+#define SEQUENCER_ISR_PRIORITY 96 // higher priority than the display engine ISR (112)
+
 extern void setState(bool _active); // activate/deactivate sequencer
 extern bool getState();
 
+extern bool setTick(uint32_t _tickUs); // false if too short
+extern uint32_t getTick();
+extern uint32_t getOverruns();
+extern uint32_t getMaxTickTime(); // in us
+extern void checkOverruns();	  // called from loop()
+
 extern void reset();
 
 extern void addModulePipeline(Module *ptr_newModule);
@@ -206,9 +301,51 @@ extern void disconnectModules();
 
 extern void clearPipeline();
 
+// By default, each link adds one tick of delay (each module reads the output of its input module at the
+// previous tick). In zero delay mode, the modules are evaluated in topological order (sortPipeline is called
+// by compilePipeline, each time the pipeline or a link changes), so an event goes through a whole chain in
+// a single tick. Cycles are broken with a one tick delay.
+extern void sortPipeline();
+
+// The pipeline is compiled (each time it changes) into a flat array of nodes, with the links and the modules
+// to evaluate as bit masks, and the outputs packed in a word. The logic gates and trigger processors are
+// evaluated from that word without virtual calls (packedLogic.h); the other modules (clocks, input triggers,
+// lasers...) are still evaluated through their virtual methods. Larger pipelines are scanned module by
+// module at each tick.
+// NOTE: the tick is still at least MIN_SEQUENCER_TICK (the IntervalTimer interrupt and micros() cost more
+// than the evaluation of a few gates).
+#define MAX_COMPILED_MODULES 32 // one bit per module in a 32 bits word
+extern void compilePipeline();
+extern void setZeroDelayMode(bool _zeroDelay);
+extern bool getZeroDelayMode();
+
 extern void displaySequencerStatus();
 
-extern void update();
+// Event recorder: each change of output is recorded with the time of the event and the module that changed,
+// identified by its class index and ID (the pipeline order changes with the links, these do not). The events
+// can be dumped in binary form to the serial port (after a text header "> EVENTS <number>,<bytes per event>,
+// <lost events>"), or saved to the SD card (file <name>.bin), by blocks. Either way, the dumped events are
+// removed from the record, so long records are read while recording.
+// NOTE: the record is small on purpose (3.5kB): the RAM is mostly taken by the display buffers.
+#define SIZE_EVENT_RECORD 512 // events (power of 2)
+#define SIZE_EVENT_BLOCK 512  // bytes dumped or saved at once (sector size of the SD card)
+
+struct __attribute__((packed)) SequencerEvent
+{
+	uint32_t time;		// micros() time base
+	uint8_t classIndex; // Definitions::ClassIndexes
+	uint8_t id;			// myID of the module in its class
+	uint8_t state;		// new output
+};
+
+extern void setRecording(bool _recording); // starting a record clears the previous one
+extern bool getRecording();
+extern uint16_t getNumEvents();
+extern uint32_t getLostEvents();
+extern void dumpEvents();
+extern bool saveEvents(const char *_nameFile);
+
+extern void update(); // one tick (called by the sequencer ISR)
 
 } // namespace Sequencer
 
@@ -224,7 +361,15 @@ extern Laser laserArray[NUM_LASERS]; //= {"RED", "GREEN", "BLUE", "D-BLUE"};
 // ****************** METHODS ********************
 // NOTE: namespace methods correspond to static methods of the class Laser
 void init();
+
+// Power ramp on each laser, one after the other (non blocking, driven by update()):
+#define LASER_TEST_POWER_STEP 100
+#define LASER_TEST_STEP_TIME 50   // in ms
+#define LASER_TEST_PAUSE_TIME 500 // in ms, between two lasers
 extern void test();
+extern void stopTest();
+extern bool isTestRunning();
+extern void update();
 
 inline void enableLasers()
 {
@@ -251,10 +396,16 @@ inline void setStateSwitchAll(bool _switch)
 		laserArray[i].setStateSwitch(_switch);
 }
 
+// NOTE: the sequencer ISR (Laser::action) preempts the display ISR, and both write the laser switches. The
+// methods called by the display ISR are atomic, so a state set by the sequencer is never overwritten by a
+// stale copy (the sequencer ISR itself cannot be interrupted by the display ISR).
 inline void switchOffAll()
 { // <<-- without affecting the state!
-	for (uint8_t i = 0; i < NUM_LASERS; i++)
-		laserArray[i].setSwitch(LOW);
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (uint8_t i = 0; i < NUM_LASERS; i++)
+			laserArray[i].setSwitch(LOW);
+	}
 }
 inline void switchOnAll()
 { // <<-- without affecting the state!
@@ -262,6 +413,26 @@ inline void switchOnAll()
 		laserArray[i].setSwitch(HIGH);
 }
 
+// Per-point laser mask applied by the display engine (bit k = laser k). It does not affect the state.
+inline void setSwitchMask(uint8_t _laserMask)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (uint8_t i = 0; i < NUM_LASERS; i++)
+			laserArray[i].setSwitchMasked((_laserMask >> i) & 1);
+	}
+}
+
+// Switch off the lasers in blanking mode (between figures), without affecting the state:
+inline void updateBlankAll()
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		for (uint8_t k = 0; k < NUM_LASERS; k++)
+			laserArray[k].updateBlank();
+	}
+}
+
 inline void setStatePower(int8_t _laserIndex, uint16_t _power)
 {
 	if (_laserIndex >= 0) // otherwise do nothing
@@ -322,9 +493,10 @@ inline void updateIntensityBlanking()
 
 inline void setToCurrentState()
 {
-	for (uint8_t k = 0; k < NUM_LASERS; k++)
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
 	{
-		laserArray[k].setToCurrentState();
+		for (uint8_t k = 0; k < NUM_LASERS; k++)
+			laserArray[k].setToCurrentState();
 	}
 	updateIntensityBlanking();
 }
@@ -456,13 +628,18 @@ inline bool clipLimits(P2 &_point)
 }
 
 // Low level ADC test (also visual scanner range check).
-// NOTE: this method does not uses any buffer, so it should be
-// called when the DisplayScan is paused or stopped [if this is
-// not done, it should work anyway but with a crazy back and forth
-// of the galvano mirrors:
+// NOTE: the test figures are given in ADC units directly to the display engine (the blueprint is not
+// touched), displayed during _durationSec and then the current figure is rendered again by update().
+// The laser state is restored at the end of the test too.
+#define TEST_PATTERN_DT 100 // inter-point time of the test figures, in us
+#define TEST_PATTERN_SIDE_POINTS 100
+#define TEST_PATTERN_MAX_POINTS (4 * TEST_PATTERN_SIDE_POINTS)
 extern void testMirrorRange(uint16_t _durationSec);
 extern void testCircleRange(uint16_t _durationSec);
 extern void testCrossRange(uint16_t _durationSec);
+extern void stopTest();
+extern bool isTestRunning();
+extern void update();
 
 } // namespace Scanner
 
@@ -472,9 +649,7 @@ namespace Lcd
 
 extern rgb_lcd lcd;
 extern void init();
-// wrappers for LCD display - could do more than just wrap the lcd methods, i.e, vertical scroll with interruption, etc.
-extern void print(String text);
-extern void println(String text);
+extern void putChar(char _val); // the text is sent by the logger (check logger.h)
 
 #endif
 } // namespace Lcd
@@ -483,9 +658,11 @@ namespace Tft
 {
 #ifdef DEBUG_MODE_TFT
 
+#define TFT_TEXT_ROWS 16
+#define TFT_TEXT_ROW_HEIGHT 8 // in pixels
+
 extern void init();
-extern void print(String text);
-extern void println(String text);
+extern void putChar(char _val); // the text is sent by the logger (check logger.h)
 
 #endif
 } // namespace Tft
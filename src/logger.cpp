@@ -0,0 +1,131 @@
+#include "logger.h"
+#include "hardware.h"
+
+namespace Logger
+{
+
+#define LOG_MASK (SIZE_LOG_BUFFER - 1)
+
+char logBuffer[SIZE_LOG_BUFFER];
+uint32_t head = 0;               // number of characters written since boot (the index is head & LOG_MASK)
+uint32_t tail[NUM_LOG_SINKS];    // number of characters sent by each sink
+uint32_t droppedChars = 0;
+
+const bool activeSink[NUM_LOG_SINKS] = {
+#if defined DEBUG_MODE_SERIAL
+    true,
+#else
+    false,
+#endif
+#if defined DEBUG_MODE_LCD
+    true,
+#else
+    false,
+#endif
+#if defined DEBUG_MODE_TFT
+    true
+#else
+    false
+#endif
+};
+
+// Serial port: contiguous chunks, without exceeding the space in the USB/UART buffer unless blocking:
+static void drainSerial(bool _blocking)
+{
+#if defined DEBUG_MODE_SERIAL
+  elapsedMicros timeSlice = 0;
+  while (tail[LOG_SINK_SERIAL] != head)
+  {
+    uint32_t index = tail[LOG_SINK_SERIAL] & LOG_MASK;
+    uint32_t chunk = min(head - tail[LOG_SINK_SERIAL], SIZE_LOG_BUFFER - index);
+    if (!_blocking)
+    {
+      int room = Serial.availableForWrite();
+      if (room <= 0)
+        break;
+      chunk = min(chunk, (uint32_t)room);
+    }
+    Serial.write((const uint8_t *)logBuffer + index, chunk);
+    tail[LOG_SINK_SERIAL] += chunk;
+    if (!_blocking && (timeSlice >= LOG_SERIAL_TIME_BUDGET))
+      break;
+  }
+#else
+  tail[LOG_SINK_SERIAL] = head;
+#endif
+}
+
+// Displays: character by character (the drawing is slow):
+static void drainDisplay(uint8_t _sink, uint32_t _timeBudget)
+{
+  elapsedMicros timeSlice = 0;
+  while ((tail[_sink] != head) && ((timeSlice < _timeBudget) || !_timeBudget))
+  {
+    char val = logBuffer[tail[_sink] & LOG_MASK];
+    tail[_sink]++;
+#if defined DEBUG_MODE_LCD
+    if (_sink == LOG_SINK_LCD)
+      Hardware::Lcd::putChar(val);
+#endif
+#if defined DEBUG_MODE_TFT
+    if (_sink == LOG_SINK_TFT)
+      Hardware::Tft::putChar(val);
+#endif
+  }
+}
+
+void write(uint8_t _level, const char *_string)
+{
+  if (_level < LOG_MIN_LEVEL)
+    return;
+
+  while (*_string)
+  {
+    // Make room for one character in each sink:
+    if (head - tail[LOG_SINK_SERIAL] >= SIZE_LOG_BUFFER)
+      drainSerial(true);
+    for (uint8_t k = LOG_SINK_LCD; k < NUM_LOG_SINKS; k++)
+    {
+      if (head - tail[k] >= SIZE_LOG_BUFFER)
+      {
+        tail[k]++;
+        if (activeSink[k])
+          droppedChars++;
+      }
+    }
+
+    logBuffer[head & LOG_MASK] = *_string++;
+    head++;
+  }
+
+  // Inactive sinks just follow:
+  for (uint8_t k = 0; k < NUM_LOG_SINKS; k++)
+    if (!activeSink[k])
+      tail[k] = head;
+}
+
+void update()
+{
+  drainSerial(false);
+#if defined DEBUG_MODE_LCD
+  drainDisplay(LOG_SINK_LCD, LOG_LCD_TIME_BUDGET);
+#endif
+#if defined DEBUG_MODE_TFT
+  drainDisplay(LOG_SINK_TFT, LOG_TFT_TIME_BUDGET);
+#endif
+}
+
+void flush()
+{
+  drainSerial(true);
+#if defined DEBUG_MODE_LCD
+  drainDisplay(LOG_SINK_LCD, 0);
+#endif
+#if defined DEBUG_MODE_TFT
+  drainDisplay(LOG_SINK_TFT, 0);
+#endif
+}
+
+uint32_t getDroppedChars() { return (droppedChars); }
+
+} // namespace Logger
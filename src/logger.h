@@ -0,0 +1,49 @@
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+// Asynchronous logging. PRINT/PRINTLN (Hardware::print/println) only copy the message into a ring
+// buffer; the characters are sent to each output ("sink": serial port, LCD, TFT) by update(), called
+// from loop(), within a time budget per sink. Each sink has its own read position in the ring, so a
+// slow sink (the software SPI TFT) does not delay the others.
+// NOTE 1: if the serial port falls a whole buffer behind, the pending characters are written
+// synchronously (nothing is lost on the serial port: it also carries the protocol replies). A display
+// instead loses its oldest characters (counted by getDroppedChars()).
+// NOTE 2: messages below LOG_MIN_LEVEL are removed at compile time (check PRINT_DEBUG in Utils.h).
+
+#include "Arduino.h"
+#include "Definitions.h"
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_ALWAYS 4 // not affected by the verbose mode (ex: protocol replies)
+
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG // set to LOG_LEVEL_INFO to remove the debug messages (command echo...)
+
+#define SIZE_LOG_BUFFER 4096 // in characters (power of 2)
+
+// Maximum time spent sending characters to each sink in each call to update():
+#define LOG_SERIAL_TIME_BUDGET 100 // in us
+#define LOG_LCD_TIME_BUDGET 200    // in us
+#define LOG_TFT_TIME_BUDGET 300    // in us
+
+namespace Logger
+{
+
+enum LogSink
+{
+  LOG_SINK_SERIAL = 0,
+  LOG_SINK_LCD,
+  LOG_SINK_TFT,
+  NUM_LOG_SINKS
+};
+
+extern void write(uint8_t _level, const char *_string);
+extern void update(); // sends the pending characters to the sinks (call it from loop())
+extern void flush();  // blocking: sends everything now (ex: before a reset)
+extern uint32_t getDroppedChars();
+
+} // namespace Logger
+
+#endif
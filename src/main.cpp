@@ -43,6 +43,7 @@
 #include "Utils.h" // wrappers for low level methods and other things
 #include "messageParser.h"
 #include "dataCom.h"
+#include "fastMath.h"
 
 //  ================== SETUP ==================
 void setup()
@@ -51,15 +52,22 @@ void setup()
   // 1] INIT SERIAL COMMUNICATION
   Com::ReceiverSerial::init();
 
-  // 2] INIT SCANNER HARDWARE
+  // 2] SORT THE COMMAND DICTIONNARY (binary search of the commands)
+  Parser::init();
+
+  // 3] INIT SCANNER HARDWARE
   Hardware::init();
 
-  // 3] INIT DISPLAY ENGINE (default is not stand by, but running)
+  // 4] INIT FAST TRIGONOMETRY TABLES (used by the figure primitives and test patterns)
+  FastMath::init();
+
+  // 5] INIT DISPLAY ENGINE (default is not stand by, but running)
   DisplayScan::init();
 
   PRINTLN("==== SYSTEM READY =========");
 
-  // 4] Blink led to show everything went fine(needs to be called after setting pin modes)
+  // 6] Blink led to show everything went fine(needs to be called after setting pin modes)
+  // NOTE: it returns immediately, the led blinks in the background once loop() starts
   Hardware::blinkLedMessage(4, 250000); // period in us
 
   // Check FREE RAM in DEBUG mode:
@@ -85,8 +93,11 @@ void loop()
   // clock changes state, instead of updating the pipeline all the time! TODO (to think...)
   //Hardware::Clocks::arrayClock[0].update();
 
-  // Update sequencer (if it is inactive, the call will return immediately)
-  Hardware::Sequencer::update();
+  // NOTE: the sequencer is updated in its own timer interrupt (check Hardware::Sequencer::setState)
+
+  Hardware::update(); // led and test patterns running in the background
+
+  Logger::update(); // send the pending messages (serial port, displays)
 
   //TEST:
   // float t= 1.0*millis()/1000;
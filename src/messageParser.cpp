@@ -1,4 +1,6 @@
 #include "messageParser.h"
+#include "dataCom.h"
+#include "commandLookup.h"
 
 namespace Parser
 {
@@ -18,7 +20,7 @@ enum stateParser
 
 // =============================================================================
 //  ======== USEFUL CONVERSION METHODS =========================================
-int8_t toBool(const String _str)
+int8_t toBool(const Token &_str)
 {
   int8_t val = -1;
   if (Utils::isNumber(_str))
@@ -31,7 +33,7 @@ int8_t toBool(const String _str)
   return (val);
 }
 
-int8_t toClassID(const String _str)
+int8_t toClassID(const Token &_str)
 {
   int8_t val(0); // return -1 if class not found
 
@@ -53,7 +55,7 @@ int8_t toClassID(const String _str)
   return (val);
 }
 
-int8_t toLaserID(const String _str)
+int8_t toLaserID(const Token &_str)
 {
   int8_t val = -1;
 
@@ -74,7 +76,7 @@ int8_t toLaserID(const String _str)
   return (val);
 }
 
-int8_t toTrgMode(String _str)
+int8_t toTrgMode(const Token &_str)
 {
   int8_t val = -1;
 
@@ -94,12 +96,55 @@ int8_t toTrgMode(String _str)
   return (val);
 }
 
+int8_t toGateFunction(const Token &_str)
+{
+  int8_t val = -1;
+
+  if (Utils::isNumber(_str))
+    val = _str.toInt();
+  else if (Utils::isSmallCaps(_str))
+  {
+    for (int8_t k = 0; k < NUM_GATE_FUNCTIONS; k++)
+    {
+      if (_str == Definitions::gateFunctionNames[k])
+      {
+        val = k;
+        break;
+      }
+    }
+  }
+  return (val);
+}
+
+int8_t toWaveShape(const Token &_str)
+{
+  int8_t val = -1;
+
+  if (Utils::isNumber(_str))
+    val = _str.toInt();
+  else if (Utils::isSmallCaps(_str))
+  {
+    for (int8_t k = 0; k < NUM_WAVE_SHAPES; k++)
+    {
+      if (_str == Definitions::waveShapeNames[k])
+      {
+        val = k;
+        break;
+      }
+    }
+  }
+  return (val);
+}
+
 // =============================================================================
 // ======== PARSE THE MESSAGE ==================================================
 
+static void invalidateMemoryScript();
+
 void beginRecordingScript()
 {
   scriptStringInMemory = "";
+  invalidateMemoryScript();
   recordingScript = true;
 }
 void endRecordingScript()
@@ -112,86 +157,603 @@ void addRecordingScript()
   recordingScript = true;
 }
 
-// The following function will read the file and produce the messageString to
-// send to the parser, exactly as if it where typed on the serial port.
-String readScript(String _nameFile)
+// =============================================================================
+// ======== SCRIPT COMPILATION =================================================
+// Scripts are compiled once into a list of instructions (index in the command table and
+// arguments already split into tokens), so their execution does not go through the text
+// parser nor the command search. Compiled scripts are kept in a small cache: the slot 0 is the
+// script in memory, the others the last scripts executed from the SD card.
+// NOTE: a script that does not fit in a slot is compiled by windows: the slot holds the instructions
+// compiled from the line at windowStart in the source, and the next window is compiled when the execution
+// gets there (or the previous ones, when a loop goes back). The whole script is still checked before
+// running it.
+struct Instruction
+{
+  uint16_t command;  // index in the (sorted) command table
+  uint8_t numArgs;
+  uint16_t firstArg; // index of the first argument in the argument pool of the bytecode
+};
+
+struct Bytecode
 {
-  #ifdef USING_SD_CARD
-  _nameFile += ".txt";
-  PRINTLN("-- READING : " + _nameFile);
+  bool valid;
+  char name[SIZE_SCRIPT_NAME]; // file name (without .txt) - unused for the script in memory
+  uint32_t lastUse;            // to replace the least recently used script in the cache
 
-  File myFile;
-  myFile = SD.open(_nameFile.c_str());
+  bool windowed;                    // the script does not fit in the slot
+  bool lastWindow;                  // the window goes up to the end of the source
+  uint32_t windowStart, windowEnd;  // offsets of the window in the source (text of the script)
+
+  uint16_t numInstructions, numArgs, textHead;
+  Instruction code[MAX_SCRIPT_INSTRUCTIONS];
+  Token args[MAX_SCRIPT_ARGS];    // the tokens point to the text of the arguments below
+  char text[SIZE_SCRIPT_TEXT];
+};
+Bytecode scriptCache[SIZE_SCRIPT_CACHE];
+uint32_t scriptUseCounter = 0;
+
+static bool isMemoryScript(const Bytecode &_bytecode) { return (&_bytecode == &scriptCache[0]); }
+
+static bool parseMessage(const char *_messageString, Bytecode *_bytecode);
+static bool executeCommand(uint16_t _index, uint8_t _numArgs, Token argStack[]);
+
+// Called by the parser for each command of a script being compiled:
+static bool addInstruction(Bytecode &_bytecode, const char *_cmdString, uint8_t _numArgs, Token argStack[])
+{
+  int16_t index = findCommand(_cmdString);
+  if (index < 0)
+  {
+    PRINTLN("> BAD COMMAND: " + String(_cmdString));
+    lastError = ERR_BAD_COMMAND;
+    return (false);
+  }
+  if ((_numArgs < commandTable[index].minArgs) || (_numArgs > commandTable[index].maxArgs))
+  {
+    PRINTLN("> BAD PARAMETERS: " + String(_cmdString));
+    lastError = ERR_BAD_PARAMETERS;
+    return (false);
+  }
 
-  String msgString = "";
-  if (myFile)
+  uint16_t textLength = 0;
+  for (uint8_t k = 0; k < _numArgs; k++)
+    textLength += argStack[k].length() + 1;
+  if ((_bytecode.numInstructions == MAX_SCRIPT_INSTRUCTIONS) || (_bytecode.numArgs + _numArgs > MAX_SCRIPT_ARGS) || (_bytecode.textHead + textLength > SIZE_SCRIPT_TEXT))
   {
-    // Read ALL the characters in the file and put them into a msgString:
-    while (myFile.available())
-      msgString += (char)myFile.read();
+    PRINTLN("> SCRIPT TOO LONG");
+    lastError = ERR_TOO_LONG;
+    return (false);
+  }
 
-    // close the file ( only one file can be open at a time,
-    // so you have to close this one before opening another.)
-    myFile.close();
+  Instruction &instruction = _bytecode.code[_bytecode.numInstructions++];
+  instruction.command = index;
+  instruction.numArgs = _numArgs;
+  instruction.firstArg = _bytecode.numArgs;
+  for (uint8_t k = 0; k < _numArgs; k++)
+  {
+    char *ptrText = _bytecode.text + _bytecode.textHead;
+    memcpy(ptrText, argStack[k].c_str(), argStack[k].length());
+    ptrText[argStack[k].length()] = '\0';
+    _bytecode.args[_bytecode.numArgs++].set(ptrText, argStack[k].length());
+    _bytecode.textHead += argStack[k].length() + 1;
   }
-  else
+  return (true);
+}
+
+static bool cmdLoop(uint8_t _numArgs, Token argStack[]);
+static bool cmdEndLoop(uint8_t _numArgs, Token argStack[]);
+
+// Loop nesting of the instructions of a window, added to the one of the previous windows (_depth < 0 when an
+// END_LOOP has no LOOP):
+static void countLoops(const Bytecode &_bytecode, int16_t &_depth, int16_t &_maxDepth)
+{
+  for (uint16_t k = 0; (k < _bytecode.numInstructions) && (_depth >= 0); k++)
   {
-    // if the file didn't open correctly, return a special message:
-    msgString = "error";
+    CommandHandler handler = commandTable[_bytecode.code[k].command].handler;
+    if ((handler == cmdLoop) && (++_depth > _maxDepth))
+      _maxDepth = _depth;
+    else if (handler == cmdEndLoop)
+      _depth--;
   }
-  return (msgString);
-  #else
-  PRINTLN("-- NO SD CARD INITIALIZED");
-  return ("error");
-  #endif
 }
 
-bool saveScript(String _nameFile)
+// Every LOOP must be closed by an END_LOOP in the same script, and the loops must not be nested deeper than
+// the loop stack (otherwise the body of a LOOP that failed at run time would still run, and its END_LOOP would
+// close the enclosing loop):
+static bool checkLoops(int16_t _depth, int16_t _maxDepth)
 {
-  #ifdef USING_SD_CARD
-  _nameFile += ".txt";
+  if (_depth)
+  {
+    PRINTLN("> UNBALANCED LOOP");
+    lastError = ERR_BAD_PACKET;
+  }
+  else if (_maxDepth > SIZE_LOOP_STACK)
+  {
+    PRINTLN("> TOO MANY NESTED LOOPS");
+    lastError = ERR_BAD_PACKET;
+  }
+  return ((_depth == 0) && (_maxDepth <= SIZE_LOOP_STACK));
+}
 
-  bool execOk = false;
-  File myFile;
-  myFile = SD.open(_nameFile.c_str(), FILE_WRITE);
+// A line (one command) surely fits if there is room for all its characters, and for as many arguments:
+static bool hasRoomForLine(const Bytecode &_bytecode, uint16_t _length)
+{
+  return ((_bytecode.numInstructions < MAX_SCRIPT_INSTRUCTIONS) &&
+          (_bytecode.numArgs + min(_length, (uint16_t)SIZE_CMD_STACK) <= MAX_SCRIPT_ARGS) &&
+          (_bytecode.textHead + _length + 1 <= SIZE_SCRIPT_TEXT));
+}
 
-  // if the file opened okay, write verbatim what we have in
-  if (myFile)
+// =============================================================================
+// ======== SCRIPT FILES =======================================================
+// Splits the text given block by block by _readBlock(block) (number of characters read) into command lines
+// (with their END_CMD), and calls _onLine(line, offset of the line in the text) for each one, until it
+// returns false:
+template <class BlockReader, class LineHandler>
+static bool splitScriptLines(uint32_t _offset, BlockReader _readBlock, LineHandler _onLine)
+{
+  char block[SD_BLOCK_SIZE];
+  char line[SIZE_ATOMIC_COMMAND + 2]; // (room for an END_CMD added to the last line)
+  uint16_t length = 0;
+  uint32_t lineOffset = _offset;
+  bool readOk = true;
+  int numRead;
+  while (readOk && ((numRead = _readBlock(block)) > 0))
   {
-    for (uint32_t k = 0; k < scriptStringInMemory.length(); k++)
+    for (int k = 0; readOk && (k < numRead); k++)
     {
-      myFile.print((char)scriptStringInMemory[k]);
+      if (length == SIZE_ATOMIC_COMMAND)
+      {
+        PRINTLN("> COMMAND TOO LONG");
+        readOk = false;
+        break;
+      }
+      line[length++] = block[k];
+      if (block[k] == END_CMD)
+      {
+        line[length] = '\0';
+        readOk = _onLine(line, lineOffset);
+        lineOffset += length;
+        length = 0;
+      }
     }
-    //myFile.print(END_CMD);
-    myFile.close();
-    execOk = true;
   }
-  else
+
+  // The last line may lack its END_CMD (file edited on a computer):
+  if (readOk && length)
   {
-    // if the file didn't open, print an error:
-    PRINTLN("> ERROR writing file!");
+    line[length++] = END_CMD;
+    line[length] = '\0';
+    readOk = _onLine(line, lineOffset);
   }
-  return (execOk);
-  #else
+  return (readOk);
+}
+
+// The same for the script in memory:
+template <class LineHandler>
+static bool readMemoryLines(uint32_t _offset, LineHandler _onLine)
+{
+  uint32_t position = _offset;
+  auto readBlock = [&](char *_block) {
+    uint32_t numRead = min(scriptStringInMemory.length() - min(position, scriptStringInMemory.length()),
+                           (uint32_t)SD_BLOCK_SIZE);
+    memcpy(_block, scriptStringInMemory.c_str() + position, numRead);
+    position += numRead;
+    return ((int)numRead);
+  };
+  return (splitScriptLines(_offset, readBlock, _onLine));
+}
+
+// The files are read and written by blocks of SD_BLOCK_SIZE bytes (the sector size of the card),
+// instead of character by character.
+#ifdef USING_SD_CARD
+static bool openScriptFile(const char *_nameFile, File &_file, uint8_t _mode)
+{
+  String nameFile = String(_nameFile) + ".txt";
+  _file = SD.open(nameFile.c_str(), _mode);
+  if (!_file)
+  {
+    PRINTLN("> CANNOT OPEN " + nameFile);
+    return (false);
+  }
+  return (true);
+}
+
+// Reads the file block by block from _offset, and calls _onLine(line, offset of the line) for each command
+// line, so the script can be compiled as it is read, without holding the whole text in memory:
+template <class LineHandler>
+static bool readScriptLines(const char *_nameFile, uint32_t _offset, LineHandler _onLine)
+{
+  File myFile;
+  if (!openScriptFile(_nameFile, myFile, FILE_READ))
+    return (false);
+  bool readOk = myFile.seek(_offset) &&
+                splitScriptLines(_offset, [&](char *_block) { return (myFile.read(_block, SD_BLOCK_SIZE)); }, _onLine);
+
+  // close the file ( only one file can be open at a time,
+  // so you have to close this one before opening another.)
+  myFile.close();
+  return (readOk);
+}
+
+static bool loadScriptFile(const char *_nameFile, String &_scriptString)
+{
+  File myFile;
+  if (!openScriptFile(_nameFile, myFile, FILE_READ))
+    return (false);
+
+  _scriptString = "";
+  _scriptString.reserve(myFile.size()); // avoid reallocating the String for each block
+  char block[SD_BLOCK_SIZE + 1];
+  int numRead;
+  while ((numRead = myFile.read(block, SD_BLOCK_SIZE)) > 0)
+  {
+    block[numRead] = '\0';
+    _scriptString += block;
+  }
+  myFile.close();
+  return (true);
+}
+
+static bool saveScript(const char *_nameFile)
+{
+  File myFile;
+  if (!openScriptFile(_nameFile, myFile, FILE_WRITE))
+    return (false);
+
+  // write verbatim what we have in memory:
+  const uint8_t *ptrText = (const uint8_t *)scriptStringInMemory.c_str();
+  uint32_t length = scriptStringInMemory.length();
+  for (uint32_t k = 0; k < length; k += SD_BLOCK_SIZE)
+    myFile.write(ptrText + k, min(length - k, (uint32_t)SD_BLOCK_SIZE));
+  myFile.close();
+  return (true);
+}
+#else
+template <class LineHandler>
+static bool readScriptLines(const char *_nameFile, uint32_t _offset, LineHandler _onLine)
+{
+  PRINTLN("-- NO SD CARD INITIALIZED");
+  return (false);
+}
+
+static bool loadScriptFile(const char *_nameFile, String &_scriptString)
+{
+  PRINTLN("-- NO SD CARD INITIALIZED");
+  return (false);
+}
+
+static bool saveScript(const char *_nameFile)
+{
   PRINTLN("-- NO SD CARD INITIALIZED");
-  return ("error");
-  #endif
+  return (false);
+}
+#endif
+
+// Compiles the lines of the source of the script from _offset, up to the end or to the first line that may
+// not fit (the window then ends there):
+static bool compileWindow(Bytecode &_bytecode, uint32_t _offset)
+{
+  _bytecode.numInstructions = 0;
+  _bytecode.numArgs = 0;
+  _bytecode.textHead = 0;
+  _bytecode.windowStart = _offset;
+  _bytecode.lastWindow = true;
+
+  auto onLine = [&](const char *_line, uint32_t _lineOffset) {
+    if (!hasRoomForLine(_bytecode, strlen(_line)))
+    {
+      _bytecode.lastWindow = false;
+      _bytecode.windowEnd = _lineOffset;
+      return (false);
+    }
+    return (parseMessage(_line, &_bytecode));
+  };
+  bool parsed = (isMemoryScript(_bytecode) ? readMemoryLines(_offset, onLine) : readScriptLines(_bytecode.name, _offset, onLine));
+  return (parsed || !_bytecode.lastWindow);
+}
+
+// The whole script is compiled (window after window if it does not fit), then the slot keeps its first window.
+// NOTE: a script with errors is not executed at all (the error is reported at compilation)
+static bool compileScript(Bytecode &_bytecode)
+{
+  _bytecode.valid = false;
+  _bytecode.windowed = false;
+  int16_t depth = 0, maxDepth = 0;
+  bool parsed = compileWindow(_bytecode, 0);
+  if (parsed)
+    countLoops(_bytecode, depth, maxDepth);
+  while (parsed && !_bytecode.lastWindow && (depth >= 0))
+  {
+    _bytecode.windowed = true;
+    parsed = compileWindow(_bytecode, _bytecode.windowEnd);
+    if (parsed)
+      countLoops(_bytecode, depth, maxDepth);
+  }
+  _bytecode.valid = parsed && checkLoops(depth, maxDepth) && (!_bytecode.windowed || compileWindow(_bytecode, 0));
+  if (!_bytecode.valid)
+    PRINTLN("> SCRIPT NOT COMPILED");
+  return (_bytecode.valid);
+}
+
+// Window of a script already checked, when the execution gets out of the current one:
+static bool loadWindow(Bytecode &_bytecode, uint32_t _offset)
+{
+  if (_bytecode.valid && (_bytecode.windowStart == _offset))
+    return (true);
+  if (!_bytecode.valid || !compileWindow(_bytecode, _offset))
+  {
+    PRINTLN("> SCRIPT CHANGED WHILE RUNNING");
+    _bytecode.valid = false;
+    _bytecode.numInstructions = 0;
+    _bytecode.lastWindow = true;
+    return (false);
+  }
+  return (true);
+}
+
+// =============================================================================
+// ======== SCRIPT EXECUTION ===================================================
+struct LoopFrame
+{
+  uint32_t startWindow; // window of the first instruction of the loop body (scripts that do not fit)
+  uint16_t startPc;     // first instruction of the loop body
+  uint32_t remaining;   // number of iterations left, including the current one
+};
+
+struct ScriptFrame
+{
+  Bytecode *bytecode;
+  uint16_t pc; // next instruction
+  bool faultless;
+
+  uint32_t waitTime; // in us (0 if not waiting)
+  elapsedMicros waitTimer;
+
+  LoopFrame loopStack[SIZE_LOOP_STACK];
+  uint8_t loopDepth;
+
+  // Parameters ($1 to $9) passed by CALL_PRM:
+  uint8_t numParams;
+  Token params[MAX_SCRIPT_PARAMS];
+  char paramText[SIZE_PARAM_TEXT];
+};
+ScriptFrame scriptStack[SIZE_SCRIPT_STACK];
+uint8_t scriptDepth = 0;
+ScriptFrame *currentFrame = NULL; // frame of the instruction being executed (NULL for commands out of scripts)
+
+// Variables $a to $z, global (shared by all the scripts and the commands sent directly). Their
+// value is kept as text, since the commands receive their arguments as text:
+char variables[NUM_SCRIPT_VARIABLES][SIZE_SCRIPT_VARIABLE];
+
+// A compiled script cannot be replaced while it is being executed:
+static bool isBytecodeRunning(const Bytecode *_bytecode)
+{
+  for (uint8_t k = 0; k < scriptDepth; k++)
+    if (scriptStack[k].bytecode == _bytecode)
+      return (true);
+  return (false);
+}
+
+// The script in memory is compiled when executed for the first time after being modified:
+static void invalidateMemoryScript() { scriptCache[0].valid = false; }
+
+static Bytecode *getMemoryScript()
+{
+  Bytecode *ptrBytecode = &scriptCache[0];
+  if (!ptrBytecode->valid)
+  {
+    if (isBytecodeRunning(ptrBytecode))
+    {
+      PRINTLN("> SCRIPT MODIFIED WHILE RUNNING");
+      return (NULL);
+    }
+    if (!compileScript(*ptrBytecode))
+      return (NULL);
+  }
+  return (ptrBytecode);
+}
+
+static Bytecode *getFileScript(const char *_nameFile)
+{
+  if (strlen(_nameFile) >= SIZE_SCRIPT_NAME)
+  {
+    PRINTLN("> SCRIPT NAME TOO LONG");
+    return (NULL);
+  }
+
+  // Already compiled?
+  for (uint8_t k = 1; k < SIZE_SCRIPT_CACHE; k++)
+    if (scriptCache[k].valid && !strcmp(scriptCache[k].name, _nameFile))
+      return (&scriptCache[k]);
+
+  // Otherwise, replace a free or the least recently used slot (not running):
+  Bytecode *ptrBytecode = NULL;
+  for (uint8_t k = 1; k < SIZE_SCRIPT_CACHE; k++)
+  {
+    if (isBytecodeRunning(&scriptCache[k]))
+      continue;
+    if (!scriptCache[k].valid)
+    {
+      ptrBytecode = &scriptCache[k];
+      break;
+    }
+    if ((ptrBytecode == NULL) || (scriptCache[k].lastUse < ptrBytecode->lastUse))
+      ptrBytecode = &scriptCache[k];
+  }
+  if (ptrBytecode == NULL)
+  {
+    PRINTLN("> TOO MANY SCRIPTS RUNNING");
+    return (NULL);
+  }
+
+  strcpy(ptrBytecode->name, _nameFile); // (the windows are compiled from the file)
+  if (!compileScript(*ptrBytecode))
+    return (NULL);
+  return (ptrBytecode);
+}
+
+// Saving a file makes its compiled version (if any) obsolete:
+static void invalidateFileScript(const char *_nameFile)
+{
+  for (uint8_t k = 1; k < SIZE_SCRIPT_CACHE; k++)
+    if (!strcmp(scriptCache[k].name, _nameFile) && !isBytecodeRunning(&scriptCache[k]))
+      scriptCache[k].valid = false;
+}
+
+static ScriptFrame *pushScript(const char *_nameFile)
+{
+  if (scriptDepth == SIZE_SCRIPT_STACK)
+  {
+    PRINTLN("> TOO MANY NESTED SCRIPTS");
+    return (NULL);
+  }
+
+  Bytecode *ptrBytecode = (_nameFile == NULL ? getMemoryScript() : getFileScript(_nameFile));
+  if (ptrBytecode == NULL)
+    return (NULL);
+  if (ptrBytecode->windowed)
+  { // the slot follows the execution, so it cannot be shared:
+    if (isBytecodeRunning(ptrBytecode))
+    {
+      PRINTLN("> SCRIPT ALREADY RUNNING");
+      return (NULL);
+    }
+    if (!loadWindow(*ptrBytecode, 0))
+      return (NULL);
+  }
+  ptrBytecode->lastUse = ++scriptUseCounter;
+
+  ScriptFrame &frame = scriptStack[scriptDepth++];
+  frame.bytecode = ptrBytecode;
+  frame.pc = 0;
+  frame.faultless = true;
+  frame.waitTime = 0;
+  frame.loopDepth = 0;
+  frame.numParams = 0;
+  return (&frame);
+}
+
+bool startScript(const char *_nameFile)
+{
+  return (pushScript(_nameFile) != NULL);
+}
+
+bool isScriptRunning() { return (scriptDepth > 0); }
+
+void stopScript()
+{
+  scriptDepth = 0;
+}
+
+// Next instruction of the script (NULL at the end), compiling the next window of a script that does not fit:
+static const Instruction *nextInstruction(ScriptFrame &_frame)
+{
+  Bytecode &bytecode = *_frame.bytecode;
+  while ((_frame.pc >= bytecode.numInstructions) && !bytecode.lastWindow)
+  {
+    if (!loadWindow(bytecode, bytecode.windowEnd))
+      _frame.faultless = false;
+    _frame.pc = 0;
+  }
+  if (_frame.pc >= bytecode.numInstructions)
+    return (NULL);
+  return (&bytecode.code[_frame.pc++]);
+}
+
+bool stepScript()
+{
+  if (!scriptDepth)
+    return (false);
+
+  ScriptFrame &frame = scriptStack[scriptDepth - 1];
+  if (frame.waitTime)
+  {
+    if (frame.waitTimer < frame.waitTime)
+      return (false); // nothing to do yet
+    frame.waitTime = 0;
+  }
+
+  // Move the program counter BEFORE executing the instruction, since the command itself may start
+  // another script or jump (the frame stays valid: the stack is a fixed array):
+  const Instruction *ptrInstruction = nextInstruction(frame);
+  if (ptrInstruction == NULL)
+  {
+    // NOTE: A command error will produce an execution error INSIDE the script, but
+    // it does not mean the EXECUTE_SCRIPT command was a failure. We signal it with a proper message.
+    if (frame.faultless)
+      PRINTLN("----------- END FAULTLESS EXECUTION");
+    else
+      PRINTLN("------------------- END WITH ERRORS");
+    scriptDepth--;
+    return (true);
+  }
+
+  const Instruction &instruction = *ptrInstruction;
+  currentFrame = &frame;
+  bool executed = executeCommand(instruction.command, instruction.numArgs, frame.bytecode->args + instruction.firstArg);
+  currentFrame = NULL;
+  if (!executed)
+  {
+    PRINTLN("> FAILED EXECUTION: " + String(commandTable[instruction.command].name));
+    frame.faultless = false;
+  }
+  return (true);
+}
 
+// Arguments starting with '$' are replaced by the value of a variable ($a to $z) or by a
+// parameter of the running script ($1 to $9):
+static bool resolveArgument(const Token &_arg, Token &_resolved)
+{
+  char name = _arg[1];
+  if ((_arg.length() == 2) && (name >= 'a') && (name <= 'z'))
+  {
+    const char *value = variables[name - 'a'];
+    _resolved.set(value, strlen(value));
+    return (true);
+  }
+  if ((_arg.length() == 2) && (name >= '1') && (name <= '9'))
+  {
+    if ((currentFrame == NULL) || (name - '1' >= currentFrame->numParams))
+    {
+      PRINTLN("> MISSING PARAMETER " + String(_arg.c_str()));
+      return (false);
+    }
+    _resolved = currentFrame->params[name - '1'];
+    return (true);
+  }
+  PRINTLN("> BAD VARIABLE " + String(_arg.c_str()));
+  return (false);
 }
 
 // ***************************************************************************************************************
 // RPN PARSER ****************************************************************************************************
-String oldAtomicCommandString = ""; // oldAtomicCommandString is for repeating last GOOD string-command
+ParserError lastError = ERR_NONE;
+char oldAtomicCommandString[SIZE_ATOMIC_COMMAND] = ""; // oldAtomicCommandString is for repeating last GOOD string-command
+
 bool parseStringMessage(const String &_messageString)
+{
+  return (parseStringMessage(_messageString.c_str()));
+}
+
+bool parseStringMessage(const char *_messageString)
+{
+  return (parseMessage(_messageString, NULL));
+}
+
+// NOTE: when _bytecode is not NULL, the commands are not executed but added to the bytecode (compilation of a script)
+static bool parseMessage(const char *_messageString, Bytecode *_bytecode)
 {
   // NOTE: can contain more than one command; however, after every command there must be an END_COMMAND
-  String messageString;
 
-  String cmdString; // one command executed at a time.
+  // The characters of the command being parsed are copied in a fixed buffer, each argument (and the
+  // command name) being a null terminated string; the tokens only point to them (no heap allocation):
+  char tokenBuffer[SIZE_TOKEN_BUFFER];
+  uint16_t bufferHead;
+
+  Token cmdString; // one command executed at a time.
   uint8_t numArgs;
-  String argStack[SIZE_CMD_STACK]; // number stack storing numeric parameters for commands (for RPN-like parser).
-                                   // Note that the data is saved as a String - it will be converted to int, float or
-                                   // whatever by the specific method associated with the correspondent command.
+  Token argStack[SIZE_CMD_STACK]; // number stack storing numeric parameters for commands (for RPN-like parser).
+                                  // Note that the data is saved as a string - it will be converted to int, float or
+                                  // whatever by the specific method associated with the correspondent command.
 
   bool cmdExecuted;
 
@@ -202,15 +764,30 @@ bool parseStringMessage(const String &_messageString)
    NOTE: Usually you put [=] or [&] as captures. [=] means that you capture all variables in the scope in which the value is defined by value, which means that they will keep the value that they had when the lambda was declared. [&] means that you capture all variables in the scope by reference, which means that they will always have their current value, but if they are erased from memory the program will crash. */
   auto resetParser = [&]() {
     numArgs = 0;
-    for (uint8_t i = 0; i < SIZE_CMD_STACK; i++)
-      argStack[i] = "";
-    cmdString = "";
+    bufferHead = 0;
+    cmdString.set("", 0);
     myState = START;
   };
 
+  // Start a new token in the buffer, and add characters to it (false if the buffer is full):
+  auto startToken = [&](Token &_token) {
+    if (bufferHead + 1 > SIZE_TOKEN_BUFFER)
+      return (false);
+    _token.set(tokenBuffer + bufferHead, 0);
+    tokenBuffer[bufferHead] = '\0';
+    return (true);
+  };
+  auto addToToken = [&](Token &_token, char _val) {
+    if (bufferHead + 2 > SIZE_TOKEN_BUFFER)
+      return (false);
+    tokenBuffer[bufferHead++] = _val;
+    tokenBuffer[bufferHead] = '\0';
+    _token.grow();
+    return (true);
+  };
+
   // ================= START PARSING ========================
   //PRINTLN("START PARSING MESSAGE");
-  messageString = _messageString;
 
   resetParser(); // reset parsing the first time (attn: there can be many commands INSIDE the messageString,
                  // so the collected arguments and command should be reset after each individual command interpretation and
@@ -218,11 +795,19 @@ bool parseStringMessage(const String &_messageString)
 
   bool scriptExecuted = true; // initialized to true before string parsing : it will be "ANDed" with each cmdExecuted.
                               // NOTE: cmdExecuted does not need to be set here, it will be set when a single command is executed (correctly or not)
+  lastError = ERR_NONE;
+
+  // Parsing errors abort the parsing of the rest of the message:
+  auto parseError = [&](ParserError _error, const char *_errorString) {
+    PRINTLN(_errorString);
+    lastError = _error;
+    scriptExecuted = false;
+  };
 
   // Note: messageString contains the END_CMD (char), otherwise we wouldn't be here;
-  // So, going through the for-loop with the condition i < messageString.length()
-  // is basically the same as using the condition: _messageString[i] != END_CMD
-  for (uint8_t i = 0; i < messageString.length(); i++)
+  // So, going through the for-loop until the end of the string is basically the same
+  // as using the condition: _messageString[i] != END_CMD
+  for (uint32_t i = 0; _messageString[i] != '\0'; i++)
   {
     char val = _messageString[i];
 
@@ -239,19 +824,35 @@ bool parseStringMessage(const String &_messageString)
     // ************ GATHER ARGUMENTS:
     // Put ASCII characters for a number (base 10) plus '-' and '.' to form floats and negative numbers ('/' must be
     // excluded) in the current argument in the stack, as well as non-capital letters (can be parameters too)
-    if ((((val >= '-') && (val <= '9')) || ((val >= 'a') && (val <= 'z'))) && (val != '/'))
+    if ((((val >= '-') && (val <= '9')) || ((val >= 'a') && (val <= 'z')) || (val == VARIABLE_PREFIX)) && (val != '/'))
     {
       if ((myState == START) || (myState == SEPARATOR))
+      {
+        if (numArgs == SIZE_CMD_STACK)
+        {
+          parseError(ERR_TOO_LONG, "> TOO MANY ARGUMENTS");
+          break;
+        }
         myState = NUMBER;
+        if (!startToken(argStack[numArgs]))
+        {
+          parseError(ERR_TOO_LONG, "> COMMAND TOO LONG");
+          break;
+        }
+      }
 
       if (myState == NUMBER)
       { // it could be in CMD state...
-        argStack[numArgs] += val;
+        if (!addToToken(argStack[numArgs], val))
+        {
+          parseError(ERR_TOO_LONG, "> COMMAND TOO LONG");
+          break;
+        }
         //  PRINTLN(" (data)");
       }
       else // actually this just means myState == CMD
       {
-        PRINTLN("> BAD FORMED PACKET");
+        parseError(ERR_BAD_PACKET, "> BAD FORMED PACKET");
         break;
       }
     }
@@ -262,16 +863,27 @@ bool parseStringMessage(const String &_messageString)
     else if (((val >= 'A') && (val <= 'Z')) || (val == '_'))
     {
       if ((myState == START) || (myState == SEPARATOR))
+      {
         myState = CMD;
+        if (!startToken(cmdString))
+        {
+          parseError(ERR_TOO_LONG, "> COMMAND TOO LONG");
+          break;
+        }
+      }
 
       if (myState == CMD)
       { // Could be in NUMBER state
-        cmdString += val;
+        if (!addToToken(cmdString, val))
+        {
+          parseError(ERR_TOO_LONG, "> COMMAND TOO LONG");
+          break;
+        }
         //   PRINTLN(" (command)");
       }
       else
       {
-        PRINTLN("> BAD FORMED PACKET");
+        parseError(ERR_BAD_PACKET, "> BAD FORMED PACKET");
         break; // abort parsing - we could also restart it from here with resetParser()
       }
     }
@@ -284,14 +896,15 @@ bool parseStringMessage(const String &_messageString)
       if (myState == NUMBER)
       { // no need to test: }&&(argStack[numArgs].length() > 0)) {
         //PRINTLN(" (separator)");
-        //PRINT("> ARG n."); PRINT(numArgs); PRINT(" : "); PRINTLN(argStack[numArgs]);
+        //PRINT("> ARG n."); PRINT(numArgs); PRINT(" : "); PRINTLN(argStack[numArgs].c_str());
+        bufferHead++; // keep the null character ending the argument
         numArgs++;
         myState = SEPARATOR;
       }
       else
       { // number separator without previous data, another number separator or command:
         // through "bad formed" or ignore?
-        PRINTLN("> BAD FORMED PACKET");
+        parseError(ERR_BAD_PACKET, "> BAD FORMED PACKET");
         //PRINT_LCD("> BAD FORMED ARG LIST");
         break;
       }
@@ -309,10 +922,11 @@ bool parseStringMessage(const String &_messageString)
         {
           //NOTE: I will not do repeat, unless explicitly asked with a command. This way the line feed is
           // just ignored if there is no command string (better to write readable scripts)
-          PRINTLN(">");
+          if (_bytecode == NULL)
+            PRINTLN(">");
 
           /* IF REPEAT by LINE FEED:
-          if (oldAtomicCommandString != "")
+          if (oldAtomicCommandString[0] != '\0')
           {
             PRINTLN("> [REPEAT]");
             parseStringMessage(oldAtomicCommandString); // <<== ATTN: not ideal perhaps to use recurrent
@@ -329,7 +943,7 @@ bool parseStringMessage(const String &_messageString)
         }
         else
         { // "concatenator" without previous CMD
-          PRINTLN("> BAD FORMED PACKET");
+          parseError(ERR_BAD_PACKET, "> BAD FORMED PACKET");
 
           break; // abort parsing (we could also restart it from here with resetParser())
         }
@@ -339,49 +953,64 @@ bool parseStringMessage(const String &_messageString)
         // * Note 1 : state == CMD here implies cmdString.length() > 0
         // * Note 2 : we don't check argument number, can be anything including nothing.
 
+        if (_bytecode != NULL)
+        { // compiling a script: the command is stored instead of executed
+          if (!addInstruction(*_bytecode, cmdString.c_str(), numArgs, argStack))
+          {
+            scriptExecuted = false;
+            break;
+          }
+          resetParser();
+          continue;
+        }
+
         cmdExecuted = false;
         //PRINTLN(" ");
-        PRINT("> EXEC: ");
+        PRINT_DEBUG("> EXEC: ");
 
         // Retrieve the whole atomic command string (for checking and for saving into oldAtomicCommandString
-        // if appropiate - ie, different from certain special commands such as start/end recording scripts)
-        String atomicCommandString = "";
-        for (uint8_t k = 0; k < numArgs; k++)
-        {
-          atomicCommandString += argStack[k] + ",";
-        }
-        atomicCommandString += cmdString + END_CMD; // NOTE: INCLUDE the END_CMD character
+        // if appropiate - ie, different from certain special commands such as start/end recording scripts).
+        // NOTE: the tokens are contiguous in the buffer, separated by null characters, so it is only a matter
+        // of replacing these by the separators:
+        char atomicCommandString[SIZE_ATOMIC_COMMAND];
+        uint16_t lengthCommand = bufferHead;
+        for (uint16_t k = 0; k < lengthCommand; k++)
+          atomicCommandString[k] = (tokenBuffer[k] == '\0' ? ARG_SEPARATOR : tokenBuffer[k]);
+        atomicCommandString[lengthCommand] = END_CMD; // NOTE: INCLUDE the END_CMD character
+        atomicCommandString[lengthCommand + 1] = '\0';
 
         // Show it on the console:
-        PRINT(atomicCommandString);
+        PRINT_DEBUG(atomicCommandString);
 
         // *********************************************************
         // *********************************************************
-        cmdExecuted = interpretCommand(cmdString, numArgs, argStack);
+        cmdExecuted = interpretCommand(cmdString.c_str(), numArgs, argStack);
         // *********************************************************
         // *********************************************************
 
+        scriptExecuted = scriptExecuted && cmdExecuted; // this way we can know if there was an error in the middle of
+        // a script, without stopping it.
+
         if (cmdExecuted) // if THIS particular command was succesfully executed:
         {
-          scriptExecuted = scriptExecuted && cmdExecuted; // this way we can know if there was an error in the middle of
-          // a script, without stopping it.
           // NOTE: ignore and don't record START_REC_SCRIPT and END_REC_SCRIPT or ADD_REC_SCRIPT, nor
           // the REPEAT_COMMAND commands! (could be useful, but handling that becomes convoluted)
           if ((cmdString != REPEAT_COMMAND) && (cmdString != START_REC_SCRIPT) && (cmdString != END_REC_SCRIPT) && (cmdString != ADD_REC_SCRIPT))
           {
             // 1) Save properly parsed and executed command string in oldAtomicCommandString for repetition upon "ENTER":
-            oldAtomicCommandString = atomicCommandString;
+            strcpy(oldAtomicCommandString, atomicCommandString);
 
             // 2) Also, save it in the recording string if in recording mode:
             if (recordingScript)
             {
               scriptStringInMemory += atomicCommandString; // NOTE: each message has an END_CMD, which is a newlin (\n),
               // so each command in the saved file will be in a different row.
+              invalidateMemoryScript();
             }
           }
-          PRINTLN("> OK");
+          PRINTLN_DEBUG("> OK");
           //PRINT("> ");
-          Hardware::blinkLedMessage(1, 1000); // short period to avoid slowing down continuous execution of serial commands
+          Hardware::blinkLedMessage(1, 20000); // queued, does not slow down the execution of the commands
         }
         else
         {
@@ -396,7 +1025,7 @@ bool parseStringMessage(const String &_messageString)
       }
       else
       {
-        PRINTLN("> BAD FORMED PACKET");
+        parseError(ERR_BAD_PACKET, "> BAD FORMED PACKET");
         break;
       }
     }
@@ -409,7 +1038,7 @@ bool parseStringMessage(const String &_messageString)
     else
     { // this means we received something else (not a number, not a letter from A-Z,
       // not a number, packet terminator, not a concatenator)
-      PRINTLN("> BAD FORMED PACKET");
+      parseError(ERR_BAD_PACKET, "> BAD FORMED PACKET");
       //PRINT("> ");
 
       break; // break the for-loop of parsing
@@ -420,938 +1049,1179 @@ bool parseStringMessage(const String &_messageString)
 }
 
 // =============================================================================
-// ========== COMMAND INTERPRETER ==============================================
-// NOTE: Here you can add commands yourself; but I would wait until I can do a
-// proper COMMAND DICTIONNARY (or use a good command parser/serialiser library)
-// so as to simplify the way one can write new ones.
+// ========== COMMAND HANDLERS =================================================
+// NOTE: to add a command, write its handler here (it receives the arguments as
+// Strings, and returns true if the command was executed), and add it to the
+// command table below with the range of accepted number of arguments.
 // =============================================================================
-bool interpretCommand(String _cmdString, uint8_t _numArgs, String argStack[])
-{
-  bool execFlag = false;
-
-  //PRINTLN("START INTERPRETATION");
 
-  //==========================================================================
-  //====== MISC ================================================
+//==========================================================================
+//====== MISC ================================================
 
-  if (_cmdString == REPEAT_COMMAND)
-  { // Param: 0 to 4096 (12 bit res).
-    if (_numArgs == 0)
+static bool cmdRepeatCommand(uint8_t _numArgs, Token argStack[])
+{ // Param: 0 to 4096 (12 bit res).
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    //PRINTLN("> EXECUTING... ");
+    if (oldAtomicCommandString[0] != '\0')
     {
-      //PRINTLN("> EXECUTING... ");
-      if (oldAtomicCommandString != "")
-      {
-        PRINTLN("> REPEAT");
-        parseStringMessage(oldAtomicCommandString); // <<== ATTN: not ideal perhaps to use recurrent
-        // call here.. but when using in command line input, the END_CMD is the
-        // last character, so there is no risk of deep nested calls (on return the parser
-        // will end in the next loop iteration)
-      }
-      else
-      {
-        PRINTLN("> [NO PREVIOUS COMMAND TO REPEAT]");
-      }
-      execFlag = true;
+      PRINTLN("> REPEAT");
+      parseStringMessage(oldAtomicCommandString); // <<== ATTN: not ideal perhaps to use recurrent
+      // call here.. but when using in command line input, the END_CMD is the
+      // last character, so there is no risk of deep nested calls (on return the parser
+      // will end in the next loop iteration)
     }
     else
-      PRINTLN("> BAD PARAMETERS");
-  }
-
-  //==========================================================================
-  // A) ====== LASER COMMANDS ================================================
-  //==========================================================================
-  else if (_cmdString == SET_POWER_LASER_ALL)
-  { // Param: 0 to 4096 (12 bit res).
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
     {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Lasers::setStatePowerAll(argStack[0].toInt());
-      execFlag = true;
+      PRINTLN("> [NO PREVIOUS COMMAND TO REPEAT]");
     }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_POWER_LASER)
-  { // Param: laser number or name, power (0 to 4096, 12 bit res).
-    if ((_numArgs == 2) && Utils::isNumber(argStack[1]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Lasers::setStatePower(toLaserID(argStack[0]), argStack[1].toInt());
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+//==========================================================================
+// A) ====== LASER COMMANDS ================================================
+//==========================================================================
+static bool cmdSetPowerLaserAll(uint8_t _numArgs, Token argStack[])
+{ // Param: 0 to 4096 (12 bit res).
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Lasers::setStatePowerAll(argStack[0].toInt());
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_SWITCH_LASER_ALL)
-  { // Param: 0/1 or "on"/"off"
-    if (_numArgs == 1)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Lasers::setStateSwitchAll(toBool(argStack[0]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdSetPowerLaser(uint8_t _numArgs, Token argStack[])
+{ // Param: laser number or name, power (0 to 4096, 12 bit res).
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::isNumber(argStack[1]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Lasers::setStatePower(toLaserID(argStack[0]), argStack[1].toInt());
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_SWITCH_LASER)
-  { // Param: laser number or name, 0/1 or "on"/"off"
-
-    if (_numArgs == 2)
+static bool cmdSetSwitchLaserAll(uint8_t _numArgs, Token argStack[])
+{ // Param: 0/1 or "on"/"off"
+  bool execFlag = false;
+  if (_numArgs == 1)
+  {
     //PRINTLN("> EXECUTING... ");
-    {
-      Hardware::Lasers::setStateSwitch(toLaserID(argStack[0]), toBool(argStack[1]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    Hardware::Lasers::setStateSwitchAll(toBool(argStack[0]));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdSetSwitchLaser(uint8_t _numArgs, Token argStack[])
+{ // Param: laser number or name, 0/1 or "on"/"off"
+  bool execFlag = false;
 
-  else if (_cmdString == SET_CARRIER_ALL)
+  if (_numArgs == 2)
+  //PRINTLN("> EXECUTING... ");
   {
-    if (_numArgs == 1)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Lasers::setStateCarrierAll(toBool(argStack[0]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    Hardware::Lasers::setStateSwitch(toLaserID(argStack[0]), toBool(argStack[1]));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_CARRIER)
+static bool cmdSetCarrierAll(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 1)
   {
-    if (_numArgs == 2)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Lasers::setStateCarrier(toLaserID(argStack[0]), argStack[1]);
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Lasers::setStateCarrierAll(toBool(argStack[0]));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == GET_SHUTTER_LOCK)
+static bool cmdSetCarrier(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 2)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      bool stateInputShutter = Hardware::InputShutter::getShutterState();
-      PRINT(" STATE SHUTTER LOCK : ");
-      PRINTLN(stateInputShutter? "Unlocked (5V): enabled lasers" : "Locked (0V): disabed lasers");
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Lasers::setStateCarrier(toLaserID(argStack[0]), toBool(argStack[1]));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == TEST_LASERS)
+static bool cmdGetShutterLock(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Lasers::test();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    bool stateInputShutter = Hardware::InputShutter::getShutterState();
+    PRINT(" STATE SHUTTER LOCK : ");
+    PRINTLN(stateInputShutter? "Unlocked (5V): enabled lasers" : "Locked (0V): disabed lasers");
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //==========================================================================
-  // 2) ====== SEQUENCER  ====================================================
-  //==========================================================================
-
-  // CLOCK parameter configuration:
-  //#define SET_CLOCK_PERIOD "SET_PERIOD_CLK" // Param: {clk_id, period in ms}
-  else if (_cmdString == SET_CLOCK_PERIOD)
+static bool cmdTestLasers(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if ((_numArgs == 2) && Utils::isNumber(argStack[0]) && Utils::isNumber(argStack[1]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Clocks::arrayClock[argStack[0].toInt()].setPeriodUs(argStack[1].toInt() / 2);
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Lasers::test();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //#define START_CLOCK	         "START_CLK"            // Param: {clk_id}
-  else if (_cmdString == START_CLOCK)
+//==========================================================================
+// 2) ====== SEQUENCER  ====================================================
+//==========================================================================
+
+// CLOCK parameter configuration:
+//#define SET_CLOCK_PERIOD "SET_PERIOD_CLK" // Param: {clk_id, period in ms}
+static bool cmdSetClockPeriod(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::isNumber(argStack[0]) && Utils::isNumber(argStack[1]))
   {
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Clocks::arrayClock[argStack[0].toInt()].start();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Clocks::arrayClock[argStack[0].toInt()].setPeriodUs(argStack[1].toInt() / 2);
+    execFlag = Hardware::Clocks::checkTimers();
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //#define STOP_CLOCK	         "STOP_CLK"             // Param: {clk_id}
-  else if (_cmdString == STOP_CLOCK)
+//#define START_CLOCK	         "START_CLK"            // Param: {clk_id}
+static bool cmdStartClock(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
   {
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Clocks::arrayClock[argStack[0].toInt()].stop();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Clocks::arrayClock[argStack[0].toInt()].start();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_CLOCK_STATE)
+//#define STOP_CLOCK	         "STOP_CLK"             // Param: {clk_id}
+static bool cmdStopClock(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
   {
-    if ((_numArgs == 2) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Clocks::arrayClock[argStack[0].toInt()].setActive(toBool(argStack[1]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Clocks::arrayClock[argStack[0].toInt()].stop();
+    execFlag = true;
   }
-  else if (_cmdString == SET_CLOCK_STATE_ALL)
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdSetClockState(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::isNumber(argStack[0]))
   {
-    if (_numArgs == 1)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Clocks::setStateAllClocks(toBool(argStack[0]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Clocks::arrayClock[argStack[0].toInt()].setActive(toBool(argStack[1]));
+    execFlag = true;
   }
-  else if (_cmdString == RST_CLOCK)
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdSetClockStateAll(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 1)
   {
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Clocks::arrayClock[argStack[0].toInt()].reset();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Clocks::setStateAllClocks(toBool(argStack[0]));
+    execFlag = true;
   }
-  else if (_cmdString == RST_ALL_CLOCKS)
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdRstClock(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Clocks::resetAllClocks();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Clocks::arrayClock[argStack[0].toInt()].reset();
+    execFlag = Hardware::Clocks::checkTimers();
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // TRIGGER PROCESSOR parameter configuration:
-  //#define SET_TRG "SET_TRG"
-  // Param: { trg_id = [0-NUM_TRG_PROCESSORS],
-  //          mode trigger=[0,1,2] (or "rise", "fall", "change")
-  //          burst=[0...],        (positive integer)
-  //          skip=[0...],         (positive integer)
-  //          delay=[0...]         (positive integer)
-  // }
-  else if (_cmdString == SET_TRIGGER_PROCESSOR)
-  {
-    using namespace Hardware::TriggerProcessors;
-    if (_numArgs == 5)
-    {
-      //PRINTLN("> EXECUTING... ");
-      // Get pointer to the processor object:
-      TriggerProcessor *ptr_trgProc = &(arrayTriggerProcessor[argStack[0].toInt()]);
-      // Set parameters:
-      //ptr_trgProc->setMode(static_cast<TrgMode>(argStack[1].toInt()));
-      ptr_trgProc->setMode(toTrgMode(argStack[1])); // can be numeric or string
-      ptr_trgProc->setBurst(argStack[2].toInt());
-      ptr_trgProc->setSkip(argStack[3].toInt());
-      ptr_trgProc->setOffset(argStack[4].toInt());
+static bool cmdBindClockTimer(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::isNumber(argStack[0]) && Utils::isNumber(argStack[1]))
+    execFlag = Hardware::Clocks::bindTimer(argStack[0].toInt(), argStack[1].toInt());
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdUnbindClockTimer(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    Hardware::Clocks::unbindTimer(argStack[0].toInt());
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // PULSE SHAPER parameter configuration:
-  //  #define SET_PULSE_SHAPER "SET_PUL" // Param: {pul_id, time off (us), time on (us)}
-  else if (_cmdString == SET_PULSE_SHAPER)
+static bool cmdRstAllClocks(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 3)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Pulsars::arrayPulsar[argStack[0].toInt()].setParam(argStack[1].toInt(), argStack[2].toInt());
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Clocks::resetAllClocks();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // SEQUENCER activation/deactivation:
-  // #define SET_SEQUENCER_STATE   "SET_STATE_SEQ"   // Param: {0/1}. Deactivate/activate sequencer.
-  else if (_cmdString == SET_SEQUENCER_STATE)
+// TRIGGER PROCESSOR parameter configuration:
+//#define SET_TRG "SET_TRG"
+// Param: { trg_id = [0-NUM_TRG_PROCESSORS],
+//          mode trigger=[0,1,2] (or "rise", "fall", "change")
+//          burst=[0...],        (positive integer)
+//          skip=[0...],         (positive integer)
+//          delay=[0...]         (positive integer)
+// }
+static bool cmdSetTriggerProcessor(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  using namespace Hardware::TriggerProcessors;
+  if (_numArgs == 5)
   {
-    if (_numArgs == 1)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Sequencer::setState(toBool(argStack[0]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    // Get pointer to the processor object:
+    TriggerProcessor *ptr_trgProc = &(arrayTriggerProcessor[argStack[0].toInt()]);
+    // Set parameters:
+    //ptr_trgProc->setMode(static_cast<TrgMode>(argStack[1].toInt()));
+    ptr_trgProc->setMode(toTrgMode(argStack[1])); // can be numeric or string
+    ptr_trgProc->setBurst(argStack[2].toInt());
+    ptr_trgProc->setSkip(argStack[3].toInt());
+    ptr_trgProc->setOffset(argStack[4].toInt());
+
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // #define START_SEQUENCER	      "START_SEQ"
-  else if (_cmdString == START_SEQUENCER)
+// PULSE SHAPER parameter configuration:
+//  #define SET_PULSE_SHAPER "SET_PUL" // Param: {pul_id, time off (us), time on (us)}
+static bool cmdSetPulseShaper(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 3)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Sequencer::setState(true);
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Pulsars::arrayPulsar[argStack[0].toInt()].setParam(argStack[1].toInt(), argStack[2].toInt());
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //#define STOP_SEQUENCER	      "STOP_SEQ"
-  else if (_cmdString == STOP_SEQUENCER)
+//#define SET_LOGIC_GATE "SET_GATE" // Param: {gate_id, function}
+static bool cmdSetLogicGate(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  int8_t function = (_numArgs == 2 ? toGateFunction(argStack[1]) : -1);
+  if ((function >= 0) && (function < NUM_GATE_FUNCTIONS) && Utils::isNumber(argStack[0]))
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Sequencer::setState(false);
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    Hardware::LogicGates::arrayLogicGate[argStack[0].toInt() % NUM_LOGIC_GATES].setFunction(function);
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == RESET_SEQUENCER)
+//#define SET_WAVEFORM "SET_WAVE" // Param: {wave_id, shape, period (us), min, max, cycles}
+static bool cmdSetWaveform(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  int8_t shape = (_numArgs == 6 ? toWaveShape(argStack[1]) : -1);
+  if ((shape >= 0) && (shape < NUM_WAVE_SHAPES) && Utils::isNumber(argStack[0]) && Utils::isNumber(argStack[2]) &&
+      Utils::isNumber(argStack[3]) && Utils::isNumber(argStack[4]) && Utils::isNumber(argStack[5]))
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Sequencer::reset();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    Hardware::Waveforms::arrayWaveform[argStack[0].toInt() % NUM_WAVEFORMS].setParam(
+        shape, argStack[2].toInt(), argStack[3].toInt(), argStack[4].toInt(), argStack[5].toInt());
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // a) Adding a module to the sequencer pipeline:
-  // #define ADD_SEQUENCER_MODULE "ADD_SEQ_MODULE" // Param: {mod_from class code [0-5] and index in the class}
-  else if (_cmdString == ADD_SEQUENCER_MODULE)
+//#define SET_WAVEFORM_TABLE "SET_WAVE_TAB" // Param: {wave_id, values...}
+static bool cmdSetWaveformTable(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs >= 2) && (_numArgs <= SIZE_WAVE_TABLE + 1) && Utils::isNumber(argStack[0]))
   {
-    using namespace Hardware::Sequencer;
-    if (_numArgs == 2)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Module *ptr_newModule = getModulePtr(toClassID(argStack[0]), argStack[1].toInt()); // note: this function is overloaded to
-      // take strings or numbers parameters
-      addModulePipeline(ptr_newModule); // checks if already there...
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    uint16_t table[SIZE_WAVE_TABLE];
+    for (uint8_t k = 1; k < _numArgs; k++)
+      table[k - 1] = argStack[k].toInt();
+    Hardware::Waveforms::arrayWaveform[argStack[0].toInt() % NUM_WAVEFORMS].setTable(table, _numArgs - 1);
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // a) Interconnect two modules: mod_from (must have an output) to mod_to (must accept input)
-  // #define SET_SEQUENCER_LINK "SET_LNK_SEQ" // Param: {mod_from class code [0-5] and index in the class [depends],
-  //                                                      mod_to class code [0-5] and index in the class [depends]}
-  else if (_cmdString == SET_SEQUENCER_LINK)
+//#define SET_WAVEFORM_OUTPUT "SET_WAVE_OUT" // Param: {wave_id, pin or none}
+static bool cmdSetWaveformOutput(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::isNumber(argStack[0]) && (Utils::isNumber(argStack[1]) || (argStack[1] == "none")))
   {
-    using namespace Hardware::Sequencer;
-    if (_numArgs == 4)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Module *ptr_ModuleFrom = getModulePtr(toClassID(argStack[0]), argStack[1].toInt());
-      Module *ptr_ModuleTo = getModulePtr(toClassID(argStack[2]), argStack[3].toInt());
-
-      // Add both modules to the pipeline automatically or it is better to add it first and then make the links?
-      // I will add them automatically for now since we won't be doing soon branching pipelines (TODO: better handling of
-      // multiple or branching pipelines):
-      addModulePipeline(ptr_ModuleFrom);          // checks if already there...
-      addModulePipeline(ptr_ModuleTo);            // checks if already there...
-      ptr_ModuleTo->setInputLink(ptr_ModuleFrom); // no need to check, but value of input will be overwritten
-
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    int16_t pin = (argStack[1] == "none" ? -1 : argStack[1].toInt());
+    Hardware::Waveforms::arrayWaveform[argStack[0].toInt() % NUM_WAVEFORMS].setOutputPin(pin);
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // b) Create a chain of interconnected modules at once:
-  // NOTE: it does NOT delecte whatever was before
-  //#define SET_SEQUENCER_CHAIN "SET_CHAIN_SEQ" // Param: {module1 class and index, module two class and index, ...}
-  else if (_cmdString == SET_SEQUENCER_CHAIN)
+//#define SET_DELAY_LINE "SET_DLY" // Param: {dly_id, delay (ns)}
+static bool cmdSetDelayLine(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::isNumber(argStack[0]) && Utils::isNumber(argStack[1]))
   {
-    using namespace Hardware::Sequencer;
-    if (!(_numArgs % 2)) // number of arguments must be even (there are more tests to do on the ranges, but at least that)
-    {
-      //PRINTLN("> EXECUTING... ");
-      for (uint8_t k = 0; k < _numArgs / 2 - 1; k++)
-      {
-        Module *ptr_ModuleFrom = getModulePtr(toClassID(argStack[2 * k]), argStack[2 * k + 1].toInt());
-        Module *ptr_ModuleTo = getModulePtr(toClassID(argStack[2 * k + 2]), argStack[2 * k + 3].toInt());
+    Hardware::DelayLines::arrayDelayLine[argStack[0].toInt() % NUM_DELAY_LINES].setDelayNs(argStack[1].toInt());
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-        // these methods add to the vector of pointers only if the pointers where not there
-        addModulePipeline(ptr_ModuleFrom);
-        addModulePipeline(ptr_ModuleTo);
+//#define BIND_ONE_SHOT "BIND_OS" // Param: {module class code and index, channel}
+static bool cmdBindOneShot(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 3) && Utils::isNumber(argStack[1]) && Utils::isNumber(argStack[2]))
+  {
+    Module *ptr_module = Hardware::Sequencer::getModulePtr(toClassID(argStack[0]), argStack[1].toInt());
+    execFlag = Hardware::OneShots::bindModule(ptr_module, argStack[2].toInt());
+    if (!execFlag)
+      PRINTLN("> NO HARDWARE EDGES FOR THIS MODULE");
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-        ptr_ModuleTo->setInputLink(ptr_ModuleFrom);
-      }
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+//#define UNBIND_ONE_SHOT "UNBIND_OS" // Param: {module class code and index}
+static bool cmdUnbindOneShot(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::isNumber(argStack[1]))
+  {
+    Hardware::OneShots::unbindModule(Hardware::Sequencer::getModulePtr(toClassID(argStack[0]), argStack[1].toInt()));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // c) Disconnect ALL links (aka, delete the sequencer pipeline). Not the same than reset or deactivate the sequencer!
-  //#define CLEAR_SEQUENCER "CLEAR_SEQ"
-  else if (_cmdString == CLEAR_SEQUENCER)
+// SEQUENCER activation/deactivation:
+// #define SET_SEQUENCER_STATE   "SET_STATE_SEQ"   // Param: {0/1}. Deactivate/activate sequencer.
+static bool cmdSetSequencerState(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 1)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Sequencer::clearPipeline();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Sequencer::setState(toBool(argStack[0]));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // d) Display sequencer pipeline status:
-  //#define DISPLAY_SEQUENCER_STATUS "STATUS_SEQ"
-  else if (_cmdString == DISPLAY_SEQUENCER_STATUS)
+// #define START_SEQUENCER	      "START_SEQ"
+static bool cmdStartSequencer(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Sequencer::displaySequencerStatus();
-      //PRINTLN(msg);
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Sequencer::setState(true);
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //#define SET_STATE_MODULE	"SET_STATE"  // Param: {module1 class, index, on/off}
-  // Setting modules active/inactive independently is useful for debugging at least,
-  // but can have other practical uses (stop one laser but not the other without changing the,
-  // sequencer pipeline, etc):
-  else if (_cmdString == SET_STATE_MODULE)
+//#define STOP_SEQUENCER	      "STOP_SEQ"
+static bool cmdStopSequencer(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 3)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Module *ptr_Module = Hardware::Sequencer::getModulePtr(toClassID(argStack[0]), argStack[1].toInt());
-      ptr_Module->setActive(toBool(argStack[2])); // <-- NOTE: it is then up to the user to set the state it "ends"
-      // being at during the stop (this will depend on the module: for the laser, I think it is better to set it off,
-      // so I will overload the base method "setActive()")
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Sequencer::setState(false);
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //==========================================================================
-  // 3) ====== OPTOTUNER COMMANDS  ===========================================
-  //==========================================================================
-  else if (_cmdString == SET_POWER_OPTOTUNER_ALL)
-  { // Param: 0 to 4096 (12 bit res).
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::OptoTuners::setStatePowerAll(argStack[0].toInt());
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdSetModeSequencer(uint8_t _numArgs, Token argStack[])
+{ // Param: {0/1}. 1 = zero delay mode (topological order)
+  bool execFlag = false;
+  if (_numArgs == 1)
+  {
+    Hardware::Sequencer::setZeroDelayMode(toBool(argStack[0]) > 0);
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_POWER_OPTOTUNER)
-  { // Param: laser number, power (0 to 4096, 12 bit res).
-    if ((_numArgs == 2) && Utils::areNumbers(_numArgs, argStack))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::OptoTuners::setStatePower(argStack[0].toInt(), argStack[1].toInt());
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdSetTickSequencer(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    execFlag = Hardware::Sequencer::setTick(argStack[0].toInt());
+    if (!execFlag)
+      PRINTLN("> TICK TOO SHORT");
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //==========================================================================
-  // C) ====== SCANNER COMMANDS  =============================================
-  //==========================================================================
-  else if (_cmdString == START_DISPLAY)
+static bool cmdResetSequencer(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      DisplayScan::startDisplay();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Sequencer::reset();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == STOP_DISPLAY)
+// a) Adding a module to the sequencer pipeline:
+// #define ADD_SEQUENCER_MODULE "ADD_SEQ_MODULE" // Param: {mod_from class code [0-5] and index in the class}
+static bool cmdAddSequencerModule(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  using namespace Hardware::Sequencer;
+  if (_numArgs == 2)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      DisplayScan::stopDisplay();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Module *ptr_newModule = getModulePtr(toClassID(argStack[0]), argStack[1].toInt()); // note: this function is overloaded to
+    // take strings or numbers parameters
+    addModulePipeline(ptr_newModule); // checks if already there...
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_PERIOD_ISR_DISPLAY)
+// a) Interconnect two modules: mod_from (must have an output) to mod_to (must accept input)
+// #define SET_SEQUENCER_LINK "SET_LNK_SEQ" // Param: {mod_from class code [0-5] and index in the class [depends],
+//                                                      mod_to class code [0-5] and index in the class [depends]}
+static bool cmdSetSequencerLink(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  using namespace Hardware::Sequencer;
+  if (_numArgs == 4)
   {
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+    //PRINTLN("> EXECUTING... ");
+    Module *ptr_ModuleFrom = getModulePtr(toClassID(argStack[0]), argStack[1].toInt());
+    Module *ptr_ModuleTo = getModulePtr(toClassID(argStack[2]), argStack[3].toInt());
+
+    // Add both modules to the pipeline automatically or it is better to add it first and then make the links?
+    // I will add them automatically for now since we won't be doing soon branching pipelines (TODO: better handling of
+    // multiple or branching pipelines):
+    addModulePipeline(ptr_ModuleFrom);          // checks if already there...
+    addModulePipeline(ptr_ModuleTo);            // checks if already there...
+    // NOTE: the value of a single input is overwritten, but a gate only has MAX_GATE_INPUTS:
+    execFlag = ptr_ModuleTo->setInputLink(ptr_ModuleFrom);
+    if (!execFlag)
+      PRINTLN("> TOO MANY GATE INPUTS");
+    compilePipeline(); // the links changed
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+// b) Create a chain of interconnected modules at once:
+// NOTE: it does NOT delecte whatever was before
+//#define SET_SEQUENCER_CHAIN "SET_CHAIN_SEQ" // Param: {module1 class and index, module two class and index, ...}
+static bool cmdSetSequencerChain(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  using namespace Hardware::Sequencer;
+  if (!(_numArgs % 2)) // number of arguments must be even (there are more tests to do on the ranges, but at least that)
+  {
+    //PRINTLN("> EXECUTING... ");
+    execFlag = true;
+    for (uint8_t k = 0; execFlag && (k < _numArgs / 2 - 1); k++)
     {
-      //PRINTLN("> EXECUTING... ");
-      DisplayScan::setInterPointTime(argStack[0].toInt());
-      //DisplayScan::setInterPointTime((uint16_t)atol(argStack[0].c_str()));
-      // convert c-string to long, then cast to unsigned int
-      // the method strtoul needs a c-string, so we need to convert the String to that:
-      //DisplayScan::setInterPointTime(strtoul(argStack[0].c_str(),NULL,10); // base 10
-      execFlag = true;
+      Module *ptr_ModuleFrom = getModulePtr(toClassID(argStack[2 * k]), argStack[2 * k + 1].toInt());
+      Module *ptr_ModuleTo = getModulePtr(toClassID(argStack[2 * k + 2]), argStack[2 * k + 3].toInt());
+
+      // these methods add to the vector of pointers only if the pointers where not there
+      addModulePipeline(ptr_ModuleFrom);
+      addModulePipeline(ptr_ModuleTo);
+
+      execFlag = ptr_ModuleTo->setInputLink(ptr_ModuleFrom);
+      if (!execFlag)
+        PRINTLN("> TOO MANY GATE INPUTS");
     }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    compilePipeline(); // the links changed
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == DISPLAY_STATUS)
+// c) Disconnect ALL links (aka, delete the sequencer pipeline). Not the same than reset or deactivate the sequencer!
+//#define CLEAR_SEQUENCER "CLEAR_SEQ"
+static bool cmdClearSequencer(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Sequencer::clearPipeline();
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-      PRINT(" 1-CLEAR MODE: ");
-      if (Graphics::getClearMode())
-        PRINTLN("ON");
-      else
-        PRINTLN("OFF");
+// d) Display sequencer pipeline status:
+//#define DISPLAY_SEQUENCER_STATUS "STATUS_SEQ"
+static bool cmdDisplaySequencerStatus(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Sequencer::displaySequencerStatus();
+    //PRINTLN(msg);
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-      PRINT(" 2-SCENE PTS: ");
-      PRINTLN(Renderer2D::getSizeBlueprint());
+static bool cmdSetRecordSequencer(uint8_t _numArgs, Token argStack[])
+{ // Param: {0/1}
+  bool execFlag = false;
+  if (_numArgs == 1)
+  {
+    Hardware::Sequencer::setRecording(toBool(argStack[0]) > 0);
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-      PRINT(" 3-DISPLAY ISR: ");
-      if (DisplayScan::getRunningState())
-        PRINT("ON");
-      else
-        PRINT("OFF");
-      PRINT(" / PERIOD: ");
-      PRINT(DisplayScan::getInterPointTime());
-      PRINT(" us");
-      PRINT(" / BUFFER: ");
-      PRINT(DisplayScan::getBufferSize());
-      PRINTLN(" points");
-
-      PRINT(" 6-INTERPOINT BLANKING: ");
-      if (DisplayScan::getInterPointBlankingMode())
-        PRINTLN("ON");
-      else
-        PRINTLN("OFF");
+static bool cmdDumpRecordSequencer(uint8_t _numArgs, Token argStack[])
+{
+  Hardware::Sequencer::dumpEvents();
+  return (true);
+}
 
-      PRINTLN(" 7-LASERS [power, state, carrier, inter-fig blank]: ");
-      Laser::LaserState laserState;
-      for (uint8_t k = 0; k < NUM_LASERS; k++)
-      {
-        PRINT("     ");
-        PRINT(Hardware::Lasers::laserArray[k].getName());
-        laserState = Hardware::Lasers::laserArray[k].getCurrentState();
-        PRINT("\t[");
-        PRINT(laserState.power);
-        PRINT(", ");
-        PRINT(laserState.stateSwitch > 0 ? "on" : "off");
-        PRINT(", ");
-        PRINT(laserState.stateCarrier > 0 ? "on" : "off");
-        PRINT(", ");
-        PRINT(laserState.stateBlanking > 0 ? "on" : "off");
-        PRINTLN("]");
-      }
-      bool stateInputShutter = Hardware::InputShutter::getShutterState();
-      PRINT(" 8- GLOBAL SHUTTER LOCK: ");
-      PRINTLN(stateInputShutter? "Unlocked (5V): enabled lasers" : "Locked (0V): disabed lasers");
+static bool cmdSaveRecordSequencer(uint8_t _numArgs, Token argStack[])
+{ // Param: {file name}
+  bool execFlag = false;
+  if ((_numArgs == 1) && (argStack[0].length() < SIZE_SCRIPT_NAME))
+    execFlag = Hardware::Sequencer::saveEvents(argStack[0].c_str());
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+//#define SET_STATE_MODULE	"SET_STATE"  // Param: {module1 class, index, on/off}
+// Setting modules active/inactive independently is useful for debugging at least,
+// but can have other practical uses (stop one laser but not the other without changing the,
+// sequencer pipeline, etc):
+static bool cmdSetStateModule(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 3)
+  {
+    //PRINTLN("> EXECUTING... ");
+    Module *ptr_Module = Hardware::Sequencer::getModulePtr(toClassID(argStack[0]), argStack[1].toInt());
+    ptr_Module->setActive(toBool(argStack[2])); // <-- NOTE: it is then up to the user to set the state it "ends"
+    // being at during the stop (this will depend on the module: for the laser, I think it is better to set it off,
+    // so I will overload the base method "setActive()")
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //==========================================================================
-  // D) ======= POSE PARAMETERS ("OpenGL"-like state machine) ================
-  //==========================================================================
-  //  * NOTE 1 : This is a very simplified "open-gl" like rendering engine, but
-  //    should be handy anyway. It works as follows: the pose parameters are applied
-  //    whenever we draw a figure; that's why it is interesting to have parameters-less,
-  //    normalized primitives: when modifying the angle, center and scale, EVERYTHING
-  //    being displayed is re-scaled, rotated and/or translated.
-  //  * NOTE 2 : In the future, use a MODELVIEW MATRIX instead, and make some
-  //    methods to set "passive transforms" (as in my laserSensingDisplay code)
-  //  * NOTE 3 : Instead of doing Graphics::... we could just do:
-  //                     using namespace Graphics;
-  //    However, I prefer the suffix for clarity (my Object Oriented bias...)
-  //==========================================================================
-  else if (_cmdString == RESET_POSE_GLOBAL)
-  { // Param: none
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Graphics::resetGlobalPose();
-      // As explained above, we need to RE-RENDER the display buffer:
-      Renderer2D::renderFigure();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+//==========================================================================
+// 3) ====== OPTOTUNER COMMANDS  ===========================================
+//==========================================================================
+static bool cmdSetPowerOptotunerAll(uint8_t _numArgs, Token argStack[])
+{ // Param: 0 to 4096 (12 bit res).
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::OptoTuners::setStatePowerAll(argStack[0].toInt());
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_ANGLE_GLOBAL)
-  { // Param: angle in DEG (float)
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Graphics::setAngle(argStack[0].toFloat());
-      Renderer2D::renderFigure();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdSetPowerOptotuner(uint8_t _numArgs, Token argStack[])
+{ // Param: laser number, power (0 to 4096, 12 bit res).
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::areNumbers(_numArgs, argStack))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::OptoTuners::setStatePower(argStack[0].toInt(), argStack[1].toInt());
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_CENTER_GLOBAL)
-  { // Param: x,y
-    if ((_numArgs == 2) && Utils::areNumbers(_numArgs, argStack))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Graphics::setCenter(argStack[0].toFloat(), argStack[1].toFloat());
-      Renderer2D::renderFigure();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+//==========================================================================
+// C) ====== SCANNER COMMANDS  =============================================
+//==========================================================================
+static bool cmdStartDisplay(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    //PRINTLN("> EXECUTING... ");
+    DisplayScan::startDisplay();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_SCALE_GLOBAL)
-  { // Param: scale
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Graphics::setScaleFactor(argStack[0].toFloat());
-      Renderer2D::renderFigure();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdStopDisplay(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    //PRINTLN("> EXECUTING... ");
+    DisplayScan::stopDisplay();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_COLOR_GLOBAL)
-  { // Param: color bool [TODO: real colors]
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Graphics::setColorRed(argStack[0].toInt());
-      Renderer2D::renderFigure(); // <<== this will really be useful soon, as we will have a per-point color
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdSetPeriodIsrDisplay(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    DisplayScan::setInterPointTime(argStack[0].toInt());
+    //DisplayScan::setInterPointTime((uint16_t)atol(argStack[0].c_str()));
+    // convert c-string to long, then cast to unsigned int
+    // the method strtoul needs a c-string, so we need to convert the String to that:
+    //DisplayScan::setInterPointTime(strtoul(argStack[0].c_str(),NULL,10); // base 10
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //==========================================================================
-  // E) ============ FIGURES (check Graphics namespace) ======================
-  // * NOTE 1 : after all the figure composition, it is
-  // imperative to call to the method Renderer2D::renderFigure().
-  // * NOTE 2 : The pose parameters are COMPOSED with the global ones.
-  // * NOTE 3 : Depending on the number of arguments, different pre-sets are used
-  //==========================================================================
+static bool cmdDisplayStatus(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    //PRINTLN("> EXECUTING... ");
+
+    PRINT(" 1-CLEAR MODE: ");
+    if (Graphics::getClearMode())
+      PRINTLN("ON");
+    else
+      PRINTLN("OFF");
+
+    PRINT(" 2-SCENE PTS: ");
+    PRINTLN(Renderer2D::getSizeBlueprint());
+
+    PRINT(" 3-DISPLAY ISR: ");
+    if (DisplayScan::getRunningState())
+      PRINT("ON");
+    else
+      PRINT("OFF");
+    PRINT(" / PERIOD: ");
+    PRINT(DisplayScan::getInterPointTime());
+    PRINT(" us");
+    PRINT(" / BUFFER: ");
+    PRINT(DisplayScan::getBufferSize());
+    PRINTLN(" points");
+
+    PRINT(" 4-COLOR (LASER MASK): ");
+    PRINTLN(Graphics::getLaserMask());
+
+    PRINT(" 6-INTERPOINT BLANKING: ");
+    if (DisplayScan::getInterPointBlankingMode())
+      PRINTLN("ON");
+    else
+      PRINTLN("OFF");
+
+    PRINTLN(" 7-LASERS [power, state, carrier, inter-fig blank] lead on/off: ");
+    Laser::LaserState laserState;
+    for (uint8_t k = 0; k < NUM_LASERS; k++)
+    {
+      PRINT("     ");
+      PRINT(Hardware::Lasers::laserArray[k].getName());
+      laserState = Hardware::Lasers::laserArray[k].getCurrentState();
+      PRINT("\t[");
+      PRINT(laserState.power);
+      PRINT(", ");
+      PRINT(laserState.stateSwitch > 0 ? "on" : "off");
+      PRINT(", ");
+      PRINT(laserState.stateCarrier > 0 ? "on" : "off");
+      PRINT(", ");
+      PRINT(laserState.stateBlanking > 0 ? "on" : "off");
+      PRINT("] ");
+      PRINT(DisplayScan::getLaserOnLead(k));
+      PRINT("/");
+      PRINT(DisplayScan::getLaserOffLead(k));
+      PRINTLN(" us");
+    }
+    bool stateInputShutter = Hardware::InputShutter::getShutterState();
+    PRINT(" 8- GLOBAL SHUTTER LOCK: ");
+    PRINTLN(stateInputShutter? "Unlocked (5V): enabled lasers" : "Locked (0V): disabed lasers");
+
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // == CLEAR SCENE and CLEAR MODE ==========================================
-  else if (_cmdString == CLEAR_SCENE)
+//==========================================================================
+// D) ======= POSE PARAMETERS ("OpenGL"-like state machine) ================
+//==========================================================================
+//  * NOTE 1 : This is a very simplified "open-gl" like rendering engine, but
+//    should be handy anyway. It works as follows: the pose parameters are applied
+//    whenever we draw a figure; that's why it is interesting to have parameters-less,
+//    normalized primitives: when modifying the angle, center and scale, EVERYTHING
+//    being displayed is re-scaled, rotated and/or translated.
+//  * NOTE 2 : In the future, use a MODELVIEW MATRIX instead, and make some
+//    methods to set "passive transforms" (as in my laserSensingDisplay code)
+//  * NOTE 3 : Instead of doing Graphics::... we could just do:
+//                     using namespace Graphics;
+//    However, I prefer the suffix for clarity (my Object Oriented bias...)
+//==========================================================================
+static bool cmdResetPoseGlobal(uint8_t _numArgs, Token argStack[])
+{ // Param: none
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
+    //PRINTLN("> EXECUTING... ");
+    Graphics::resetGlobalPose();
+    // As explained above, we need to RE-RENDER the display buffer:
+    Renderer2D::renderFigure();
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-      // The sequence order and items is arbitrary:
-      Graphics::clearScene();
-      // clear also the pose parameters - otherwise there is a lot of confusion:
-      Graphics::resetGlobalPose();
+static bool cmdSetAngleGlobal(uint8_t _numArgs, Token argStack[])
+{ // Param: angle in DEG (float)
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Graphics::setAngle(argStack[0].toFloat());
+    Renderer2D::renderFigure();
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdSetCenterGlobal(uint8_t _numArgs, Token argStack[])
+{ // Param: x,y
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::areNumbers(_numArgs, argStack))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Graphics::setCenter(argStack[0].toFloat(), argStack[1].toFloat());
+    Renderer2D::renderFigure();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == CLEAR_MODE)
+static bool cmdSetScaleGlobal(uint8_t _numArgs, Token argStack[])
+{ // Param: scale
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
   {
-    if (_numArgs == 1)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Graphics::setClearMode(toBool(argStack[0]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    Graphics::setScaleFactor(argStack[0].toFloat());
+    Renderer2D::renderFigure();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_BLANKING_ALL)
+static bool cmdSetColorGlobal(uint8_t _numArgs, Token argStack[])
+{ // Param: laser mask (bit k = laser k)
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
   {
-    if (_numArgs == 1)
-    {
-      //PRINTLN("> EXECUTING... ");
-      // This is delicate: we need to stop the displaying engine, and reset it (in particular
-      // the style stack, or we may run into overflows because the variable affects the program flow)
-      Hardware::Lasers::setStateBlankingAll(toBool(argStack[0]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+    // NOTE: no need to re-render: the mask is stored per-vertex when drawing the next figures
+    Graphics::setLaserMask(argStack[0].toInt());
+    execFlag = true;
   }
-  else if (_cmdString == SET_BLANKING)
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+//==========================================================================
+// E) ============ FIGURES (check Graphics namespace) ======================
+// * NOTE 1 : after all the figure composition, it is
+// imperative to call to the method Renderer2D::renderFigure().
+// * NOTE 2 : The pose parameters are COMPOSED with the global ones.
+// * NOTE 3 : Depending on the number of arguments, different pre-sets are used
+//==========================================================================
+
+// == CLEAR SCENE and CLEAR MODE ==========================================
+static bool cmdClearScene(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if ((_numArgs == 2) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      // This is delicate: we need to stop the displaying engine, and reset it (in particular
-      // the style stack, or we may run into overflows because the variable affects the program flow),
-      // OR, we don't use the style stack (I decided for the later for the time being)
-      Hardware::Lasers::setStateBlanking(toLaserID(argStack[0]), toBool(argStack[1]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    //PRINTLN("> EXECUTING... ");
+
+    // The sequence order and items is arbitrary:
+    Graphics::clearScene();
+    // clear also the pose parameters - otherwise there is a lot of confusion:
+    Graphics::resetGlobalPose();
+
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_INTER_POINT_BLANK)
-  { // for the time being, this is for ALL lasers:
-    // for the time being, this is a "DisplayScan"
-    // method [in the future, a per-laser method?]
-    if (_numArgs == 1)
-    {
-      //PRINTLN("> EXECUTING... ");
-      DisplayScan::setInterPointBlankingMode(toBool(argStack[0]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdClearMode(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 1)
+  {
+    //PRINTLN("> EXECUTING... ");
+    Graphics::setClearMode(toBool(argStack[0]));
+    execFlag = true;
   }
-  //================== GRAPHICS ============================
- // ======================================================
- else if (_cmdString == MAKE_POINT)
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdSetBlankingAll(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 1)
   {
-    if ((_numArgs == 2) && Utils::areNumbers(_numArgs, argStack)) {
-        Graphics::updateScene();
-        Graphics::addVertex(P2(argStack[0].toFloat(), argStack[1].toFloat()));
-        Renderer2D::renderFigure();
-        execFlag = true;
-    }
+    //PRINTLN("> EXECUTING... ");
+    // This is delicate: we need to stop the displaying engine, and reset it (in particular
+    // the style stack, or we may run into overflows because the variable affects the program flow)
+    Hardware::Lasers::setStateBlankingAll(toBool(argStack[0]));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == MAKE_TRAJECTORY)
+static bool cmdSetBlanking(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::isNumber(argStack[0]))
   {
-    if (!(_numArgs %2 ) && Utils::areNumbers(_numArgs, argStack)) {
-      Graphics::updateScene();
-        for (uint16_t i = 0; i < _numArgs; i+=2)
-        {
-          Graphics::addVertex(P2(argStack[i].toFloat(), argStack[i+1].toFloat()));
-        }
-        Renderer2D::renderFigure();
-        execFlag = true;
-    }
+    //PRINTLN("> EXECUTING... ");
+    // This is delicate: we need to stop the displaying engine, and reset it (in particular
+    // the style stack, or we may run into overflows because the variable affects the program flow),
+    // OR, we don't use the style stack (I decided for the later for the time being)
+    Hardware::Lasers::setStateBlanking(toLaserID(argStack[0]), toBool(argStack[1]));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // == MAKE LINE ==========================================
+static bool cmdSetInterPointBlank(uint8_t _numArgs, Token argStack[])
+{ // for the time being, this is for ALL lasers:
+  bool execFlag = false;
+  // for the time being, this is a "DisplayScan"
+  // method [in the future, a per-laser method?]
+  if (_numArgs == 1)
+  {
+    //PRINTLN("> EXECUTING... ");
+    DisplayScan::setInterPointBlankingMode(toBool(argStack[0]));
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == MAKE_LINE)
+static bool cmdSetLaserLead(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 3) && Utils::isNumber(argStack[1]) && Utils::isNumber(argStack[2]))
   {
-    if (Utils::areNumbers(_numArgs, argStack))
+    int8_t laserIndex = toLaserID(argStack[0]);
+    if (laserIndex >= 0)
     {
-      switch (_numArgs)
-      {
-      case 3: //origina at (0,0)
-        //PRINTLN("> EXECUTING... ");
-        Graphics::updateScene();
-        Graphics::drawLine(
-            argStack[0].toFloat(), argStack[1].toFloat(),
-            argStack[2].toInt());
-        Renderer2D::renderFigure();
-        execFlag = true;
-        break;
-      case 5:
-      {
-        //PRINTLN("> EXECUTING... ");
-        Graphics::updateScene();
-        // from point, lenX, lenY, num points
-        P2 startP2(argStack[0].toFloat(), argStack[1].toFloat());
-        Graphics::drawLine(
-            startP2,
-            argStack[2].toFloat(), argStack[3].toFloat(),
-            argStack[4].toInt());
-        Renderer2D::renderFigure();
-      }
-        execFlag = true;
-        break;
-      default:
-        PRINTLN("> BAD PARAMETERS");
-        break;
-      }
+      DisplayScan::setLaserLead(laserIndex, argStack[1].toInt(), argStack[2].toInt());
+      execFlag = true;
     }
     else
-    {
       PRINTLN("> BAD PARAMETERS");
-    }
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // == MAKE CIRCLE ==========================================
-  // a) Depending on the number of arguments, we do something different:
-  //    - with one parameter (nb points), we draw a circle in (0,0) with unit radius
-  //      [of course, the radius is multiplied by the current scaling factor]
-  else if (_cmdString == MAKE_CIRCLE)
-  {
-    if (Utils::areNumbers(_numArgs, argStack))
-    {
-      switch (_numArgs)
+//================== GRAPHICS ============================
+// ======================================================
+static bool cmdMakePoint(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::areNumbers(_numArgs, argStack)) {
+      Graphics::updateScene();
+      Graphics::addVertex(P2(argStack[0].toFloat(), argStack[1].toFloat()));
+      Renderer2D::renderFigure();
+      execFlag = true;
+  }
+  return (execFlag);
+}
+
+static bool cmdMakeTrajectory(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (!(_numArgs %2 ) && Utils::areNumbers(_numArgs, argStack)) {
+    Graphics::updateScene();
+      for (uint16_t i = 0; i < _numArgs; i+=2)
       {
-      case 2: // radius + num points [centered]
-        //PRINTLN("> EXECUTING... ");
-        Graphics::updateScene();
-        Graphics::drawCircle(argStack[0].toFloat(), argStack[1].toInt());
-        Renderer2D::renderFigure();
-        execFlag = true;
-        break;
-      case 4:
-      { // center point, radius, num points
-        //PRINTLN("> EXECUTING... ");
-        Graphics::updateScene();
-        P2 centerP2(argStack[0].toFloat(), argStack[1].toFloat());
-        Graphics::drawCircle(centerP2, argStack[2].toFloat(), argStack[3].toInt());
-        Renderer2D::renderFigure();
-        execFlag = true;
+        Graphics::addVertex(P2(argStack[i].toFloat(), argStack[i+1].toFloat()));
       }
+      Renderer2D::renderFigure();
+      execFlag = true;
+  }
+  return (execFlag);
+}
+
+// == MAKE LINE ==========================================
+
+static bool cmdMakeLine(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (Utils::areNumbers(_numArgs, argStack))
+  {
+    switch (_numArgs)
+    {
+    case 3: //origina at (0,0)
+      //PRINTLN("> EXECUTING... ");
+      Graphics::updateScene();
+      Graphics::drawLine(
+          argStack[0].toFloat(), argStack[1].toFloat(),
+          argStack[2].toInt());
+      Renderer2D::renderFigure();
+      execFlag = true;
       break;
-      default:
-        PRINTLN("> BAD PARAMETERS");
-        break;
-      }
-    }
-    else
+    case 5:
     {
-      PRINTLN("> BAD PARAMETERS");
+      //PRINTLN("> EXECUTING... ");
+      Graphics::updateScene();
+      // from point, lenX, lenY, num points
+      P2 startP2(argStack[0].toFloat(), argStack[1].toFloat());
+      Graphics::drawLine(
+          startP2,
+          argStack[2].toFloat(), argStack[3].toFloat(),
+          argStack[4].toInt());
+      Renderer2D::renderFigure();
     }
-  }
-
-  // == MAKE RECTANGLE ==========================================
-  else if (_cmdString == MAKE_RECTANGLE)
-  {
-    if (Utils::areNumbers(_numArgs, argStack))
-    {
-      switch (_numArgs)
-      {
-      case 4: // [centered]
-        //PRINTLN("> EXECUTING... ");
-        Graphics::updateScene();
-        Graphics::drawRectangle(
-            argStack[0].toFloat(), argStack[1].toFloat(),
-            argStack[2].toInt(), argStack[3].toInt());
-        Renderer2D::renderFigure();
-        execFlag = true;
-        break;
-      case 6:
-      { // From lower left corner:
-        //PRINTLN("> EXECUTING... ");
-        Graphics::updateScene();
-        P2 fromP2(argStack[0].toFloat(), argStack[1].toFloat());
-        Graphics::drawRectangle(
-            fromP2,
-            argStack[2].toFloat(), argStack[3].toFloat(),
-            argStack[4].toInt(), argStack[5].toInt());
-        Renderer2D::renderFigure();
-        execFlag = true;
-      }
+      execFlag = true;
       break;
-      default:
-        PRINTLN("> BAD PARAMETERS");
-        break;
-      }
-    }
-    else
-    {
+    default:
       PRINTLN("> BAD PARAMETERS");
+      break;
     }
   }
+  else
+  {
+    PRINTLN("> BAD PARAMETERS");
+  }
+  return (execFlag);
+}
 
-  // == MAKE SQUARE ==========================================
-  else if (_cmdString == MAKE_SQUARE)
+// == MAKE CIRCLE ==========================================
+// a) Depending on the number of arguments, we do something different:
+//    - with one parameter (nb points), we draw a circle in (0,0) with unit radius
+//      [of course, the radius is multiplied by the current scaling factor]
+static bool cmdMakeCircle(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (Utils::areNumbers(_numArgs, argStack))
   {
-    if (Utils::areNumbers(_numArgs, argStack))
+    switch (_numArgs)
     {
-      switch (_numArgs)
-      {
-      case 2: // side, num point [centered]
-        //PRINTLN("> EXECUTING... ");
-        Graphics::updateScene();
-        Graphics::drawSquare(argStack[0].toFloat(), argStack[1].toInt());
-        Renderer2D::renderFigure();
-        execFlag = true;
-        break;
-      case 4:
-      { // center point, radius, num points
-        //PRINTLN("> EXECUTING... ");
-        Graphics::updateScene();
-        P2 fromP2(argStack[0].toFloat(), argStack[1].toFloat());
-        Graphics::drawSquare(fromP2, argStack[2].toFloat(), argStack[3].toInt());
-        Renderer2D::renderFigure();
-        execFlag = true;
-      }
+    case 2: // radius + num points [centered]
+      //PRINTLN("> EXECUTING... ");
+      Graphics::updateScene();
+      Graphics::drawCircle(argStack[0].toFloat(), argStack[1].toInt());
+      Renderer2D::renderFigure();
+      execFlag = true;
       break;
-      default:
-        PRINTLN("> BAD PARAMETERS");
-        break;
-      }
+    case 4:
+    { // center point, radius, num points
+      //PRINTLN("> EXECUTING... ");
+      Graphics::updateScene();
+      P2 centerP2(argStack[0].toFloat(), argStack[1].toFloat());
+      Graphics::drawCircle(centerP2, argStack[2].toFloat(), argStack[3].toInt());
+      Renderer2D::renderFigure();
+      execFlag = true;
     }
-    else
-    {
+    break;
+    default:
       PRINTLN("> BAD PARAMETERS");
+      break;
     }
   }
+  else
+  {
+    PRINTLN("> BAD PARAMETERS");
+  }
+  return (execFlag);
+}
 
-  else if (_cmdString == MAKE_ZIGZAG)
+// == MAKE RECTANGLE ==========================================
+static bool cmdMakeRectangle(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (Utils::areNumbers(_numArgs, argStack))
   {
     switch (_numArgs)
     {
-    case 5: // Centered on [0,0]
+    case 4: // [centered]
       //PRINTLN("> EXECUTING... ");
       Graphics::updateScene();
-      Graphics::drawZigZag(
+      Graphics::drawRectangle(
           argStack[0].toFloat(), argStack[1].toFloat(),
-          argStack[2].toInt(), argStack[3].toInt(),
-          toBool(argStack[4]));
+          argStack[2].toInt(), argStack[3].toInt());
       Renderer2D::renderFigure();
       execFlag = true;
       break;
-    case 7:
-    { // from left bottom corner:
+    case 6:
+    { // From lower left corner:
       //PRINTLN("> EXECUTING... ");
       Graphics::updateScene();
       P2 fromP2(argStack[0].toFloat(), argStack[1].toFloat());
-      Graphics::drawZigZag(
+      Graphics::drawRectangle(
           fromP2,
           argStack[2].toFloat(), argStack[3].toFloat(),
-          argStack[4].toInt(), argStack[5].toInt(),
-          toBool(argStack[6]));
+          argStack[4].toInt(), argStack[5].toInt());
       Renderer2D::renderFigure();
       execFlag = true;
     }
@@ -1361,31 +2231,34 @@ bool interpretCommand(String _cmdString, uint8_t _numArgs, String argStack[])
       break;
     }
   }
+  else
+  {
+    PRINTLN("> BAD PARAMETERS");
+  }
+  return (execFlag);
+}
 
-  else if (_cmdString == MAKE_SPIRAL)
+// == MAKE SQUARE ==========================================
+static bool cmdMakeSquare(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (Utils::areNumbers(_numArgs, argStack))
   {
     switch (_numArgs)
     {
-    case 4:
+    case 2: // side, num point [centered]
+      //PRINTLN("> EXECUTING... ");
       Graphics::updateScene();
-      Graphics::drawSpiral(
-          argStack[0].toFloat(), // radius arm [ r= radiusArm * theta ]
-          argStack[1].toFloat(),
-          argStack[2].toInt(),  // num points
-          toBool(argStack[3])); // interlaced with return or not
+      Graphics::drawSquare(argStack[0].toFloat(), argStack[1].toInt());
       Renderer2D::renderFigure();
       execFlag = true;
       break;
-    case 6:
-    {
+    case 4:
+    { // center point, radius, num points
+      //PRINTLN("> EXECUTING... ");
       Graphics::updateScene();
-      P2 center(argStack[0].toFloat(), argStack[1].toFloat());
-      Graphics::drawSpiral(
-          center,
-          argStack[2].toFloat(), // radius arm [ r= radiusArm * theta ]
-          argStack[3].toFloat(), // num tours (float)
-          argStack[4].toInt(),   // num points
-          toBool(argStack[5]));  // interlaced with return or not
+      P2 fromP2(argStack[0].toFloat(), argStack[1].toFloat());
+      Graphics::drawSquare(fromP2, argStack[2].toFloat(), argStack[3].toInt());
       Renderer2D::renderFigure();
       execFlag = true;
     }
@@ -1395,495 +2268,1041 @@ bool interpretCommand(String _cmdString, uint8_t _numArgs, String argStack[])
       break;
     }
   }
+  else
+  {
+    PRINTLN("> BAD PARAMETERS");
+  }
+  return (execFlag);
+}
+
+static bool cmdMakeZigzag(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  switch (_numArgs)
+  {
+  case 5: // Centered on [0,0]
+    //PRINTLN("> EXECUTING... ");
+    Graphics::updateScene();
+    Graphics::drawZigZag(
+        argStack[0].toFloat(), argStack[1].toFloat(),
+        argStack[2].toInt(), argStack[3].toInt(),
+        toBool(argStack[4]));
+    Renderer2D::renderFigure();
+    execFlag = true;
+    break;
+  case 7:
+  { // from left bottom corner:
+    //PRINTLN("> EXECUTING... ");
+    Graphics::updateScene();
+    P2 fromP2(argStack[0].toFloat(), argStack[1].toFloat());
+    Graphics::drawZigZag(
+        fromP2,
+        argStack[2].toFloat(), argStack[3].toFloat(),
+        argStack[4].toInt(), argStack[5].toInt(),
+        toBool(argStack[6]));
+    Renderer2D::renderFigure();
+    execFlag = true;
+  }
+  break;
+  default:
+    PRINTLN("> BAD PARAMETERS");
+    break;
+  }
+  return (execFlag);
+}
+
+static bool cmdMakeSpiral(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  switch (_numArgs)
+  {
+  case 4:
+    Graphics::updateScene();
+    Graphics::drawSpiral(
+        argStack[0].toFloat(), // radius arm [ r= radiusArm * theta ]
+        argStack[1].toFloat(),
+        argStack[2].toInt(),  // num points
+        toBool(argStack[3])); // interlaced with return or not
+    Renderer2D::renderFigure();
+    execFlag = true;
+    break;
+  case 6:
+  {
+    Graphics::updateScene();
+    P2 center(argStack[0].toFloat(), argStack[1].toFloat());
+    Graphics::drawSpiral(
+        center,
+        argStack[2].toFloat(), // radius arm [ r= radiusArm * theta ]
+        argStack[3].toFloat(), // num tours (float)
+        argStack[4].toInt(),   // num points
+        toBool(argStack[5]));  // interlaced with return or not
+    Renderer2D::renderFigure();
+    execFlag = true;
+  }
+  break;
+  default:
+    PRINTLN("> BAD PARAMETERS");
+    break;
+  }
+  return (execFlag);
+}
+
+// RASTER and RASTER_HZ only differ in the meaning of the third parameter (points per line or line rate in Hz):
+static bool makeRaster(bool _lineRateHz, uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  // The origin is optional (9 or 11 parameters):
+  uint8_t offset = (_numArgs == 11 ? 2 : 0);
+  if (((_numArgs == 9) || (_numArgs == 11)) && Utils::areNumbers(_numArgs, argStack) &&
+      (!_lineRateHz || (argStack[offset + 2].toFloat() > 0)))
+  {
+    Graphics::updateScene();
+    uint16_t numPointsTurn = argStack[offset + 6].toInt();
+    uint16_t numPointsLine;
+    if (_lineRateHz)
+      numPointsLine = Graphics::pointsPerLine(argStack[offset + 2].toFloat(), numPointsTurn);
+    else
+      numPointsLine = argStack[offset + 2].toInt();
+
+    P2 fromP2(-argStack[offset].toFloat() / 2, -argStack[offset + 1].toFloat() / 2); // centered
+    if (offset)
+      fromP2.set(argStack[0].toFloat(), argStack[1].toFloat()); // from left bottom corner
+
+    Graphics::drawRaster(
+        fromP2,
+        argStack[offset].toFloat(), argStack[offset + 1].toFloat(), // width, height
+        numPointsLine, argStack[offset + 3].toInt(),
+        toBool(argStack[offset + 4]),                              // bidirectional
+        argStack[offset + 5].toInt(), numPointsTurn,               // turn shape and points
+        argStack[offset + 7].toFloat(), argStack[offset + 8].toFloat()); // phase offsets (points)
+    Renderer2D::renderFigure();
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdMakeRaster(uint8_t _numArgs, Token argStack[]) { return (makeRaster(false, _numArgs, argStack)); }
+static bool cmdMakeRasterHz(uint8_t _numArgs, Token argStack[]) { return (makeRaster(true, _numArgs, argStack)); }
 
-  // ....
+// ....
 
-  // F) TEST FIGURES [this is a test: scene is CLEARED whatever the clear state,
-  // and displaying is STARTED whatever the previous state]. Laser Color and mode
-  // is given by the currest state of lasers.
+// F) TEST FIGURES [this is a test: scene is CLEARED whatever the clear state,
+// and displaying is STARTED whatever the previous state]. Laser Color and mode
+// is given by the currest state of lasers.
 
-  // a) LINE TEST:
-  else if (_cmdString == LINE_TEST)
+// a) LINE TEST:
+static bool cmdLineTest(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Graphics::clearScene();
+    //PRINTLN("> EXECUTING... ");
+    Graphics::clearScene();
 
-      Graphics::drawLine(P2(-50.0, -30), 100, 60, 50); // first argument is the radius
-      // REM: equal to: Graphics::setScaleFactor(500); Graphics::drawCircle(100);
+    Graphics::drawLine(P2(-50.0, -30), 100, 60, 50); // first argument is the radius
+    // REM: equal to: Graphics::setScaleFactor(500); Graphics::drawCircle(100);
 
-      // NOTE: the color attributes will be used by the renderer in the future.
-      // USE CURRENT PARAMETERS:
-      //Hardware::Lasers::setStatePowerRed(1000);
-      //Hardware::Lasers::setStateSwitchRed(true);
+    // NOTE: the color attributes will be used by the renderer in the future.
+    // USE CURRENT PARAMETERS:
+    //Hardware::Lasers::setStatePowerRed(1000);
+    //Hardware::Lasers::setStateSwitchRed(true);
 
-      Renderer2D::renderFigure();
+    Renderer2D::renderFigure();
 
-      DisplayScan::startDisplay(); // start engine, whatever the previous state
+    DisplayScan::startDisplay(); // start engine, whatever the previous state
 
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // b) CIRCLE, NO PARAMETERS [500 ADC units radius circle, centered, 100 points]
-  else if (_cmdString == CIRCLE_TEST)
+// b) CIRCLE, NO PARAMETERS [500 ADC units radius circle, centered, 100 points]
+static bool cmdCircleTest(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Graphics::clearScene();
+    //PRINTLN("> EXECUTING... ");
+    Graphics::clearScene();
 
-      Graphics::drawCircle(50.0, 100); // first argument is the radius
-      // REM: equal to: Graphics::setScaleFactor(500); Graphics::drawCircle(100);
+    Graphics::drawCircle(50.0, 100); // first argument is the radius
+    // REM: equal to: Graphics::setScaleFactor(500); Graphics::drawCircle(100);
 
-      // NOTE: the color attributes will be used by the renderer in the future.
-      // USE CURRENT PARAMETERS:
-      //Hardware::Lasers::setStatePowerRed(1000);
-      //Hardware::Lasers::setStateSwitchRed(true);
+    // NOTE: the color attributes will be used by the renderer in the future.
+    // USE CURRENT PARAMETERS:
+    //Hardware::Lasers::setStatePowerRed(1000);
+    //Hardware::Lasers::setStateSwitchRed(true);
 
-      Renderer2D::renderFigure();
+    Renderer2D::renderFigure();
 
-      DisplayScan::startDisplay(); // start engine, whatever the previous state
+    DisplayScan::startDisplay(); // start engine, whatever the previous state
 
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // c) : SQUARE, NO PARAMETERS [500 ADC units side, centered, 10 points/side]
-  else if (_cmdString == SQUARE_TEST)
+// c) : SQUARE, NO PARAMETERS [500 ADC units side, centered, 10 points/side]
+static bool cmdSquareTest(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      Graphics::clearScene();
-      Graphics::drawSquare(100, 50.0); //length of side, num points per side
+    //PRINTLN("> EXECUTING... ");
+    Graphics::clearScene();
+    Graphics::drawSquare(100, 50.0); //length of side, num points per side
 
-      // NOTE: the color attributes will be used by the renderer in the future.
-      // USE CURRENT PARAMETERS:
-      //Hardware::Lasers::setStatePowerRed(1000);
-      //Hardware::Lasers::setStateSwitchRed(true);
+    // NOTE: the color attributes will be used by the renderer in the future.
+    // USE CURRENT PARAMETERS:
+    //Hardware::Lasers::setStatePowerRed(1000);
+    //Hardware::Lasers::setStateSwitchRed(true);
 
-      Renderer2D::renderFigure();
+    Renderer2D::renderFigure();
 
-      DisplayScan::startDisplay();
+    DisplayScan::startDisplay();
 
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // d) : SQUARE + CIRCLE TEST
-  else if (_cmdString == COMPOSITE_TEST)
+// d) : SQUARE + CIRCLE TEST
+static bool cmdCompositeTest(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      float radius = 75;
-      Graphics::clearScene();
-      Graphics::drawSquare(2 * radius, 50.0);
-      Graphics::drawCircle(radius, 100.0);
-      Graphics::drawSquare(1.414 * radius, 50.0);
-      Graphics::drawLine(P2(-90, 0), 180, 0, 50.0);
-      Graphics::drawLine(P2(0, -90), 0, 180, 50.0);
-
-      // NOTE: the color attributes will be used by the renderer in the future.
-      // USE CURRENT PARAMETERS:
-      //Hardware::Lasers::setStatePowerRed(1000);
-      //Hardware::Lasers::setStateSwitchRed(true);
+    //PRINTLN("> EXECUTING... ");
+    float radius = 75;
+    Graphics::clearScene();
+    Graphics::drawSquare(2 * radius, 50.0);
+    Graphics::drawCircle(radius, 100.0);
+    Graphics::drawSquare(1.414 * radius, 50.0);
+    Graphics::drawLine(P2(-90, 0), 180, 0, 50.0);
+    Graphics::drawLine(P2(0, -90), 0, 180, 50.0);
 
-      Renderer2D::renderFigure();
+    // NOTE: the color attributes will be used by the renderer in the future.
+    // USE CURRENT PARAMETERS:
+    //Hardware::Lasers::setStatePowerRed(1000);
+    //Hardware::Lasers::setStateSwitchRed(true);
 
-      DisplayScan::startDisplay();
+    Renderer2D::renderFigure();
 
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    DisplayScan::startDisplay();
+
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // .........................................................................
-  // ... BUILD HERE WHAT YOU NEED
-  // .........................................................................
+// .........................................................................
+// ... BUILD HERE WHAT YOU NEED
+// .........................................................................
 
-  //==========================================================================
-  // G) ============  LOW LEVEL COMMANDS ===========================
-  //==========================================================================
+//==========================================================================
+// G) ============  LOW LEVEL COMMANDS ===========================
+//==========================================================================
 
-  else if (_cmdString == SET_DIGITAL_PIN)
-  { // Param:pin, state
-    if ((_numArgs == 2) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Gpio::setDigitalPin(argStack[0].toInt(), toBool(argStack[1]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdSetDigitalPin(uint8_t _numArgs, Token argStack[])
+{ // Param:pin, state
+  bool execFlag = false;
+  if ((_numArgs == 2) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Gpio::setDigitalPin(argStack[0].toInt(), toBool(argStack[1]));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // Wrappers for special pins (exposed in the D25 connector):
-  else if (_cmdString == SET_DIGITAL_A)
-  { // Param: state
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Gpio::setDigitalPinA(toBool(argStack[0]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+// Wrappers for special pins (exposed in the D25 connector):
+static bool cmdSetDigitalA(uint8_t _numArgs, Token argStack[])
+{ // Param: state
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Gpio::setDigitalPinA(toBool(argStack[0]));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SET_DIGITAL_B)
-  { // Param: state
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Gpio::setDigitalPinB(toBool(argStack[0]));
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdSetDigitalB(uint8_t _numArgs, Token argStack[])
+{ // Param: state
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Gpio::setDigitalPinB(toBool(argStack[0]));
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == READ_DIGITAL_A)
-  { // Param: none
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      bool val = Hardware::Gpio::readDigitalPinA();
-      execFlag = true;
-      PRINT("> ");
-      PRINTLN((val > 0 ? "1" : "0"));
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdReadDigitalA(uint8_t _numArgs, Token argStack[])
+{ // Param: none
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    //PRINTLN("> EXECUTING... ");
+    bool val = Hardware::Gpio::readDigitalPinA();
+    execFlag = true;
+    PRINT("> ");
+    PRINTLN((val > 0 ? "1" : "0"));
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdReadDigitalB(uint8_t _numArgs, Token argStack[])
+{ // Param: none
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    //PRINTLN("> EXECUTING... ");
+    bool val = Hardware::Gpio::readDigitalPinB();
+    execFlag = true;
+    PRINT("> ");
+    PRINTLN((val > 0 ? "1" : "0"));
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdSetAnalogA(uint8_t _numArgs, Token argStack[])
+{ // Param: duty cycle (0-4095)
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Gpio::setAnalogPinA(argStack[0].toInt());
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdSetAnalogB(uint8_t _numArgs, Token argStack[])
+{ // Param: duty cycle (0-4095)
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Gpio::setAnalogPinB(argStack[0].toInt());
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdReadAnalogA(uint8_t _numArgs, Token argStack[])
+{ // Param: none
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    //PRINTLN("> EXECUTING... ");
+    uint16_t val = Hardware::Gpio::readAnalogPinA();
+    execFlag = true;
+    PRINT("> ");
+    PRINTLN(val);
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdReadAnalogB(uint8_t _numArgs, Token argStack[])
+{ // Param: none
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    //PRINTLN("> EXECUTING... ");
+    uint16_t val = Hardware::Gpio::readAnalogPinB();
+    execFlag = true;
+    PRINT("> ");
+    PRINTLN(val);
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdResetBoard(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    //PRINTLN("> EXECUTING... ");
+    delay(500);
+    Hardware::resetBoard();
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdTestMirrorsRange(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    // * NOTE 1 : the test figure replaces the current display buffer for the given time; the
+    //            current figure (and the display engine running state) is restored afterwards.
+    // * NOTE 2 : the laser state is pushed by the test and popped when it ends.
+    Hardware::Scanner::testMirrorRange(argStack[0].toInt());
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdTestCircleRange(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Scanner::testCircleRange(argStack[0].toInt());
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdTestCrossRange(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+
+  if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+  {
+    //PRINTLN("> EXECUTING... ");
+    Hardware::Scanner::testCrossRange(argStack[0].toInt());
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == READ_DIGITAL_B)
-  { // Param: none
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      bool val = Hardware::Gpio::readDigitalPinB();
-      execFlag = true;
-      PRINT("> ");
-      PRINTLN((val > 0 ? "1" : "0"));
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdStopTest(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    Hardware::stopTests();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+// 8) ADVANCED COMMANDS **************************************************************************************
 
-  else if (_cmdString == SET_ANALOG_A)
-  { // Param: duty cycle (0-4095)
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+static bool cmdLoadScript(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 1)
+  {
+    //PRINTLN("  Reading file '" + nameFile + "'");
+    // NOTE: read directly into the script in memory (no temporary copy of the file)
+    bool loaded = loadScriptFile(argStack[0].c_str(), scriptStringInMemory);
+    invalidateMemoryScript();
+    if (!loaded)
     {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Gpio::setAnalogPinA(argStack[0].toInt());
-      execFlag = true;
+      PRINTLN("> LOAD ERROR ");
     }
     else
-      PRINTLN("> BAD PARAMETERS");
-  }
-
-  else if (_cmdString == SET_ANALOG_B)
-  { // Param: duty cycle (0-4095)
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
     {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Gpio::setAnalogPinB(argStack[0].toInt());
+      PRINTLN("------------ SCRIPT LOADED IN MEM :");
+      PRINT(scriptStringInMemory);
       execFlag = true;
+      PRINTLN("-----------------------------------");
     }
-    else
-      PRINTLN("> BAD PARAMETERS");
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == READ_ANALOG_A)
-  { // Param: none
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      uint16_t val = Hardware::Gpio::readAnalogPinA();
-      execFlag = true;
-      PRINT("> ");
-      PRINTLN(val);
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdExecuteScript(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  // NOTE: A bad parsing or command error will produce and execution error INSIDE the script, but
+  // it does not mean the EXECUTE_SCRIPT command was a failure.
+  // We have therefore two options: signal that there was an error in the script (this can only
+  // happen if the scrupt was loaded from an SD card and created on a PC), or just through "OK". The first is
+  // better - otherwise we will ALWAYS throw "OK"... But we can signal this with a proper message (done
+  // by stepScript() when the script ends).
+  // Errors detected when compiling the script (unknown command...) prevent its execution.
+  if (_numArgs == 0)
+  {
+    PRINTLN("-- EXECUTING CODE IN MEM");
+    execFlag = startScript();
   }
+  else if (_numArgs == 1)
+  {
+    PRINTLN("-- EXECUTING : " + String(argStack[0].c_str()));
+    execFlag = startScript(argStack[0].c_str());
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == READ_ANALOG_B)
-  { // Param: none
-    if (_numArgs == 0)
-    {
-      //PRINTLN("> EXECUTING... ");
-      uint16_t val = Hardware::Gpio::readAnalogPinB();
-      execFlag = true;
-      PRINT("> ");
-      PRINTLN(val);
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdStopScript(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    stopScript();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == RESET_BOARD)
+static bool cmdCallScript(uint8_t _numArgs, Token argStack[])
+{ // Param: {name, parameters...}
+  bool execFlag = false;
+  if ((_numArgs >= 1) && (_numArgs <= MAX_SCRIPT_PARAMS + 1))
   {
-    if (_numArgs == 0)
+    uint16_t lengthParams = 0;
+    for (uint8_t k = 1; k < _numArgs; k++)
+      lengthParams += argStack[k].length() + 1;
+    if (lengthParams > SIZE_PARAM_TEXT)
+      PRINTLN("> PARAMETERS TOO LONG");
+    else
     {
-      //PRINTLN("> EXECUTING... ");
-      delay(500);
-      Hardware::resetBoard();
+      ScriptFrame *ptrFrame = pushScript(argStack[0].c_str());
+      if (ptrFrame != NULL)
+      {
+        // NOTE: the parameters are copied, since they may be variables changed by the script itself
+        char *ptrText = ptrFrame->paramText;
+        for (uint8_t k = 1; k < _numArgs; k++)
+        {
+          memcpy(ptrText, argStack[k].c_str(), argStack[k].length());
+          ptrText[argStack[k].length()] = '\0';
+          ptrFrame->params[k - 1].set(ptrText, argStack[k].length());
+          ptrText += argStack[k].length() + 1;
+        }
+        ptrFrame->numParams = _numArgs - 1;
+        execFlag = true;
+      }
     }
-    else
-      PRINTLN("> BAD PARAMETERS");
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == TEST_MIRRORS_RANGE)
+// Script flow commands sent directly are only accepted to record them (BEGIN_PRM):
+static bool outOfScript()
+{
+  if (recordingScript)
   {
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
-    {
-      //PRINTLN("> EXECUTING... ");
-      // ...
-
-      // * NOTE 1 : testMirrorRange() will stop the display engine, but put it again
-      //            if it was working. A the LIFO stack for ISR state could come handy...
-      // * NOTE 2 : power and switch of lasers is modified. Again, a stack for laser
-      //            attributes would be great.
-
-      Hardware::Lasers::pushState();
-
-      Hardware::Scanner::testMirrorRange(argStack[0].toInt());
-
-      Hardware::Lasers::popState();
-
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    PRINTLN("> RECORDED ONLY");
+    return (true);
   }
+  PRINTLN("> ONLY IN SCRIPTS");
+  return (false);
+}
 
-  else if (_cmdString == TEST_CIRCLE_RANGE)
+static bool cmdWait(uint8_t _numArgs, Token argStack[])
+{ // Param: {time in us}. The script resumes after that time, without blocking anything else.
+  bool execFlag = false;
+  if (currentFrame == NULL)
+    execFlag = outOfScript();
+  else if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
   {
+    currentFrame->waitTime = argStack[0].toInt();
+    currentFrame->waitTimer = 0;
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+static bool cmdLoop(uint8_t _numArgs, Token argStack[])
+{ // Param: {number of iterations}. Repeats the commands until the matching END_LOOP.
+  bool execFlag = false;
+  if (currentFrame == NULL)
+    execFlag = outOfScript();
+  else if ((_numArgs == 1) && Utils::isNumber(argStack[0]) && (argStack[0].toInt() >= 0))
+  {
+    ScriptFrame &frame = *currentFrame;
+    uint32_t iterations = argStack[0].toInt();
+    if (iterations == 0)
+    {
+      // Skip the body (the loops are balanced: checked at compilation):
+      uint8_t depth = 1;
+      const Instruction *ptrInstruction;
+      while (depth && ((ptrInstruction = nextInstruction(frame)) != NULL))
+      {
+        CommandHandler handler = commandTable[ptrInstruction->command].handler;
+        if (handler == cmdLoop)
+          depth++;
+        else if (handler == cmdEndLoop)
+          depth--;
+      }
+      execFlag = (depth == 0);
+    }
+    else if (frame.loopDepth == SIZE_LOOP_STACK)
+      PRINTLN("> TOO MANY NESTED LOOPS");
+    else
     {
-      //PRINTLN("> EXECUTING... ");
-      Hardware::Lasers::pushState();
-
-      Hardware::Lasers::setStatePowerAll(1000);
-      Hardware::Lasers::setStateSwitchAll(true);
-      Hardware::Scanner::testCircleRange(argStack[0].toInt());
-
-      Hardware::Lasers::popState();
-
+      LoopFrame &loop = frame.loopStack[frame.loopDepth++];
+      loop.startWindow = frame.bytecode->windowStart;
+      loop.startPc = frame.pc; // (the program counter is already on the next instruction)
+      loop.remaining = iterations;
       execFlag = true;
     }
-    else
-      PRINTLN("> BAD PARAMETERS");
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == TEST_CROSS_RANGE)
+static bool cmdEndLoop(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (currentFrame == NULL)
+    execFlag = outOfScript();
+  else if (currentFrame->loopDepth == 0)
+    PRINTLN("> END_LOOP WITHOUT LOOP"); // (only when the LOOP failed)
+  else
   {
-
-    if ((_numArgs == 1) && Utils::isNumber(argStack[0]))
+    LoopFrame &loop = currentFrame->loopStack[currentFrame->loopDepth - 1];
+    execFlag = true;
+    if (--loop.remaining)
     {
-      //PRINTLN("> EXECUTING... ");
-
-      Hardware::Lasers::pushState();
-
-      Hardware::Lasers::setStatePowerAll(1000);
-      Hardware::Lasers::setStateSwitchAll(true);
-      Hardware::Scanner::testCrossRange(argStack[0].toInt());
-
-      Hardware::Lasers::popState();
-
-      execFlag = true;
+      execFlag = loadWindow(*currentFrame->bytecode, loop.startWindow);
+      currentFrame->pc = loop.startPc;
     }
     else
-      PRINTLN("> BAD PARAMETERS");
+      currentFrame->loopDepth--;
   }
+  return (execFlag);
+}
 
-  // 8) ADVANCED COMMANDS **************************************************************************************
+// Variable name: one letter (the $ is only used to read the variable):
+static int8_t toVariableIndex(const Token &_str)
+{
+  if ((_str.length() == 1) && (_str[0] >= 'a') && (_str[0] <= 'z'))
+    return (_str[0] - 'a');
+  return (-1);
+}
 
-  else if (_cmdString == LOAD_SCRIPT)
-  {
-    if (_numArgs == 1)
-    {
-      String nameFile = argStack[0];
+static bool isSignedNumber(const Token &_str)
+{
+  return (Utils::isNumber(_str) || ((_str[0] == '-') && Utils::isDigit(_str[1])));
+}
 
-      //PRINTLN("  Reading file '" + nameFile + "'");
-      String msgString = readScript(nameFile);
-      if (msgString == "error")
-      {
-        PRINTLN("> LOAD ERROR ");
-      }
-      else
-      {
-        PRINTLN("------------ SCRIPT LOADED IN MEM :");
-        PRINT(msgString);
-        scriptStringInMemory = msgString;
-        execFlag = true;
-        PRINTLN("-----------------------------------");
-      }
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+static bool cmdSetVariable(uint8_t _numArgs, Token argStack[])
+{ // Param: {name, value}
+  bool execFlag = false;
+  int8_t index;
+  if ((_numArgs == 2) && ((index = toVariableIndex(argStack[0])) >= 0) && (argStack[1].length() < SIZE_SCRIPT_VARIABLE))
+  {
+    // NOTE: memmove, the value may be the variable itself (ex: "a,$a,VAR")
+    memmove(variables[index], argStack[1].c_str(), argStack[1].length());
+    variables[index][argStack[1].length()] = '\0';
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == EXECUTE_SCRIPT)
+static bool cmdAddVariable(uint8_t _numArgs, Token argStack[])
+{ // Param: {name, value}. Adds the value to the (numeric) variable.
+  bool execFlag = false;
+  int8_t index;
+  if ((_numArgs == 2) && ((index = toVariableIndex(argStack[0])) >= 0) && isSignedNumber(argStack[1]))
   {
-    if (_numArgs == 0)
-    {
-      PRINTLN("------------- CURRENT CODE IN MEM :");
-      PRINT(scriptStringInMemory); // MUST end with END_CMD (which is end of line too...)
-      PRINTLN("-----------------------------------");
-      PRINTLN("-- EXECUTING : ");
-      // NOTE: A bad parsing or command error will produce and execution error INSIDE the script, but
-      // it does not mean the EXECUTE_SCRIPT command was a failure.
-      // We have therefore two options: signal that there was an error in the script (this can only
-      // happen if the scrupt was loaded from an SD card and created on a PC), or just through "OK". The first is
-      // better - otherwise we will ALWAYS throw "OK"... But we can signal this with a proper message.
-      execFlag = parseStringMessage(scriptStringInMemory);
-      if (execFlag)
-        PRINTLN("----------- END FAULTLESS EXECUTION");
-      else
-        PRINTLN("------------------- END WITH ERRORS");
-    }
-    else if (_numArgs == 1)
+    Token current(variables[index], strlen(variables[index]));
+    if (!isSignedNumber(current))
+      PRINTLN("> NOT A NUMBER: " + String(variables[index]));
+    else
     {
-      String scriptString = readScript(argStack[0]);
-      if (scriptString == "error")
-        PRINTLN("> LOAD ERROR ");
+      // Integer arithmetic unless one of the values is a float:
+      String result;
+      if (strpbrk(current.c_str(), ".e") || strpbrk(argStack[1].c_str(), ".e"))
+        result = String(current.toFloat() + argStack[1].toFloat(), 4);
       else
-      {
-        PRINTLN("--- SCRIPT LOADED IN MEM TO EXECUTE:");
-        PRINT(scriptString); // MUST end with END_CMD (which is end of line too...)
-        PRINTLN("-----------------------------------");
-        PRINTLN("-- EXECUTING : ");
-        ;
-        // NOTE: A bad parsing or command error will also produce and execution flag error.
-        execFlag = parseStringMessage(scriptString);
-        if (execFlag)
-          PRINTLN("----------- END FAULTLESS EXECUTION");
-        else
-          PRINTLN("------------------- END WITH ERRORS");
-      }
+        result = String(current.toInt() + argStack[1].toInt());
+      strncpy(variables[index], result.c_str(), SIZE_SCRIPT_VARIABLE - 1);
+      variables[index][SIZE_SCRIPT_VARIABLE - 1] = '\0';
+      execFlag = true;
     }
-    else
-      PRINTLN("> BAD PARAMETERS");
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //#define START_SCRIPT "BEGIN_SCRIPT"
-  else if (_cmdString == START_REC_SCRIPT)
+//#define START_SCRIPT "BEGIN_SCRIPT"
+static bool cmdStartRecScript(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      beginRecordingScript();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    beginRecordingScript();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //#define END_SCRIPT "END_SCRIPT"
-  else if (_cmdString == END_REC_SCRIPT)
+//#define END_SCRIPT "END_SCRIPT"
+static bool cmdEndRecScript(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      endRecordingScript();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    endRecordingScript();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // add more commands to the recorded script
-  else if (_cmdString == ADD_REC_SCRIPT)
+// add more commands to the recorded script
+static bool cmdAddRecScript(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 0)
-    {
-      addRecordingScript();
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    addRecordingScript();
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //#define SAVE_SCRIPT "SAVE_SCRIPT"
-  else if (_cmdString == SAVE_SCRIPT)
+//#define SAVE_SCRIPT "SAVE_SCRIPT"
+static bool cmdSaveScript(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+   #ifdef USING_SD_CARD
+  if (_numArgs == 1)
   {
-     #ifdef USING_SD_CARD
-    if (_numArgs == 1)
-    {
-      execFlag = saveScript(argStack[0]);
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
-    #else
-    PRINTLN("> NO SD CARD INITIALIZED");
-#endif
+    execFlag = saveScript(argStack[0].c_str());
+    invalidateFileScript(argStack[0].c_str());
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  #else
+  PRINTLN("> NO SD CARD INITIALIZED");
+#endif
+  return (execFlag);
+}
 
-  else if (_cmdString == LIST_SD_PRM)
+static bool cmdListSdPrm(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+   #ifdef USING_SD_CARD
+  if (_numArgs == 0)
   {
-     #ifdef USING_SD_CARD
-    if (_numArgs == 0)
-    {
-      File root;
-      root = SD.open("/");
-      Hardware::SDCard::printDirectory(root, 0);
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
-    #else
-    PRINTLN("> NO SD CARD INITIALIZED");
+    File root;
+    root = SD.open("/");
+    Hardware::SDCard::printDirectory(root, 0);
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  #else
+  PRINTLN("> NO SD CARD INITIALIZED");
 #endif
+  return (execFlag);
+}
+
+static bool cmdShowMemPrm(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    PRINTLN("-- CURRENT SCRIPT CODE IN MEMORY :");
+    PRINTLN("---------------------------------- ");
+    PRINT(scriptStringInMemory);
+    PRINTLN("---------------------------------- ");
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  else if (_cmdString == SHOW_MEM_PRM)
+//10) DEBUG COMMANDS  ****************************************************************************************
+// #define VERBOSE_MODE "VERBOSE"
+static bool cmdVerboseMode(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 1)
   {
-    if (_numArgs == 0)
-    {
-      PRINTLN("-- CURRENT SCRIPT CODE IN MEMORY :");
-      PRINTLN("---------------------------------- ");
-      PRINT(scriptStringInMemory);
-      PRINTLN("---------------------------------- ");
-      execFlag = true;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    Utils::setVerboseMode(toBool(argStack[0]));
+    execFlag = true;
+  }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+static bool cmdSetAckMode(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 1)
+  {
+    Com::setAckMode(toBool(argStack[0]) > 0);
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  //10) DEBUG COMMANDS  ****************************************************************************************
-  // #define VERBOSE_MODE "VERBOSE"
-  else if (_cmdString == VERBOSE_MODE)
+static bool cmdGetTime(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
   {
-    if (_numArgs == 1)
-    {
-      Utils::setVerboseMode(toBool(argStack[0]));
-      execFlag = false;
-    }
-    else
-      PRINTLN("> BAD PARAMETERS");
+    PRINTLN("> TIME: " + String(micros()) + " us, SCHEDULED: " + String(Com::getNumScheduled()) +
+            ", MAX LATENESS: " + String(Com::getMaxLateness()) + " us");
+    execFlag = true;
   }
+  else
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
 
-  // ***********************************************************************************************************
-  // END) Catches if there is no command that matches the query ************************************************
+static bool cmdClearSchedule(uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+  if (_numArgs == 0)
+  {
+    Com::clearSchedule();
+    execFlag = true;
+  }
   else
-  { // unkown command or bad parameters ==> bad command (in the future, use a CmdDictionnay)
+    PRINTLN("> BAD PARAMETERS");
+  return (execFlag);
+}
+
+// =============================================================================
+// ========== COMMAND TABLE ====================================================
+// * NOTE 1 : the order of the entries is irrelevant; the table is sorted by name
+//            once in init(), and then searched with a binary search (a few string
+//            comparisons instead of going through the whole list of commands).
+// * NOTE 2 : the number of arguments is checked before calling the handler, but
+//            handlers still check it when they accept several forms.
+Command commandTable[] = {
+    {REPEAT_COMMAND, cmdRepeatCommand, 0, 0},
+    {SET_POWER_LASER_ALL, cmdSetPowerLaserAll, 1, 1},
+    {SET_POWER_LASER, cmdSetPowerLaser, 2, 2},
+    {SET_SWITCH_LASER_ALL, cmdSetSwitchLaserAll, 1, 1},
+    {SET_SWITCH_LASER, cmdSetSwitchLaser, 2, 2},
+    {SET_CARRIER_ALL, cmdSetCarrierAll, 1, 1},
+    {SET_CARRIER, cmdSetCarrier, 2, 2},
+    {GET_SHUTTER_LOCK, cmdGetShutterLock, 0, 0},
+    {TEST_LASERS, cmdTestLasers, 0, 0},
+    {SET_CLOCK_PERIOD, cmdSetClockPeriod, 2, 2},
+    {START_CLOCK, cmdStartClock, 1, 1},
+    {STOP_CLOCK, cmdStopClock, 1, 1},
+    {SET_CLOCK_STATE, cmdSetClockState, 2, 2},
+    {SET_CLOCK_STATE_ALL, cmdSetClockStateAll, 1, 1},
+    {RST_CLOCK, cmdRstClock, 1, 1},
+    {RST_ALL_CLOCKS, cmdRstAllClocks, 0, 0},
+    {BIND_CLOCK_TIMER, cmdBindClockTimer, 2, 2},
+    {UNBIND_CLOCK_TIMER, cmdUnbindClockTimer, 1, 1},
+    {SET_TRIGGER_PROCESSOR, cmdSetTriggerProcessor, 5, 5},
+    {SET_PULSE_SHAPER, cmdSetPulseShaper, 3, 3},
+    {SET_LOGIC_GATE, cmdSetLogicGate, 2, 2},
+    {SET_WAVEFORM, cmdSetWaveform, 6, 6},
+    {SET_WAVEFORM_TABLE, cmdSetWaveformTable, 2, SIZE_WAVE_TABLE + 1},
+    {SET_WAVEFORM_OUTPUT, cmdSetWaveformOutput, 2, 2},
+    {SET_DELAY_LINE, cmdSetDelayLine, 2, 2},
+    {BIND_ONE_SHOT, cmdBindOneShot, 3, 3},
+    {UNBIND_ONE_SHOT, cmdUnbindOneShot, 2, 2},
+    {SET_SEQUENCER_STATE, cmdSetSequencerState, 1, 1},
+    {START_SEQUENCER, cmdStartSequencer, 0, 0},
+    {STOP_SEQUENCER, cmdStopSequencer, 0, 0},
+    {SET_TICK_SEQUENCER, cmdSetTickSequencer, 1, 1},
+    {SET_MODE_SEQUENCER, cmdSetModeSequencer, 1, 1},
+    {RESET_SEQUENCER, cmdResetSequencer, 0, 0},
+    {ADD_SEQUENCER_MODULE, cmdAddSequencerModule, 2, 2},
+    {SET_SEQUENCER_LINK, cmdSetSequencerLink, 4, 4},
+    {SET_SEQUENCER_CHAIN, cmdSetSequencerChain, 0, SIZE_CMD_STACK},
+    {CLEAR_SEQUENCER, cmdClearSequencer, 0, 0},
+    {DISPLAY_SEQUENCER_STATUS, cmdDisplaySequencerStatus, 0, 0},
+    {SET_RECORD_SEQUENCER, cmdSetRecordSequencer, 1, 1},
+    {DUMP_RECORD_SEQUENCER, cmdDumpRecordSequencer, 0, 0},
+    {SAVE_RECORD_SEQUENCER, cmdSaveRecordSequencer, 1, 1},
+    {SET_STATE_MODULE, cmdSetStateModule, 3, 3},
+    {SET_POWER_OPTOTUNER_ALL, cmdSetPowerOptotunerAll, 1, 1},
+    {SET_POWER_OPTOTUNER, cmdSetPowerOptotuner, 2, 2},
+    {START_DISPLAY, cmdStartDisplay, 0, 0},
+    {STOP_DISPLAY, cmdStopDisplay, 0, 0},
+    {SET_PERIOD_ISR_DISPLAY, cmdSetPeriodIsrDisplay, 1, 1},
+    {DISPLAY_STATUS, cmdDisplayStatus, 0, 0},
+    {RESET_POSE_GLOBAL, cmdResetPoseGlobal, 0, 0},
+    {SET_ANGLE_GLOBAL, cmdSetAngleGlobal, 1, 1},
+    {SET_CENTER_GLOBAL, cmdSetCenterGlobal, 2, 2},
+    {SET_SCALE_GLOBAL, cmdSetScaleGlobal, 1, 1},
+    {SET_COLOR_GLOBAL, cmdSetColorGlobal, 1, 1},
+    {CLEAR_SCENE, cmdClearScene, 0, 0},
+    {CLEAR_MODE, cmdClearMode, 1, 1},
+    {SET_BLANKING_ALL, cmdSetBlankingAll, 1, 1},
+    {SET_BLANKING, cmdSetBlanking, 2, 2},
+    {SET_INTER_POINT_BLANK, cmdSetInterPointBlank, 1, 1},
+    {SET_LASER_LEAD, cmdSetLaserLead, 3, 3},
+    {MAKE_POINT, cmdMakePoint, 2, 2},
+    {MAKE_TRAJECTORY, cmdMakeTrajectory, 0, SIZE_CMD_STACK},
+    {MAKE_LINE, cmdMakeLine, 3, 5},
+    {MAKE_CIRCLE, cmdMakeCircle, 2, 4},
+    {MAKE_RECTANGLE, cmdMakeRectangle, 4, 6},
+    {MAKE_SQUARE, cmdMakeSquare, 2, 4},
+    {MAKE_ZIGZAG, cmdMakeZigzag, 5, 7},
+    {MAKE_SPIRAL, cmdMakeSpiral, 4, 6},
+    {MAKE_RASTER, cmdMakeRaster, 9, 11},
+    {MAKE_RASTER_HZ, cmdMakeRasterHz, 9, 11},
+    {LINE_TEST, cmdLineTest, 0, 0},
+    {CIRCLE_TEST, cmdCircleTest, 0, 0},
+    {SQUARE_TEST, cmdSquareTest, 0, 0},
+    {COMPOSITE_TEST, cmdCompositeTest, 0, 0},
+    {SET_DIGITAL_PIN, cmdSetDigitalPin, 2, 2},
+    {SET_DIGITAL_A, cmdSetDigitalA, 1, 1},
+    {SET_DIGITAL_B, cmdSetDigitalB, 1, 1},
+    {READ_DIGITAL_A, cmdReadDigitalA, 0, 0},
+    {READ_DIGITAL_B, cmdReadDigitalB, 0, 0},
+    {SET_ANALOG_A, cmdSetAnalogA, 1, 1},
+    {SET_ANALOG_B, cmdSetAnalogB, 1, 1},
+    {READ_ANALOG_A, cmdReadAnalogA, 0, 0},
+    {READ_ANALOG_B, cmdReadAnalogB, 0, 0},
+    {RESET_BOARD, cmdResetBoard, 0, 0},
+    {TEST_MIRRORS_RANGE, cmdTestMirrorsRange, 1, 1},
+    {TEST_CIRCLE_RANGE, cmdTestCircleRange, 1, 1},
+    {TEST_CROSS_RANGE, cmdTestCrossRange, 1, 1},
+    {STOP_TEST, cmdStopTest, 0, 0},
+    {LOAD_SCRIPT, cmdLoadScript, 1, 1},
+    {EXECUTE_SCRIPT, cmdExecuteScript, 0, 1},
+    {STOP_SCRIPT, cmdStopScript, 0, 0},
+    {CALL_SCRIPT, cmdCallScript, 1, MAX_SCRIPT_PARAMS + 1},
+    {SCRIPT_WAIT, cmdWait, 1, 1},
+    {SCRIPT_LOOP, cmdLoop, 1, 1},
+    {SCRIPT_END_LOOP, cmdEndLoop, 0, 0},
+    {SET_VARIABLE, cmdSetVariable, 2, 2},
+    {ADD_VARIABLE, cmdAddVariable, 2, 2},
+    {START_REC_SCRIPT, cmdStartRecScript, 0, 0},
+    {END_REC_SCRIPT, cmdEndRecScript, 0, 0},
+    {ADD_REC_SCRIPT, cmdAddRecScript, 0, 0},
+    {SAVE_SCRIPT, cmdSaveScript, 1, 1},
+    {LIST_SD_PRM, cmdListSdPrm, 0, 0},
+    {SHOW_MEM_PRM, cmdShowMemPrm, 0, 0},
+    {VERBOSE_MODE, cmdVerboseMode, 1, 1},
+    {GET_TIME, cmdGetTime, 0, 0},
+    {CLEAR_SCHEDULE, cmdClearSchedule, 0, 0},
+    {SET_ACK_MODE, cmdSetAckMode, 1, 1}};
+const uint16_t numCommands = sizeof(commandTable) / sizeof(Command);
+
+void init()
+{
+  CommandLookup::sortByName(commandTable, numCommands, sizeof(Command));
+
+  for (uint8_t k = 0; k < NUM_SCRIPT_VARIABLES; k++)
+    strcpy(variables[k], "0");
+
+  // Two commands with the same name would make one of them unreachable:
+  int16_t duplicate = CommandLookup::findDuplicate(commandTable, numCommands, sizeof(Command));
+  if (duplicate >= 0)
+    PRINTLN("> DUPLICATED COMMAND: " + String(commandTable[duplicate].name));
+}
+
+int16_t findCommand(const char *_name)
+{
+  return (CommandLookup::findByName(_name, commandTable, numCommands, sizeof(Command)));
+}
+
+// =============================================================================
+// ========== COMMAND INTERPRETER ==============================================
+bool interpretCommand(const char *_cmdString, uint8_t _numArgs, Token argStack[])
+{
+  bool execFlag = false;
+
+  int16_t index = findCommand(_cmdString);
+  if (index < 0)
+  { // unkown command
     PRINTLN("> BAD COMMAND");
-    execFlag = false;
+    lastError = ERR_BAD_COMMAND;
+  }
+  else if ((_numArgs < commandTable[index].minArgs) || (_numArgs > commandTable[index].maxArgs))
+  {
+    PRINTLN("> BAD PARAMETERS");
+    lastError = ERR_BAD_PARAMETERS;
   }
+  else
+    execFlag = executeCommand(index, _numArgs, argStack);
 
   // Finally, return the execution flag (TODO: different codes, and a String explaining the error)
   return execFlag;
-} // end interpret Command
+}
+
+// NOTE: the number of arguments was already checked (by interpretCommand, or when compiling the script)
+static bool executeCommand(uint16_t _index, uint8_t _numArgs, Token argStack[])
+{
+  // Variables and parameters are replaced by their values in a copy of the arguments (only if there
+  // are any, so the usual case does not need the copy):
+  Token resolvedArgs[SIZE_CMD_STACK];
+  Token *args = argStack;
+  for (uint8_t k = 0; k < _numArgs; k++)
+  {
+    if (argStack[k][0] != VARIABLE_PREFIX)
+      continue;
+    if (args == argStack)
+    {
+      memcpy(resolvedArgs, argStack, _numArgs * sizeof(Token));
+      args = resolvedArgs;
+    }
+    if (!resolveArgument(argStack[k], resolvedArgs[k]))
+    {
+      lastError = ERR_BAD_PARAMETERS;
+      return (false);
+    }
+  }
+
+  bool execFlag = commandTable[_index].handler(_numArgs, args);
+  // NOTE: the handlers only return true/false (they print the reason themselves):
+  lastError = (execFlag ? ERR_NONE : ERR_EXECUTION);
+  return (execFlag);
+}
 
 } // namespace Parser
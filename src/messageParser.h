@@ -4,6 +4,7 @@
 
 #include "Definitions.h"
 #include "Utils.h"
+#include "Class_Token.h"
 #include "renderer2D.h"
 // I include the following or low level stuff (but perhaps better to use Utils wrappers in the future):
 #include "scannerDisplay.h"
@@ -18,6 +19,7 @@
 *******************************************************************************************************/
 // NOTE: The Enter key sends a CR character (carriage return, Ctrl+M, numerical value 13 = 0x0d = 015).
 #define ARG_SEPARATOR ','
+#define VARIABLE_PREFIX '$' // in the arguments, replaced by the value of a variable or a parameter
 #define END_CMD '\n'          // End command (CARRIAGE RETURN, ASCII 13). Without anything else,
                               // this could repeat the last GOOD command, but I won't do that.
 #define LINE_FEED_IGNORE '\r' // line feed (ASCII 10) . Ignored and continue parsing.
@@ -104,6 +106,8 @@
 #define SET_CLOCK_STATE_ALL   "SET_STATE_CLK_ALL"    // Param: {0/1}. Switch all clocks off/on
 #define RST_CLOCK             "RST_CLK"                     // Param: {clk_id}. Reset clock.
 #define RST_ALL_CLOCKS        "RST_CLK_ALL"            // No parameters.
+#define BIND_CLOCK_TIMER      "BIND_CLK"             // Param: {clk_id, pin}. Edges generated on the pin by a hardware timer
+#define UNBIND_CLOCK_TIMER    "UNBIND_CLK"           // Param: {clk_id}. Back to the software clock
 
 // TRIGGER PROCESSOR parameter configuration:
 // Param: {trg_id, mode trigger=[0,1,2], burst=[0...], skip=[0...], offset=[0...]}
@@ -113,10 +117,33 @@
 
 #define SET_PULSE_SHAPER "SET_PUL" // Param: {pul_id, time off (us), time on (us)}
 
+#define SET_LOGIC_GATE "SET_GATE" // Param: {gate_id, function=[and, or, xor, not] or [0,1,2,3]}
+
+// WAVEFORM parameter configuration (values in PWM units, 0-4095):
+#define SET_WAVEFORM "SET_WAVE"           // Param: {wave_id, shape=[ramp, tri, sin, table], period (us), min, max,
+                                          //         cycles (0 = continuous)}
+#define SET_WAVEFORM_TABLE "SET_WAVE_TAB" // Param: {wave_id, value 1, value 2... (up to 32 values, one period)}
+#define SET_WAVEFORM_OUTPUT "SET_WAVE_OUT" // Param: {wave_id, pin or "none"} (ex: 16 for PIN_ANALOG_A, 29 for the
+                                           // optotuner A)
+
+#define SET_DELAY_LINE "SET_DLY" // Param: {dly_id, delay (ns)}
+
+// HARDWARE EDGES: the pulsars and delay lines can output their edges exactly on the one shot pins (3 and 4,
+// Teensy 3.5/3.6 only). Edges derived from the input triggers are timed from the hardware timestamp of the
+// input edge; unbinding a module (or stopping, resetting or clearing the sequencer) cancels the pending edges.
+// A pulse longer than MAX_ONE_SHOT_US (~143s) has no hardware edges (they are counted as lost edges):
+#define BIND_ONE_SHOT "BIND_OS"     // Param: {module class code and index, channel [0,1]}
+#define UNBIND_ONE_SHOT "UNBIND_OS" // Param: {module class code and index}
+
 // SEQUENCER activation/deactivation:
 #define SET_SEQUENCER_STATE   "SET_STATE_SEQ" // Param: {0/1}. Deactivate/activate sequencer.
 #define START_SEQUENCER	      "START_SEQ"
 #define STOP_SEQUENCER	      "STOP_SEQ"
+#define SET_TICK_SEQUENCER    "SET_TICK_SEQ"      // Param: {tick in us (min 5)}. Period of the sequencer update (timer
+                                                  // interrupt). The overruns are shown by STATUS_SEQ.
+#define SET_MODE_SEQUENCER    "SET_MODE_SEQ"      // Param: {0/1}. 0 (default): each link adds one tick of delay.
+                                                  // 1: zero delay, the modules are evaluated in topological order
+                                                  // (cycles are broken with a one tick delay).
 #define RESET_SEQUENCER       "RST_SEQ"           // Param: none. This is not the same than switching on/off the sequencer;
                                             // instead, it will call the reset() method for all the modules (basically
                                             // restarting the clock, and resetting the trigger processors so the delay
@@ -144,6 +171,9 @@
 //                3 = las (laser)
 //                4 = pul (pulse shaper)
 //                5 = trg (trigger processor)
+//                7 = gate (logic gate)
+//                8 = wave (analog waveform)
+//                9 = dly (delay line)
 //
 // followed by the index of the module (for the external triggers, it is always 0, but in the future there may be more)
 
@@ -159,6 +189,12 @@
 //    0,1,5,3,SET_LNK_SEQ         <-- connects the clock (class 0) number 1 to the trigger processor (class 5) number 3
 //    5,3,3,2,SET_LNK_SEQ         <-- connects the trigger processor 3 to the laser (class 3) number 2
 //    1,SET_STATE_SEQ              <-- reactivate the sequencer
+// NOTE: a link to a logic gate ADDS an input to the gate. For example, the laser 2 fires only when the input trigger
+// AND the clock 1 are high:
+//    0,and,SET_GATE
+//    in,0,gate,0,SET_LNK_SEQ
+//    clk,1,gate,0,SET_LNK_SEQ
+//    gate,0,las,2,SET_LNK_SEQ
 
 // c) Create a chain of interconnected modules at once:
 // NOTE: it does NOT delecte whatever was before
@@ -177,6 +213,15 @@
 // e) Display sequencer pipeline status:
 #define DISPLAY_SEQUENCER_STATUS "STATUS_SEQ"
 
+// f) Event recorder: time, module and new output of each change of output in the pipeline. The recorded events
+// are removed when dumped or saved, and the record goes on while recording (512 events max between dumps):
+#define SET_RECORD_SEQUENCER  "REC_SEQ"      // Param: {0/1}. Start (clearing the previous record) / stop recording.
+#define DUMP_RECORD_SEQUENCER "DUMP_REC_SEQ" // Param: none. Text header "> EVENTS <number>,<bytes>,<lost>", then the
+                                             // events in binary (7 bytes, little endian): uint32 time in us, uint8
+                                             // class (1=clk, 2=in, 3=out, 4=las, 5=trg, 6=pul, 7=gate, 8=wave,
+                                             // 9=dly), uint8 module index in its class, uint8 output.
+#define SAVE_RECORD_SEQUENCER "SAVE_REC_SEQ" // Param: {file name}. Same binary events, in <file name>.bin (SD card).
+
 //************************************************************************************************************
 // 3) OPTOTUNERS *********************************************************************************************
 // Note: these outputs are not "chopped" by a fast switch, i.e., there is no "carrier-mode"):
@@ -218,7 +263,9 @@
 #define SET_ANGLE_GLOBAL "ANGLE"    // Param: {angle in degrees}. Rotate clockwise.
 #define SET_CENTER_GLOBAL "CENTER"  // Param: {x,y}. Center the figure around (x,y). Values are from -100 to 100
 #define SET_SCALE_GLOBAL "SCALE"    // Param: {scale=[0...]}. Scale the figure (note that 0 will make the figure a point)
-#define SET_COLOR_GLOBAL "COLOR"    // TODO
+#define SET_COLOR_GLOBAL "COLOR"    // Param: {laser mask [0-255], bit k = laser k}. Lasers used by the NEXT figures (the
+                                    // current scene keeps its colors). Use with CLMODE,0 to compose multi-laser scenes
+                                    // displayed in a single scan pass.
 
 //b) Scene clearing and blanking between objects (only useful when having many figures simultaneously)
 #define CLEAR_SCENE "CLEAR" // clear the blueprint, and also stop the display
@@ -231,6 +278,10 @@
 
 #define SET_INTER_POINT_BLANK "PTBLANK" // pt-to-pt blanking. ALWAYS affects all lasers for the time being.
 
+// Per-laser switching latency compensation (applied by the display engine on the per-point laser mask):
+#define SET_LASER_LEAD "LEAD_LASER" // Param: {laser_id, on lead (us), off lead (us)}. Positive values switch the laser
+                                    // earlier than the points where it should go on/off, negative values later.
+
 // c) Figure primitives:
 #define MAKE_POINT "POINT"
 #define MAKE_TRAJECTORY "TRAJECTORY"
@@ -241,6 +292,10 @@
 #define MAKE_SQUARE "SQUARE"  // Param: size of side,numpoints side,RECT ou X,Y,size-of-side,RECT
 #define MAKE_ZIGZAG "ZIGZAG"  // Param: width,height,numpoints X,numpoints Y,ZIGZAG or with position first
 #define MAKE_SPIRAL "SPIRAL"  // Param: length-between-arms, num-tours, numpoints, SPIRAL
+#define MAKE_RASTER "RASTER"  // Param: width,height,numpoints line,num lines,bidirectional [0/1],turn shape [0=step,1=arc],
+                              // numpoints turn,phase forward,phase backward (in points),RASTER or with position first
+#define MAKE_RASTER_HZ "RASTER_HZ" // Same as RASTER, but the third param is the line rate in Hz: the number of points
+                                   // per line is computed from the current inter-point time (DT).
 
 // d) TEST FIGURES:
 #define LINE_TEST "LITEST"
@@ -255,6 +310,8 @@
 #define TEST_MIRRORS_RANGE "SQRANGE" // {Time of show in seconds}. Displays a square showing the limits of galvos.
 #define TEST_CIRCLE_RANGE "CIRANGE"  // {Time of show in seconds}. Displays a circle with diameter 200 centered at (0,0)
 #define TEST_CROSS_RANGE "CRRANGE"   // {Time of show in seconds}. Displays a cross centered at (0,0)
+#define STOP_TEST "STOPTEST"         // no parameters. Cancels the running test (range tests or TSTLASERS).
+                                     // NOTE: the tests run in the background, and starting one cancels the previous.
 #define SET_DIGITAL_PIN "SETPIN"     // {pin number, state(true/false)}. Set the value of a digital pin.
 #define RESET_BOARD "RESET"          // RESET the board (note: this will disconnect the serial port!)
 
@@ -264,6 +321,20 @@
 #define EXECUTE_SCRIPT "EXE_PRM" // Param: if none, it will execute the current recorded script; otherwise
                                     //it takes an argument name (number or non-capital letters ok) and
                                     // will attempt to exectue the script "name".txt" in the file system (micro SD)
+                                    // NOTE: the script is executed in the background, one command at a time
+                                    // (a script can execute another script, up to SIZE_SCRIPT_STACK levels).
+#define STOP_SCRIPT "STOP_PRM"      // Stops the script(s) being executed.
+#define CALL_SCRIPT "CALL_PRM"      // Param: {name, up to 9 parameters}. Executes the script "name".txt, where the
+                                    // parameters replace $1, $2... (ex: 2000,red,led,CALL_PRM)
+
+// Script flow (only in scripts; they do not block anything: the script just waits its turn):
+#define SCRIPT_WAIT "WAIT"          // Param: {time in us}. Waits before executing the next command of the script.
+#define SCRIPT_LOOP "LOOP"          // Param: {number of iterations}. Repeats the commands up to the matching END_LOOP
+#define SCRIPT_END_LOOP "END_LOOP"  // (loops can be nested, up to SIZE_LOOP_STACK levels)
+
+// Variables $a to $z (text, initially "0"). Any argument can be "$a", or "$1" for the parameters of the script:
+#define SET_VARIABLE "VAR"          // Param: {name (one letter, without $), value}. Ex: p,2000,VAR then $p,PWLASERALL
+#define ADD_VARIABLE "ADD_VAR"      // Param: {name, number}. Adds the number to the variable (ex: ramps in loops)
 
 // RECORD SCRIPT being input from serial port:
 #define START_REC_SCRIPT "BEGIN_PRM"
@@ -280,6 +351,11 @@
 
 //10) DEBUG COMMANDS  ****************************************************************************************
 #define VERBOSE_MODE "VERBOSE"
+#define GET_TIME "TIME"               // Device time in us (base of the timestamped messages "@<time>:...", check dataCom.h)
+                                      // number of messages waiting for their time, and worst lateness of their execution.
+#define CLEAR_SCHEDULE "CLEAR_SCHED"  // Discards the timestamped messages not yet executed.
+#define SET_ACK_MODE "ACK" // {0/1}. Compact reply to every message ("!A" or "!N,<error code>"), check dataCom.h.
+                           // Messages with a sequence number ("#<seq>:...") are always acknowledged.
 
 /********************************************************************************************************
 *********************************************************************************************************
@@ -293,23 +369,82 @@
 namespace Parser
 {
 
-const uint8_t SIZE_CMD_STACK = 50; // Maximum size of the *command* stack (TODO: vector... )
+const uint8_t SIZE_CMD_STACK = 50;      // Maximum size of the *command* stack (TODO: vector... )
+const uint16_t SIZE_TOKEN_BUFFER = 512; // Maximum number of characters of a command and its arguments
+const uint16_t SIZE_ATOMIC_COMMAND = SIZE_TOKEN_BUFFER + 1; // ... with the separators and END_CMD
+
+// Command dictionnary: each command name is associated to its handler, and to the range
+// of accepted number of arguments (checked before calling the handler).
+// NOTE: the name must stay the first member (the table is sorted and searched by commandLookup.h):
+typedef bool (*CommandHandler)(uint8_t _numArgs, Token argStack[]);
+struct Command
+{
+  const char *name;
+  CommandHandler handler;
+  uint8_t minArgs, maxArgs;
+};
+
+extern Command commandTable[];
+extern const uint16_t numCommands;
+
+void init(); // sorts the command table: call it once before parsing any message
+int16_t findCommand(const char *_name); // index in the command table, or -1 if not found
+
+// Error code of the last parsed message (sent in the compact NACK replies, check dataCom.h).
+// NOTE: keep errorNames in sendScripts.py in the same order:
+enum ParserError
+{
+  ERR_NONE = 0,
+  ERR_BAD_PACKET,     // bad formed message
+  ERR_BAD_COMMAND,    // unknown command
+  ERR_BAD_PARAMETERS, // wrong number of arguments
+  ERR_EXECUTION,      // the command failed (bad parameter values...)
+  ERR_TOO_LONG,       // too many arguments or characters
+  ERR_QUEUE_FULL      // no room for a timestamped message
+};
+extern ParserError lastError;
 
 // messageParser.h is (for now) only included in main.cpp and SerialCommands.cpp, so we don't need to declare
 // the functions "extern".
+bool parseStringMessage(const char *_messageString);
 bool parseStringMessage(const String &_messageString);
-bool interpretCommand(String _cmdString, uint8_t _numArgs, String argStack[]);
+bool interpretCommand(const char *_cmdString, uint8_t _numArgs, Token argStack[]);
 
 void resetParser();
 void beginRecordingScript();
 void endRecordingScript();
 
+// Scripts are compiled once (when executed for the first time after being loaded, recorded or saved)
+// into instructions with pre-split arguments (kept as text), then executed command by command by stepScript()
+// (called from Com::update() within its time budget), so a long script does not stall loop().
+// A script that does not fit in a slot of the cache is compiled and executed by windows of that size (each
+// window is compiled again from the source when the execution gets there), so there is no limit on the length
+// of a script. RAM: about 4.9 KB per slot, 14.6 KB for the cache.
+const uint8_t SIZE_SCRIPT_STACK = 4;
+const uint8_t SIZE_SCRIPT_CACHE = 3;           // compiled scripts: the one in memory + the last ones from the SD card
+const uint8_t SIZE_SCRIPT_NAME = 13;           // file name without the extension (8.3 names)
+const uint16_t MAX_SCRIPT_INSTRUCTIONS = 128;  // commands per slot (window)
+const uint16_t MAX_SCRIPT_ARGS = 384;          // arguments of all these commands
+const uint16_t SIZE_SCRIPT_TEXT = 1024;        // characters of these arguments
+const uint16_t SD_BLOCK_SIZE = 512;            // script files are read/written by blocks (SD card sector size)
+const uint8_t SIZE_LOOP_STACK = 4;             // nested loops per script
+const uint8_t MAX_SCRIPT_PARAMS = 9;           // $1 to $9
+const uint8_t SIZE_PARAM_TEXT = 128;           // characters of all the parameters of a script call
+const uint8_t NUM_SCRIPT_VARIABLES = 26;       // $a to $z
+const uint8_t SIZE_SCRIPT_VARIABLE = 16;       // characters of a variable value (with the null)
+bool startScript(const char *_nameFile = NULL); // NULL: the script in memory
+bool isScriptRunning();
+bool stepScript(); // executes the next command of the running script (false if none, or waiting)
+void stopScript(); // stops all the running scripts
+
 // Kind of STL map... sadly, no implemenation of maps in STL arduino
 // These methods affect the red laser if no match (TODO: return -1 and check error)
-int8_t toBool(String _str);
-int8_t toClassID(String _str);
-int8_t toLaserID(String _str);
-int8_t toTrgMode(String _str);
+int8_t toBool(const Token &_str);
+int8_t toClassID(const Token &_str);
+int8_t toLaserID(const Token &_str);
+int8_t toTrgMode(const Token &_str);
+int8_t toGateFunction(const Token &_str);
+int8_t toWaveShape(const Token &_str);
 
 } // namespace Parser
 
@@ -0,0 +1,115 @@
+// Packed evaluation of the pure logic modules of the sequencer (logic gates and trigger processors) in the
+// compiled pipeline (check Hardware::Sequencer::compilePipeline): the outputs of all the nodes are the bits of
+// a single word, and these modules are small structs evaluated with a switch and mask operations, with no
+// virtual call and no pointer to the input modules. The other modules (clocks, input triggers, lasers,
+// pulsars...) touch pins, timers or time, and stay evaluated through their virtual methods.
+// NOTE: no Arduino dependency, so the evaluator can be checked and timed on the host (test/test_sequencer).
+#ifndef _PACKED_LOGIC_H_
+#define _PACKED_LOGIC_H_
+
+#include <stdint.h>
+
+namespace PackedLogic
+{
+    enum NodeType : uint8_t
+    {
+        NODE_MODULE = 0, // not packed: evaluated by the module (Module::update, Module::refreshStates)
+        NODE_AND,        // gates, in the order of Definitions::GateFunctions
+        NODE_OR,
+        NODE_XOR,
+        NODE_NOT,
+        NODE_TRG // trigger processor
+    };
+
+    // State of a trigger processor (same fields and meaning as in TriggerProcessor):
+    struct TrgState
+    {
+        uint8_t mode; // 0 = rise, 1 = fall, 2 = change (Definitions::trgModeNames)
+        bool input;   // input at the previous evaluation
+        bool skipping;
+        uint16_t burstLength, skipLength;
+        int32_t counterEvents; // negative during the offset
+    };
+
+    struct Node
+    {
+        uint8_t type;
+        uint32_t inMask; // nodes whose output is an input of this one (one node for a trigger processor)
+        TrgState trg;    // only for NODE_TRG
+    };
+
+    // Same as LogicGate::computeNextState: NOT is a NOR of the inputs, and AND without input is false:
+    inline bool evaluateGate(uint8_t _type, uint32_t _signals, uint32_t _inMask)
+    {
+        uint32_t in = _signals & _inMask;
+        switch (_type)
+        {
+        case NODE_AND:
+            return (_inMask && (in == _inMask));
+        case NODE_XOR:
+            return (__builtin_parity(in));
+        case NODE_NOT:
+            return (!in);
+        default: // NODE_OR
+            return (in != 0);
+        }
+    }
+
+    // Same as TriggerProcessor::computeNextState (burst, then skip, the offset being a negative count at start).
+    // Returns the "bang": true only at the evaluation of the event.
+    inline bool evaluateTrg(TrgState &_trg, bool _input)
+    {
+        bool event;
+        switch (_trg.mode)
+        {
+        case 0: // RISE
+            event = !_trg.input && _input;
+            break;
+        case 1: // FALL
+            event = _trg.input && !_input;
+            break;
+        case 2: // CHANGE
+            event = (_trg.input != _input);
+            break;
+        default:
+            event = false;
+            break;
+        }
+        _trg.input = _input;
+        if (!event)
+            return (false);
+
+        bool output = false;
+        if (!_trg.skipping)
+        {
+            if (_trg.counterEvents < _trg.burstLength)
+                output = true;
+            else
+            {
+                _trg.skipping = true;
+                _trg.counterEvents = 0;
+            }
+        }
+        if (_trg.skipping)
+        {
+            if (_trg.counterEvents >= _trg.skipLength)
+            {
+                _trg.skipping = false;
+                output = true;
+                _trg.counterEvents = 0;
+            }
+        }
+        _trg.counterEvents++;
+        return (output);
+    }
+
+    // Next output of a packed node (not NODE_MODULE), from the outputs of all the nodes:
+    inline bool evaluate(Node &_node, uint32_t _signals)
+    {
+        if (_node.type == NODE_TRG)
+            return (evaluateTrg(_node.trg, (_signals & _node.inMask) != 0));
+        return (evaluateGate(_node.type, _signals, _node.inMask));
+    }
+} // namespace PackedLogic
+
+#endif
@@ -8,14 +8,16 @@ namespace Renderer2D {
 P2 center(0,0);   // note (0,0) in "renderer" coordinates is the center of mirrors.
 float angle = 0;
 float scaleFactor = 1.0;
-bool colorRed = true;
+uint8_t laserMask = LASER_MASK_ALL; // by default, every laser follows its own switch state
 
 uint16_t sizeBlueprint = 0;   // this would not be necessary if using an STL container. It is
 // just the size of the current bluepring array, modified and set when drawing a figure (see
 // graphic primitives)
 
 P2 bluePrintArray[MAX_NUM_POINTS];  // PointBuffer bluePrintArray
+uint8_t bluePrintMaskArray[MAX_NUM_POINTS];
 P2 frameBuffer[MAX_NUM_POINTS];     // the rendered, clipped points (do a P2i).
+uint8_t frameMaskBuffer[MAX_NUM_POINTS];
 // NOTE: frameBuffer is an auxiliary LOCAL variable, we could write directly to the hidden display buffer,
 // but this way we may have further processing done
 
@@ -29,10 +31,20 @@ const P2 getLastPoint() {
 
 void addToBlueprint(const P2 &_newPoint) {
         // add point and increment index:
-        if (sizeBlueprint<MAX_NUM_POINTS) bluePrintArray[sizeBlueprint++] = _newPoint;
+        if (sizeBlueprint<MAX_NUM_POINTS) {
+                bluePrintMaskArray[sizeBlueprint] = laserMask;
+                bluePrintArray[sizeBlueprint++] = _newPoint;
+        }
         // otherwise do nothing
 }
 
+void addToBlueprint(const LP &_newLaserPoint) {
+        if (sizeBlueprint<MAX_NUM_POINTS) {
+                bluePrintMaskArray[sizeBlueprint] = _newLaserPoint.laserMask;
+                bluePrintArray[sizeBlueprint++] = _newLaserPoint.point;
+        }
+}
+
 // ======= RENDERING with CURRENT POSE TRANSFORMATION =====================================
 void renderFigure() {
         // * NOTE: this needs to be called when changing the figure or number of points,
@@ -40,12 +52,17 @@ void renderFigure() {
 
         // Draw the figure with proper translation, rotation and scale on the "hidden" buffer:
         uint16_t numframeBufferPoints = 0;
+
+        // The rotation is the same for all the points:
+        float sinAngle, cosAngle;
+        FastMath::sinCos(FastMath::DEG_TO_RAD_F * angle, sinAngle, cosAngle);
+
         for (uint16_t i = 0; i < sizeBlueprint; i++) {
                 P2 point(bluePrintArray[i]);
 
                 // 1) The true render: in order: resize, rotate and then translate (resize and rotate are commutative)
                 point.scale(scaleFactor); // equal to point = point*scaleFactor.
-                point.rotate(angle);
+                point.rotate(sinAngle, cosAngle);
                 point.translate(center);
 
                 // 2) The viewport transform [could be in another namespace/method]);
@@ -58,6 +75,7 @@ void renderFigure() {
                 // just NOT put them in the display buffer. I will use the second option here:
                 if ( !Hardware::Scanner::clipLimits(point) ) { // constrain to the galvo limits
                         frameBuffer[numframeBufferPoints] = point;
+                        frameMaskBuffer[numframeBufferPoints] = bluePrintMaskArray[i];
                         numframeBufferPoints++;
                 }
 
@@ -67,7 +85,7 @@ void renderFigure() {
         // * NOTE: the "frameBuffer" is the buffer of rendered, projected, viewported and clipped points,
         // and it is made of uint16_t points! (for the itme being, still floats, but use a TEMPLATE and a typedef...)
         // * NOTE 2 : this method will fill the current "hidden" buffer, and indicate the need to swap buffers:
-        DisplayScan::setDisplayBuffer(frameBuffer, numframeBufferPoints);
+        DisplayScan::setDisplayBuffer(frameBuffer, frameMaskBuffer, numframeBufferPoints);
 
         // ... and we are ready to start the display engine:
         // NOTE: this was not done automatically before, but it makes sense: we show a figure when ready, and IF we want to
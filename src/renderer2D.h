@@ -43,7 +43,7 @@ const float maxY = 100.0;
 extern P2 center;
 extern float angle;
 extern float scaleFactor;
-extern bool colorRed; // TODO: make a proper color object/struct (not just on/off for the red)
+extern uint8_t laserMask; // current "color": lasers enabled for the next added vertices (bit k = laser k)
 
 	// b) Number of points. In the future, it would be more interesting to have a
 	// "resolution" variable. The number of points should be always smaller
@@ -58,13 +58,15 @@ extern bool colorRed; // TODO: make a proper color object/struct (not just on/of
 
 	extern const P2 getLastPoint();
 
-	extern void addToBlueprint(const P2 &_newPoint);
+	extern void addToBlueprint(const P2 &_newPoint); // uses the current laserMask
+	extern void addToBlueprint(const LP &_newLaserPoint);
 
 	extern void renderFigure(); // render with current pose transformation
 
 	//namespace { // "private"
 		//extern PointBuffer bluePrintArray;
 		extern P2 bluePrintArray[MAX_NUM_POINTS];
+		extern uint8_t bluePrintMaskArray[MAX_NUM_POINTS]; // per-point laser mask
 	//}
 
 } // end namespace
@@ -7,7 +7,10 @@ namespace DisplayScan
 //PointBuffer displayBuffer1, displayBuffer2;
 P2 displayBuffer1[MAX_NUM_POINTS];
 P2 displayBuffer2[MAX_NUM_POINTS];
+uint8_t maskBuffer1[MAX_NUM_POINTS];
+uint8_t maskBuffer2[MAX_NUM_POINTS];
 volatile P2 *ptrCurrentDisplayBuffer, *ptrHiddenDisplayBuffer;
+volatile uint8_t *ptrCurrentMaskBuffer, *ptrHiddenMaskBuffer;
 uint16_t readingHead, newSizeBufferDisplay; // no need to be volatile
 volatile uint16_t sizeBufferDisplay;
 volatile bool needSwapFlag;
@@ -17,6 +20,10 @@ uint32_t dt;
 bool running, interpointBlanking;
 StateDisplayEngine stateDisplayEngine;
 
+int32_t laserOnLeadUs[NUM_LASERS], laserOffLeadUs[NUM_LASERS];
+volatile int16_t laserOnLeadPoints[NUM_LASERS], laserOffLeadPoints[NUM_LASERS];
+volatile bool leadCompensation = false;
+
 elapsedMicros delayMirrorsInterPointMicros, delayMirrorsInterFigureBlankingMicros;
 elapsedMicros delayInPoint;
 elapsedMicros delayLaserOnMicros, delayLaserOffMicros;
@@ -36,6 +43,7 @@ void init()
   {
     displayBuffer1[i] = P2(CENTER_MIRROR_ADX, CENTER_MIRROR_ADY);
     displayBuffer2[i] = P2(CENTER_MIRROR_ADX, CENTER_MIRROR_ADY);
+    maskBuffer1[i] = maskBuffer2[i] = LASER_MASK_ALL;
   }
 
   sizeBufferDisplay = newSizeBufferDisplay = 0;
@@ -43,6 +51,8 @@ void init()
   ptrCurrentDisplayBuffer = &(displayBuffer1[0]); // Note: displayBuffer1 is a const pointer to
   // the first element of the array displayBuffer1[].
   ptrHiddenDisplayBuffer = &(displayBuffer2[0]);
+  ptrCurrentMaskBuffer = &(maskBuffer1[0]);
+  ptrHiddenMaskBuffer = &(maskBuffer2[0]);
   readingHead = 0;
   needSwapFlag = false;
 
@@ -77,6 +87,39 @@ uint32_t getInterPointTime() { return (dt); }
 
 uint32_t getInterPointBlankingMode() { return (interpointBlanking); }
 
+// Convert the leads in us to points for the current dt (rounded to the nearest point):
+static void updateLeadPoints()
+{
+  bool compensation = false;
+  for (uint8_t k = 0; k < NUM_LASERS; k++)
+  {
+    int32_t onPoints = (laserOnLeadUs[k] + (laserOnLeadUs[k] >= 0 ? 1 : -1) * int32_t(dt / 2)) / int32_t(dt);
+    int32_t offPoints = (laserOffLeadUs[k] + (laserOffLeadUs[k] >= 0 ? 1 : -1) * int32_t(dt / 2)) / int32_t(dt);
+    onPoints = constrain(onPoints, -MAX_LASER_LEAD_POINTS, MAX_LASER_LEAD_POINTS);
+    offPoints = constrain(offPoints, -MAX_LASER_LEAD_POINTS, MAX_LASER_LEAD_POINTS);
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+      laserOnLeadPoints[k] = onPoints;
+      laserOffLeadPoints[k] = offPoints;
+    }
+    compensation |= (onPoints != 0) || (offPoints != 0);
+  }
+  leadCompensation = compensation;
+}
+
+void setLaserLead(uint8_t _laserIndex, int32_t _onLeadUs, int32_t _offLeadUs)
+{
+  if (_laserIndex < NUM_LASERS)
+  {
+    laserOnLeadUs[_laserIndex] = _onLeadUs;
+    laserOffLeadUs[_laserIndex] = _offLeadUs;
+    updateLeadPoints();
+  }
+}
+
+int32_t getLaserOnLead(uint8_t _laserIndex) { return (laserOnLeadUs[_laserIndex % NUM_LASERS]); }
+int32_t getLaserOffLead(uint8_t _laserIndex) { return (laserOffLeadUs[_laserIndex % NUM_LASERS]); }
+
 void resetWaitingTimers()
 {
   delayMirrorsInterPointMicros = 0;
@@ -141,6 +184,9 @@ void setInterPointTime(uint16_t _dt)
   // NOTE: there is a difference between "update" and "start",
   // check PJRC page. myTimer.update(microseconds);
   scannerTimer.update(dt);
+
+  // The per-laser leads are set in us, but applied in points:
+  updateLeadPoints();
 }
 
 void setInterPointBlankingMode(bool _mode)
@@ -154,7 +200,7 @@ void setInterPointBlankingMode(bool _mode)
     Hardware::Lasers::setToCurrentState();
 }
 
-void setDisplayBuffer(const P2 *_ptrFrameBuffer, uint16_t _size)
+void setDisplayBuffer(const P2 *_ptrFrameBuffer, const uint8_t *_ptrMasks, uint16_t _size)
 {
 
   // note: can I use memcpy with size(P2)?? probably yes and much faster... TP TRY!!
@@ -163,6 +209,7 @@ void setDisplayBuffer(const P2 *_ptrFrameBuffer, uint16_t _size)
   {
     ptrHiddenDisplayBuffer[k].x = _ptrFrameBuffer[k].x;
     ptrHiddenDisplayBuffer[k].y = _ptrFrameBuffer[k].y;
+    ptrHiddenMaskBuffer[k] = _ptrMasks[k];
   }
 
   needSwapFlag = true;
@@ -180,6 +227,44 @@ void setDisplayBuffer(const P2 *_ptrFrameBuffer, uint16_t _size)
   }
 }
 
+// Wraps an index (ex: the reading head plus a lead) into [0, sizeBufferDisplay), since the figure is displayed
+// in a loop. An empty buffer gives the index 0, like the reading head.
+// NOTE: a single modulo, since a lead can be much longer than a short figure:
+inline uint16_t wrapHead(int32_t _index)
+{
+  if (sizeBufferDisplay == 0)
+    return (0);
+  int32_t index = _index % (int32_t)sizeBufferDisplay;
+  return (index < 0 ? index + sizeBufferDisplay : index);
+}
+
+// Laser mask for the current point with the per-laser switching leads:
+// with a turn-on lead Lon and a turn-off lead Loff, a laser whose mask is on for points [a, b)
+// should be on for [a - Lon, b - Loff). This is the union of the mask shifted by Lon and by Loff
+// when Lon >= Loff, and their intersection otherwise.
+inline uint8_t getLeadMask(uint16_t _head)
+{
+  uint8_t mask = 0;
+  for (uint8_t k = 0; k < NUM_LASERS; k++)
+  {
+    bool onBit = (ptrCurrentMaskBuffer[wrapHead(int32_t(_head) + laserOnLeadPoints[k])] >> k) & 1;
+    bool offBit = (ptrCurrentMaskBuffer[wrapHead(int32_t(_head) + laserOffLeadPoints[k])] >> k) & 1;
+    bool bit = (laserOnLeadPoints[k] >= laserOffLeadPoints[k]) ? (onBit || offBit) : (onBit && offBit);
+    mask |= (bit << k);
+  }
+  return (mask);
+}
+
+// Lasers of the point under the reading head: the state of each laser combined with the per-point mask.
+// This only writes the pins whose value changes, so it is cheap when the mask is constant.
+inline void setPointLasers()
+{
+  if (leadCompensation)
+    Hardware::Lasers::setSwitchMask(getLeadMask(readingHead));
+  else
+    Hardware::Lasers::setSwitchMask(ptrCurrentMaskBuffer[readingHead]);
+}
+
 // =================================================================
 // =========== Mirror-psitioning ISR that is called every dt =======
 //==================================================================
@@ -215,6 +300,10 @@ void displayISR()
     ptrCurrentDisplayBuffer = ptrHiddenDisplayBuffer;
     ptrHiddenDisplayBuffer = ptrAux;
 
+    volatile uint8_t *ptrAuxMask = ptrCurrentMaskBuffer;
+    ptrCurrentMaskBuffer = ptrHiddenMaskBuffer;
+    ptrHiddenMaskBuffer = ptrAuxMask;
+
     needSwapFlag = false;
 
     // NOTE : not using the style stack here is better for several reasons,
@@ -243,7 +332,12 @@ void displayISR()
     //Hardware::Lasers::clearStateStack();
 
     //Hardware::Scanner::recenterPosRaw(); // recenter? no
-    Hardware::Lasers::setToCurrentState();
+    // NOTE: with a figure, the lasers masked on its first point are not switched on (not even during the
+    // inter-figure wait):
+    if (sizeBufferDisplay)
+      setPointLasers();
+    else
+      Hardware::Lasers::setToCurrentState();
 
     stateDisplayEngine = STATE_IDLE;
     //break; // proceed with the next case...
@@ -255,12 +349,8 @@ void displayISR()
       stateDisplayEngine = STATE_START_BLANKING;
       // Check and activate blanking if necessary:
       //Hardware::Lasers::pushState();
-      for (uint8_t k = 0; k < NUM_LASERS; k++)
-      {
-        // switch laser off if blankingMode set (regardless of the mode - carrier or continuous)
-        //if (Hardware::Lasers::laserArray[k].myState.blankingMode) Hardware::Lasers::laserArray[k].setSwitch(false);
-        Hardware::Lasers::laserArray[k].updateBlank(); // will only blank IF blanking mode true.
-      }
+      // switch laser off if blankingMode set (regardless of the mode - carrier or continuous)
+      Hardware::Lasers::updateBlankAll(); // will only blank IF blanking mode true.
     }
     // otherwise do nothing, but keep checking if the buffer gets filled with something.
   }
@@ -292,8 +382,8 @@ void displayISR()
     // End of mirror blanking waiting time: we are supposed to be in the right coordinates of first figure point: go directly to
     // laser on waiting state after setting the lasers ON (or whatever is needed)
     //Hardware::Lasers::popState(); // <-- IMPORTANT (do not forget or the stack will overflow).
-    Hardware::Lasers::setToCurrentState();
-    stateDisplayEngine = STATE_LASER_ON_WAITING;
+    // NOTE: back on through the mask of the point (restoring the whole state would flash the masked lasers):
+    setPointLasers();
   }
     // .. proceed!
 
@@ -320,16 +410,16 @@ void displayISR()
     if (delayMirrorsInterPointMicros < MIRROR_INTER_POINT_WAITING_TIME)
       break;
 #endif
-    // For the time being, color is not per-point, but uses the current state of the lasers which should
-    // not have changed during the whole figure. By the way, the lasers can be switched off at the end the
-    // normal point or not. If not [the default behaviour] the laser will be on during the jump to the next point.
-
-    // SWITCH ON lasers IF interpointBlanking was true (this is COMMON for all lasers):
-    // ATTN: interpointBlanking may have changed in the meantime, so that the laser will never
-    // go back to the "current state". One solution is to do this setting all the time (no condition),
-    // or call setToCurrentState() whenever we set interpointBlanking to false. I will use this last strategy.
-    if (interpointBlanking)
-      Hardware::Lasers::setToCurrentState(); //Hardware::Lasers::popState();
+    // Color is per-point (laser mask), combined with the current switch state of each laser. By the way, the
+    // lasers can be switched off at the end the normal point or not. If not [the default behaviour] the laser
+    // will be on during the jump to the next point.
+
+    // Per-point "color": switch off the lasers not used on this point (and back on those that are).
+    // NOTE: this is also what switches the lasers back on after an inter-point blanking (switchOffAll()
+    // does not change the laser state), in a single write per laser: restoring the whole state first
+    // would flash the masked lasers at each point.
+    setPointLasers();
+
     stateDisplayEngine = STATE_LASER_ON_WAITING;
     delayLaserOnMicros = 0;
   }
@@ -371,13 +461,9 @@ void displayISR()
     if (readingHead == 0)
     {
       // We WERE in the last point [TODO: this is not the right condition for a generic "end of figure"...]
-      for (uint8_t k = 0; k < NUM_LASERS; k++)
-      {
-        // Switch laser off if blankingMode set [regardless of the mode - carrier or continuous]
-        //if (Hardware::Lasers::laserArray[k].myState.blankingMode) Hardware::Lasers::laserArray[k].setSwitch(false);
-        Hardware::Lasers::laserArray[k].updateBlank(); // will only blank IF blanking mode true.
-        // NOTE: we don't do inter-point blanking here! this is "true" blanking (between figures)
-      }
+      // Switch laser off if blankingMode set [regardless of the mode - carrier or continuous]
+      // NOTE: we don't do inter-point blanking here! this is "true" blanking (between figures)
+      Hardware::Lasers::updateBlankAll(); // will only blank IF blanking mode true.
       stateDisplayEngine = STATE_START_BLANKING;
     }
     else
@@ -43,6 +43,9 @@
 
 //#define LASER_OFF_WAITING_TIME            0     // in microseconds - or assumed to be really fast anyway.
 #define LASER_ON_WAITING_TIME 0 // time waiting for correct laser power when reaching the current point position
+                                // NOTE: keep it at 0 and use the per-laser switching leads instead (setLaserLead),
+                                // so a slow laser does not force the dwell time of all the others.
+#define MAX_LASER_LEAD_POINTS 32        // the leads are clamped to +/- this number of points
 #define IN_NORMAL_POINT_WAIT 10 // 15 / Time it passes EXACTLY on the current point with lasers ON
 
 namespace DisplayScan
@@ -71,7 +74,7 @@ extern bool getRunningState();
 
 // The following corresponds in OpenGL to the sending of the "rendered" vertex array
 // to the framebuffer...
-extern void setDisplayBuffer(const P2 *ptrBlueprint, uint16_t _sizeBlueprint);
+extern void setDisplayBuffer(const P2 *ptrBlueprint, const uint8_t *ptrMasks, uint16_t _sizeBlueprint);
 
 extern uint16_t getBufferSize();
 
@@ -81,6 +84,14 @@ extern uint32_t getInterPointTime(); // {return(dt);}
 extern void setInterPointBlankingMode(bool _mode);
 extern uint32_t getInterPointBlankingMode(); // {return(interpointBlanking);}
 
+// Per-laser switching latency compensation. The display engine switches laser k ON _onLeadUs earlier
+// and OFF _offLeadUs earlier than the points where its mask changes (negative values switch later).
+// Values are given in microseconds and applied as a whole number of points, recomputed when the
+// inter-point time changes.
+extern void setLaserLead(uint8_t _laserIndex, int32_t _onLeadUs, int32_t _offLeadUs);
+extern int32_t getLaserOnLead(uint8_t _laserIndex);  // in us
+extern int32_t getLaserOffLead(uint8_t _laserIndex); // in us
+
 // * NOTE: Even if this is not a class, I can make variables or methods
 // "private" by using an anonymous namespace:
 //namespace {
@@ -98,10 +109,10 @@ extern P2 displayBuffer1[MAX_NUM_POINTS]; // displayBuffer1 is a const pointer
 extern P2 displayBuffer2[MAX_NUM_POINTS]; // or P2 displayBuffer1* and use
 // dynamic allocation with displayBuffer1 = new P2[MAX_NUM_POINTS]
 
-// TODO: make the display buffers from Laser POINTS (LP), containing P2i and also color (and detected intensity?)
-//struct LP { // a laser point (for now, using a float P2, but in the future let's use uint16_t)
-//P2 point;
-//}
+// Per-point laser masks ("color" of each point, bit k = laser k), swapped together with the point buffers.
+// NOTE: parallel arrays instead of LP arrays to save RAM (check Class_P2.h)
+extern uint8_t maskBuffer1[MAX_NUM_POINTS];
+extern uint8_t maskBuffer2[MAX_NUM_POINTS];
 
 // Note: variables cannot be inlined (<C++11)
 extern volatile bool needSwapFlag;
@@ -111,6 +122,7 @@ extern uint16_t readingHead;
 // The following variables must be qualified volatile, as they may be modificated
 // outside the section of code where they appear [because of the ISR]
 extern volatile P2 *ptrCurrentDisplayBuffer, *ptrHiddenDisplayBuffer;
+extern volatile uint8_t *ptrCurrentMaskBuffer, *ptrHiddenMaskBuffer;
 extern volatile uint16_t sizeBufferDisplay;
 extern volatile bool resizeFlag;
 
@@ -131,6 +143,9 @@ extern elapsedMicros delayInPoint;
 extern elapsedMicros delayLaserOnMicros, delayLaserOffMicros;
 extern bool running;
 extern bool interpointBlanking;
+extern int32_t laserOnLeadUs[NUM_LASERS], laserOffLeadUs[NUM_LASERS];
+extern volatile int16_t laserOnLeadPoints[NUM_LASERS], laserOffLeadPoints[NUM_LASERS];
+extern volatile bool leadCompensation; // false when all leads are zero (fast path in the ISR)
 extern StateDisplayEngine stateDisplayEngine;
 //    }
 
@@ -67,8 +67,11 @@ scriptArray = [script_0, script_1, script_2, script_3, script_4, script_5]
 def enterCommand():
     while True:
         try:
-            index = input("Please enter a number: ")
-            sendScript(scriptArray[int(index)])# + text)
+            index = input("Please enter a number (prefix with 'p' for pipelined mode): ")
+            if index.startswith('p'):
+                sendScriptPipelined(scriptArray[int(index[1:])])
+            else:
+                sendScript(scriptArray[int(index)])# + text)
         except ValueError:
             print("Not valid index for script_# ")
 
@@ -83,6 +86,47 @@ def sendScript(script):
         #     ser.write(val.encode('utf-8'))
         ser.write(b'\n') # include end command character because I did not write it on the script list.
 
+# Pipelined script sender: each command is sent with a sequence number ("#<seq>:<command>"), and the
+# controller answers "!A<seq>" (executed) or "!N<seq>,<error code>". Up to WINDOW_SIZE commands are
+# kept in flight, so the commands are streamed at link speed instead of one round-trip per command.
+WINDOW_SIZE = 8
+ACK_TIMEOUT = 2.0 # in seconds, without any reply
+# NOTE: in the order of Parser::ParserError (messageParser.h)
+errorNames = ["none", "bad formed packet", "bad command", "bad parameters", "execution failed", "too long", "queue full"]
+
+def sendScriptPipelined(script, windowSize = WINDOW_SIZE):
+    outstanding = {} # seq -> command
+    failed = []
+    seq = 0
+    ser.timeout = ACK_TIMEOUT
+    while seq < len(script) or outstanding:
+        # Fill the window:
+        while seq < len(script) and len(outstanding) < windowSize:
+            command = script[seq]
+            ser.write(("#" + str(seq) + ":" + command + "\n").encode('utf-8'))
+            outstanding[seq] = command
+            seq = seq + 1
+        # Wait for replies (other lines, like the verbose output, are just echoed):
+        line = ser.readline().decode('utf-8', errors = 'replace').strip()
+        if not line:
+            print("Timeout: no reply for " + str(sorted(outstanding)))
+            break
+        if line[0] != '!':
+            print(line)
+            continue
+        ok = (line[1] == 'A')
+        fields = line[2:].split(',')
+        if not fields[0].isdigit():
+            continue
+        ackSeq = int(fields[0])
+        command = outstanding.pop(ackSeq, None)
+        if not ok:
+            error = int(fields[1]) if len(fields) > 1 and fields[1].isdigit() else 0
+            failed.append(ackSeq)
+            print(str(ackSeq + 1) + "> " + str(command) + " : FAILED (" + (errorNames[error] if error < len(errorNames) else "error " + str(error)) + ")")
+    print("Sent " + str(seq) + " commands, " + str(len(failed)) + " failed")
+    ser.timeout = None
+
 # Check continuously for data received on serial port:
 def echoSerial():
     while True:
@@ -0,0 +1,103 @@
+// Host check of the command lookup (pio test -e native): every command is found in the sorted table, and the
+// lookups per second are compared with the previous dispatch, a chain of string comparisons in the order of
+// the command list.
+// NOTE: copy of the names of Parser::commandTable (the parser itself needs the Arduino core), in the order of
+// the table; keep it in step with messageParser.cpp. As for test_fastmath, the speed on the host is only
+// indicative.
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include "commandLookup.h"
+
+#define NUM_REPEATS 2000
+
+struct Command
+{
+    const char *name;
+    uint16_t listIndex; // position in the command list (check the lookup)
+};
+
+const char *commandNames[] = {
+    "REPEAT", "PWLASERALL", "PWLASER", "SWLASERALL", "SWLASER", "CARRIERALL", "CARRIER", "STATUS_SHUTTER",
+    "TSTLASERS", "SET_PERIOD_CLK", "START_CLK", "STOP_CLK", "SET_STATE_CLK", "SET_STATE_CLK_ALL", "RST_CLK",
+    "RST_CLK_ALL", "BIND_CLK", "UNBIND_CLK", "SET_TRG", "SET_PUL", "SET_GATE", "SET_WAVE", "SET_WAVE_TAB",
+    "SET_WAVE_OUT", "SET_DLY", "BIND_OS", "UNBIND_OS", "SET_STATE_SEQ", "START_SEQ", "STOP_SEQ",
+    "SET_TICK_SEQ", "SET_MODE_SEQ", "RST_SEQ", "ADD_SEQ_MODULE", "SET_LNK_SEQ", "SET_SEQ", "CLEAR_SEQ",
+    "STATUS_SEQ", "REC_SEQ", "DUMP_REC_SEQ", "SAVE_REC_SEQ", "SET_STATE", "PWOPTOALL", "PWOPTO", "START",
+    "STOP", "DT", "STATUS", "RSTPOSE", "ANGLE", "CENTER", "SCALE", "COLOR", "CLEAR", "CLMODE", "BLANKALL",
+    "BLANK", "PTBLANK", "LEAD_LASER", "POINT", "TRAJECTORY", "LINE", "CIRCLE", "RECT", "SQUARE", "ZIGZAG",
+    "SPIRAL", "RASTER", "RASTER_HZ", "LITEST", "CITEST", "SQTEST", "MIRE", "SETPIN", "WDIG_A", "WDIG_B",
+    "RDIG_A", "RDIG_B", "WANA_A", "WANA_B", "RANA_A", "RANA_B", "RESET", "SQRANGE", "CIRANGE", "CRRANGE",
+    "STOPTEST", "LOAD_PRM", "EXE_PRM", "STOP_PRM", "CALL_PRM", "WAIT", "LOOP", "END_LOOP", "VAR", "ADD_VAR",
+    "BEGIN_PRM", "END_PRM", "ADD_PRM", "SAVE_PRM", "LIST_SD_PRM", "SHOW_PRM", "VERBOSE", "TIME",
+    "CLEAR_SCHED", "ACK"
+};
+const uint16_t numCommands = sizeof(commandNames) / sizeof(commandNames[0]);
+
+Command commandTable[numCommands];
+
+volatile int32_t sink; // so the compiler does not remove the loops
+
+void setUp() {}
+void tearDown() {}
+
+// The previous dispatch: if (_cmdString == X) ... else if ...
+static int16_t findChain(const char *_name)
+{
+    for (uint16_t k = 0; k < numCommands; k++)
+        if (!strcmp(_name, commandNames[k]))
+            return (k);
+    return (-1);
+}
+
+static int16_t findSorted(const char *_name)
+{
+    int16_t index = CommandLookup::findByName(_name, commandTable, numCommands, sizeof(Command));
+    return (index < 0 ? -1 : commandTable[index].listIndex);
+}
+
+void test_lookup()
+{
+    TEST_ASSERT_EQUAL_INT16(-1, CommandLookup::findDuplicate(commandTable, numCommands, sizeof(Command)));
+    for (uint16_t k = 0; k < numCommands; k++)
+        TEST_ASSERT_EQUAL_INT16(k, findSorted(commandNames[k]));
+    TEST_ASSERT_EQUAL_INT16(-1, findSorted("NOT_A_COMMAND"));
+    TEST_ASSERT_EQUAL_INT16(-1, findSorted(""));
+    TEST_ASSERT_EQUAL_INT16(-1, findSorted("SET_PUL_")); // (prefix of no command, longer than one)
+}
+
+template <class Finder>
+static double lookupsPerSecond(Finder _find)
+{
+    auto start = std::chrono::steady_clock::now();
+    int32_t sum = 0;
+    for (uint16_t r = 0; r < NUM_REPEATS; r++)
+        for (uint16_t k = 0; k < numCommands; k++)
+            sum += _find(commandNames[k]);
+    sink = sum;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (NUM_REPEATS * numCommands / elapsed.count());
+}
+
+void test_speed()
+{
+    double rateChain = lookupsPerSecond(findChain);
+    double rateSorted = lookupsPerSecond(findSorted);
+    char message[100];
+    snprintf(message, sizeof(message), "%u commands: chain %.2f M lookups/s, sorted table %.2f M lookups/s (x%.1f)",
+             numCommands, rateChain / 1e6, rateSorted / 1e6, rateSorted / rateChain);
+    TEST_MESSAGE(message); // (reported, not asserted: the host timing is too noisy)
+}
+
+int main()
+{
+    for (uint16_t k = 0; k < numCommands; k++)
+        commandTable[k] = {commandNames[k], k};
+    CommandLookup::sortByName(commandTable, numCommands, sizeof(Command));
+
+    UNITY_BEGIN();
+    RUN_TEST(test_lookup);
+    RUN_TEST(test_speed);
+    return (UNITY_END());
+}
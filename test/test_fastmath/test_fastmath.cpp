@@ -0,0 +1,80 @@
+// Host check of FastMath against libm (pio test -e native): accuracy over several turns, and the time to
+// compute the points of a circle of MAX_NUM_POINTS points.
+// NOTE: the speed ratio on the host (double precision FPU, caches) is only indicative; on the Teensy the
+// difference is larger, since sinf/cosf are computed in software there.
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include "fastMath.h"
+
+#define NUM_POINTS 5000 // MAX_NUM_POINTS (Definitions.h)
+#define NUM_REPEATS 200
+
+// Theoretical bound of the linear interpolation (check fastMath.h), plus the float rounding:
+const float MAX_ERROR = 1.0e-5f;
+
+volatile float sink; // so the compiler does not remove the loops
+
+void setUp() {}
+void tearDown() {}
+
+void test_accuracy()
+{
+    float maxErrorSin = 0, maxErrorCos = 0;
+    for (int32_t k = -200000; k <= 200000; k++)
+    {
+        float phi = k * 1.0e-4f; // about +/- 3 turns
+        float s, c;
+        FastMath::sinCos(phi, s, c);
+        maxErrorSin = fmaxf(maxErrorSin, fabsf(s - sinf(phi)));
+        maxErrorCos = fmaxf(maxErrorCos, fabsf(c - cosf(phi)));
+        TEST_ASSERT_EQUAL_FLOAT(s, FastMath::sin(phi));
+        TEST_ASSERT_EQUAL_FLOAT(c, FastMath::cos(phi));
+    }
+    char message[80];
+    snprintf(message, sizeof(message), "max error: sin %.2e, cos %.2e", maxErrorSin, maxErrorCos);
+    TEST_MESSAGE(message);
+    TEST_ASSERT_LESS_THAN_FLOAT(MAX_ERROR, maxErrorSin);
+    TEST_ASSERT_LESS_THAN_FLOAT(MAX_ERROR, maxErrorCos);
+}
+
+template <class SinCos>
+static double timeCircle(SinCos _sinCos)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (uint16_t r = 0; r < NUM_REPEATS; r++)
+    {
+        float sum = 0;
+        for (uint16_t k = 0; k < NUM_POINTS; k++)
+        {
+            float s, c;
+            _sinCos(FastMath::TWO_PI_F * k / NUM_POINTS, s, c);
+            sum += s + c;
+        }
+        sink = sum;
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return (elapsed.count() / NUM_REPEATS);
+}
+
+void test_speed()
+{
+    double timeLibm = timeCircle([](float _phi, float &_s, float &_c) {
+        _s = sinf(_phi);
+        _c = cosf(_phi);
+    });
+    double timeTable = timeCircle([](float _phi, float &_s, float &_c) { FastMath::sinCos(_phi, _s, _c); });
+    char message[80];
+    snprintf(message, sizeof(message), "%d point circle: libm %.1f us, table %.1f us (x%.1f)",
+             NUM_POINTS, timeLibm, timeTable, timeLibm / timeTable);
+    TEST_MESSAGE(message); // (reported, not asserted: the host timing is too noisy)
+}
+
+int main()
+{
+    FastMath::init();
+    UNITY_BEGIN();
+    RUN_TEST(test_accuracy);
+    RUN_TEST(test_speed);
+    return (UNITY_END());
+}
@@ -0,0 +1,265 @@
+// Host check of the packed evaluation of the sequencer (pio test -e native): a pipeline of gates and trigger
+// processors fed by a few sources gives the same outputs at each tick with PackedLogic and with a model of the
+// virtual evaluation of the modules, and the node evaluations per second of both are compared.
+// NOTE: the model copies Module::update, LogicGate and TriggerProcessor (Class_Sequencer.h needs the Arduino
+// core); keep it in step with them. As for test_fastmath, the speed on the host is only indicative.
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include "packedLogic.h"
+
+#define NUM_NODES 32  // MAX_COMPILED_MODULES (hardware.h)
+#define NUM_SOURCES 4 // set at each tick, as the clocks or input triggers
+#define MAX_INPUTS 4  // MAX_GATE_INPUTS
+#define NUM_TICKS 200000
+
+// ******************** MODEL OF THE VIRTUAL EVALUATION ********************
+class ModelModule
+{
+  public:
+    virtual ~ModelModule() {}
+    virtual uint8_t getNumInputLinks() { return (ptr_fromModule != NULL ? 1 : 0); }
+    virtual ModelModule *getInputLink(uint8_t _index) { return (ptr_fromModule); }
+    virtual void update()
+    {
+        bool inputFrom = (ptr_fromModule != NULL ? ptr_fromModule->getOutputState() : false);
+        computeNextState(inputFrom);
+    }
+    virtual void computeNextState(bool _inputFrom) { nextOutput = _inputFrom; }
+    bool refreshStates()
+    {
+        bool changed = (output != nextOutput);
+        output = nextOutput;
+        input = nextInput;
+        return (changed);
+    }
+    bool getOutputState() { return (output); }
+
+    ModelModule *ptr_fromModule = NULL;
+
+  protected:
+    bool output = false, nextOutput = false;
+    bool input = false, nextInput = false;
+};
+
+class ModelSource : public ModelModule
+{
+  public:
+    void computeNextState(bool _inputFrom) override { nextOutput = level; }
+    bool level = false;
+};
+
+class ModelGate : public ModelModule
+{
+  public:
+    uint8_t getNumInputLinks() override { return (ptr_fromModule != NULL ? 1 + numExtraInputs : 0); }
+    ModelModule *getInputLink(uint8_t _index) override { return (_index ? ptr_extraInputs[_index - 1] : ptr_fromModule); }
+    void computeNextState(bool _inputFrom) override
+    {
+        bool val = (function == PackedLogic::NODE_AND) && (ptr_fromModule != NULL);
+        for (uint8_t k = 0; k < getNumInputLinks(); k++)
+        {
+            bool in = getInputLink(k)->getOutputState();
+            if (function == PackedLogic::NODE_AND)
+                val &= in;
+            else if (function == PackedLogic::NODE_XOR)
+                val ^= in;
+            else
+                val |= in;
+        }
+        nextOutput = (function == PackedLogic::NODE_NOT ? !val : val);
+    }
+
+    uint8_t function;
+    ModelModule *ptr_extraInputs[MAX_INPUTS - 1];
+    uint8_t numExtraInputs = 0;
+};
+
+class ModelTrg : public ModelModule
+{
+  public:
+    void computeNextState(bool _inputFrom) override
+    {
+        nextInput = _inputFrom;
+        nextOutput = false;
+        bool event = (mode == 0 ? (!input && nextInput) : mode == 1 ? (input && !nextInput) : (input != nextInput));
+        if (event)
+        {
+            if (!skipping)
+            {
+                if (counterEvents < burstLength)
+                    nextOutput = true;
+                else
+                {
+                    skipping = true;
+                    counterEvents = 0;
+                }
+            }
+            if (skipping && (counterEvents >= skipLength))
+            {
+                skipping = false;
+                nextOutput = true;
+                counterEvents = 0;
+            }
+            counterEvents++;
+        }
+    }
+
+    uint8_t mode;
+    bool skipping = false;
+    uint16_t burstLength, skipLength;
+    int32_t counterEvents;
+};
+
+// ******************** THE SAME PIPELINE, TWICE ********************
+ModelSource sources[NUM_SOURCES];
+ModelGate gates[NUM_NODES];
+ModelTrg trgs[NUM_NODES];
+ModelModule *modules[NUM_NODES];
+PackedLogic::Node nodes[NUM_NODES];
+
+static uint32_t seed = 12345;
+static uint32_t random32()
+{
+    seed = seed * 1664525UL + 1013904223UL; // (numerical recipes)
+    return (seed >> 8);
+}
+
+// Each node reads nodes before it (some after it: delayed by one tick, as the cycles of the pipeline):
+static void buildPipeline()
+{
+    for (uint8_t k = 0; k < NUM_NODES; k++)
+    {
+        if (k < NUM_SOURCES)
+        {
+            modules[k] = &sources[k];
+            nodes[k].type = PackedLogic::NODE_MODULE;
+        }
+        else if (k % 4 == 0)
+        {
+            ModelTrg &trg = trgs[k];
+            trg.mode = random32() % 3;
+            trg.burstLength = 1 + random32() % 3;
+            trg.skipLength = random32() % 3;
+            trg.counterEvents = -(int32_t)(random32() % 2); // offset
+            modules[k] = &trg;
+            nodes[k].type = PackedLogic::NODE_TRG;
+            nodes[k].trg = {trg.mode, false, false, trg.burstLength, trg.skipLength, trg.counterEvents};
+        }
+        else
+        {
+            gates[k].function = PackedLogic::NODE_AND + random32() % 4;
+            modules[k] = &gates[k];
+            nodes[k].type = gates[k].function;
+        }
+        nodes[k].inMask = 0;
+    }
+
+    for (uint8_t k = NUM_SOURCES; k < NUM_NODES; k++)
+    {
+        uint8_t numInputs = (nodes[k].type == PackedLogic::NODE_TRG ? 1 : 1 + random32() % MAX_INPUTS);
+        for (uint8_t i = 0; i < numInputs; i++)
+        {
+            uint8_t from = (random32() % 8 ? random32() % k : random32() % NUM_NODES);
+            if (nodes[k].inMask & (1UL << from))
+                continue; // (as LogicGate::setInputLink)
+            nodes[k].inMask |= (1UL << from);
+            if (modules[k]->ptr_fromModule == NULL)
+                modules[k]->ptr_fromModule = modules[from];
+            else
+                gates[k].ptr_extraInputs[gates[k].numExtraInputs++] = modules[from];
+        }
+    }
+}
+
+// Tick of the virtual evaluation (all the modules due, then refreshed):
+static uint32_t tickModel(uint32_t _levels)
+{
+    for (uint8_t k = 0; k < NUM_SOURCES; k++)
+        sources[k].level = (_levels >> k) & 1;
+    for (uint8_t k = 0; k < NUM_NODES; k++)
+        modules[k]->update();
+    uint32_t outputs = 0;
+    for (uint8_t k = 0; k < NUM_NODES; k++)
+    {
+        modules[k]->refreshStates();
+        outputs |= ((uint32_t)modules[k]->getOutputState() << k);
+    }
+    return (outputs);
+}
+
+// ...and of the packed evaluation:
+static uint32_t tickPacked(uint32_t _signals, uint32_t _levels)
+{
+    uint32_t nextSignals = _levels & ((1UL << NUM_SOURCES) - 1);
+    for (uint8_t k = NUM_SOURCES; k < NUM_NODES; k++)
+        nextSignals |= ((uint32_t)PackedLogic::evaluate(nodes[k], _signals) << k);
+    return (nextSignals);
+}
+
+volatile uint32_t sink; // so the compiler does not remove the loops
+
+void setUp() {}
+void tearDown() {}
+
+void test_gates()
+{
+    using namespace PackedLogic;
+    TEST_ASSERT_FALSE(evaluateGate(NODE_AND, 0xF, 0)); // no input
+    TEST_ASSERT_TRUE(evaluateGate(NODE_AND, 0x7, 0x5));
+    TEST_ASSERT_FALSE(evaluateGate(NODE_AND, 0x6, 0x5));
+    TEST_ASSERT_TRUE(evaluateGate(NODE_OR, 0x4, 0x5));
+    TEST_ASSERT_FALSE(evaluateGate(NODE_OR, 0x2, 0x5));
+    TEST_ASSERT_TRUE(evaluateGate(NODE_XOR, 0x15, 0x15)); // 3 inputs set
+    TEST_ASSERT_FALSE(evaluateGate(NODE_XOR, 0x5, 0x15));
+    TEST_ASSERT_TRUE(evaluateGate(NODE_NOT, 0x2, 0x5)); // NOR
+    TEST_ASSERT_FALSE(evaluateGate(NODE_NOT, 0x1, 0x5));
+}
+
+void test_pipeline()
+{
+    uint32_t signals = 0;
+    for (uint32_t t = 0; t < 20000; t++)
+    {
+        uint32_t levels = random32();
+        uint32_t outputs = tickModel(levels);
+        signals = tickPacked(signals, levels);
+        TEST_ASSERT_EQUAL_HEX32(outputs, signals);
+    }
+}
+
+template <class Tick>
+static double evaluationsPerSecond(Tick _tick)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint32_t sum = 0;
+    for (uint32_t t = 0; t < NUM_TICKS; t++)
+        sum += _tick(t * 2654435761UL); // (changing sources)
+    sink = sum;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return ((double)NUM_TICKS * NUM_NODES / elapsed.count());
+}
+
+void test_speed()
+{
+    double rateModel = evaluationsPerSecond([](uint32_t _levels) { return (tickModel(_levels)); });
+    uint32_t signals = 0;
+    double ratePacked = evaluationsPerSecond([&signals](uint32_t _levels) {
+        signals = tickPacked(signals, _levels);
+        return (signals);
+    });
+    char message[100];
+    snprintf(message, sizeof(message), "%d nodes: virtual %.1f M evaluations/s, packed %.1f M evaluations/s (x%.1f)",
+             NUM_NODES, rateModel / 1e6, ratePacked / 1e6, ratePacked / rateModel);
+    TEST_MESSAGE(message); // (reported, not asserted: the host timing is too noisy)
+}
+
+int main()
+{
+    buildPipeline();
+    UNITY_BEGIN();
+    RUN_TEST(test_gates);
+    RUN_TEST(test_pipeline);
+    RUN_TEST(test_speed);
+    return (UNITY_END());
+}